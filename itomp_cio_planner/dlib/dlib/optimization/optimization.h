@@ -514,7 +514,7 @@ namespace dlib
         T best_x = x;
         double best_f = f_value;
 
-        Jacobian::projectToNullSpace(x, g);
+        Jacobian::projectToNullSpace(x, g, true);
 
         if (f_value == 0 || length(g) == 0)
             return f_value;
@@ -560,7 +560,7 @@ namespace dlib
             f_value = f(x);
             g = der(x);
 
-            Jacobian::projectToNullSpace(x, g);
+            Jacobian::projectToNullSpace(x, g, true);
 
             DLIB_ASSERT(is_finite(f_value), "The objective function generated non-finite outputs");
             DLIB_ASSERT(is_finite(g), "The objective function generated non-finite outputs");
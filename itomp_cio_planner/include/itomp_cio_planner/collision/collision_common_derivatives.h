@@ -9,15 +9,58 @@
 #define COLLISION_COMMON_DERIVATIVES_H_
 
 #include <moveit/collision_detection_fcl/collision_common.h>
+#include <fcl/collision.h>
 
 namespace itomp_cio_planner
 {
 
+// last GJK search direction of each object pair checked at a trajectory point
+typedef std::map<std::pair<const fcl::CollisionObject*, const fcl::CollisionObject*>, fcl::Vec3f> GJKGuessCache;
+
 struct CollisionDataDerivatives
 {
+	CollisionDataDerivatives() : cd(NULL), gjk_guesses(NULL), num_gjk_queries(0), num_gjk_hits(0) {}
+
 	collision_detection::CollisionData* cd;
+	GJKGuessCache* gjk_guesses; // NULL if the queries are not warm-started
+	unsigned int num_gjk_queries;
+	unsigned int num_gjk_hits;
 };
 
+// world meshes may be replaced by temporary reduced meshes (swept broadphase), so they are not cache keys
+inline bool isPersistentCollisionObject(const fcl::CollisionObject* o)
+{
+	return o->getObjectType() == fcl::OT_GEOM
+		   || static_cast<const collision_detection::CollisionGeometryData*>(o->collisionGeometry()->getUserData())->type
+		   != collision_detection::BodyTypes::WORLD_OBJECT;
+}
+
+// fcl::collide warm-started from the cached GJK direction of the pair, which is updated with the result.
+// the solver type of the request is kept, so the penetration depths do not change. only the GJK solver of fcl
+// (GST_INDEP, not libccd) uses the cached guess, and only pairs with a shape (e.g. convex pieces) run GJK
+inline int collideWarmStarted(fcl::CollisionObject* o1, fcl::CollisionObject* o2, fcl::CollisionRequest request,
+							  fcl::CollisionResult& result, CollisionDataDerivatives& cdd)
+{
+	if (cdd.gjk_guesses == NULL || (o1->getObjectType() != fcl::OT_GEOM && o2->getObjectType() != fcl::OT_GEOM)
+			|| !isPersistentCollisionObject(o1) || !isPersistentCollisionObject(o2))
+		return fcl::collide(o1, o2, request, result);
+
+	request.enable_cached_gjk_guess = true;
+
+	std::pair<const fcl::CollisionObject*, const fcl::CollisionObject*> key(o1, o2);
+	GJKGuessCache::iterator it = cdd.gjk_guesses->find(key);
+	if (it != cdd.gjk_guesses->end())
+	{
+		request.cached_gjk_guess = it->second;
+		++cdd.num_gjk_hits;
+	}
+	++cdd.num_gjk_queries;
+
+	int num_contacts = fcl::collide(o1, o2, request, result);
+	(*cdd.gjk_guesses)[key] = result.cached_gjk_guess;
+	return num_contacts;
+}
+
 }
 
 
@@ -9,6 +9,7 @@
 #define COLLISION_ROBOT_FCL_DERIVATIVES_H_
 
 #include <itomp_cio_planner/common.h>
+#include <itomp_cio_planner/collision/collision_common_derivatives.h>
 #include <moveit/collision_detection_fcl/collision_robot_fcl.h>
 
 namespace itomp_cio_planner
@@ -22,6 +23,16 @@ public:
 	CollisionRobotFCLDerivatives(const collision_detection::CollisionRobotFCL &other);
 	void constructInternalFCLObject(const robot_state::RobotState &state);
     void updateInternalFCLObjectTransforms(const robot_state::RobotState &state);
+    // world AABBs of the internal collision objects at state, without updating them
+    void computeInternalFCLObjectAABBs(const robot_state::RobotState &state, std::vector<fcl::AABB>& aabbs) const;
+    // world transforms of the internal collision objects at state, without updating them
+    void computeInternalFCLObjectTransforms(const robot_state::RobotState &state, std::vector<fcl::Transform3f>& transforms) const;
+    const std::vector<boost::shared_ptr<fcl::CollisionObject> >& getInternalFCLCollisionObjects() const;
+
+    // self collision with the GJK directions of the link pairs checked with the point (see CollisionWorldFCLDerivatives)
+    void checkSelfCollision(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix &acm, int point) const;
+    void initializeGJKWarmStart(int num_points);
+    void clearGJKWarmStart();
 
 	virtual void checkSelfCollision(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const robot_state::RobotState &state) const;
 	virtual void checkSelfCollision(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix &acm) const;
@@ -45,16 +56,23 @@ public:
 	virtual double distanceOther(const robot_state::RobotState &state, const collision_detection::CollisionRobot &other_robot,
 								 const robot_state::RobotState &other_state, const collision_detection::AllowedCollisionMatrix &acm) const;
 protected:
-	void checkSelfCollisionDerivativesHelper(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix *acm) const;
+	void checkSelfCollisionDerivativesHelper(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix *acm, int point = -1) const;
 	double distanceSelfDerivativesHelper(const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix *acm) const;
 
 	static bool collisionCallback(fcl::CollisionObject *o1, fcl::CollisionObject *o2, void *data);
 	static bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void *data, double& min_dist);
 
     collision_detection::FCLManager manager_;
+
+    mutable std::vector<GJKGuessCache> gjk_guess_caches_; // indexed by point. empty if warm start is disabled
 };
 ITOMP_DEFINE_SHARED_POINTERS(CollisionRobotFCLDerivatives);
 
+inline const std::vector<boost::shared_ptr<fcl::CollisionObject> >& CollisionRobotFCLDerivatives::getInternalFCLCollisionObjects() const
+{
+	return manager_.object_.collision_objects_;
+}
+
 inline void CollisionRobotFCLDerivatives::checkSelfCollision(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const robot_state::RobotState &state1, const robot_state::RobotState &state2) const
 {
 	logError("FCL continuous collision checking not yet implemented");
@@ -9,7 +9,10 @@
 #define COLLISION_WORLD_FCL_DERIVATIVES_H_
 
 #include <itomp_cio_planner/common.h>
+#include <itomp_cio_planner/collision/convex_decomposition.h>
+#include <itomp_cio_planner/collision/collision_common_derivatives.h>
 #include <moveit/collision_detection_fcl/collision_world_fcl.h>
+#include <fcl/shape/geometric_shapes.h>
 
 namespace itomp_cio_planner
 {
@@ -18,6 +21,8 @@ class CollisionWorldFCLDerivatives : public collision_detection::CollisionWorldF
 {
 public:
 	CollisionWorldFCLDerivatives(const collision_detection::CollisionWorldFCL &other, const collision_detection::WorldPtr& world);
+	// shares the fcl objects and the convex pieces of other
+	CollisionWorldFCLDerivatives(const CollisionWorldFCLDerivatives &other, const collision_detection::WorldPtr& world);
 	virtual ~CollisionWorldFCLDerivatives();
 
 	virtual void checkRobotCollision(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const collision_detection::CollisionRobot &robot, const robot_state::RobotState &state) const;
@@ -32,15 +37,103 @@ public:
 	virtual double distanceWorld(const collision_detection::CollisionWorld &world) const;
 	virtual double distanceWorld(const collision_detection::CollisionWorld &world, const collision_detection::AllowedCollisionMatrix &acm) const;
 
+	// temporal broadphase. the world is culled once for a window of trajectory points [point_begin, point_end)
+	// with the bounds of each robot collision object swept over the window. meshes are reduced to the triangles
+	// inside the swept bounds of the whole robot. checkRobotCollision with a point in the window then runs the narrow
+	// phase only against the surviving world objects. the reduced meshes of a window are kept until its swept bounds
+	// leave the (slightly enlarged) bounds they were built for, or the world changes
+	void initializeSweptBroadphase(int num_points);
+	void updateSweptBroadphase(int point_begin, int point_end, const std::vector<fcl::AABB>& swept_aabbs);
+	void clearSweptBroadphase();
+	void checkRobotCollision(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const collision_detection::CollisionRobot &robot, const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix &acm, int point) const;
+
+	// batched query of one robot collision object at several poses (e.g. the points of a trajectory range).
+	// each world mesh BVH is traversed once with the packet of pose bounds, then each pose whose bounds reach a leaf
+	// runs the narrow phase against the mesh. the contacts of pose i are added to results[i]
+	void checkRobotCollisionBatch(const collision_detection::CollisionRequest &req, std::vector<collision_detection::CollisionResult> &results, const collision_detection::CollisionRobot &robot,
+								  int object_index, const std::vector<fcl::Transform3f>& transforms, const collision_detection::AllowedCollisionMatrix &acm) const;
+
+	// replaces the shapes of the world objects with their convex pieces, which are checked as fcl::Convex (GJK/EPA)
+	void applyConvexDecompositions(const std::map<std::string, ConvexDecompositionConstPtr>& decompositions);
+	// moves the convex pieces of a decomposed world object. the fcl geometries of the pieces are kept
+	void moveConvexDecomposition(const std::string& id, const Eigen::Affine3d& pose);
+
+	// GJK warm start. the last search direction of each (robot object, world object) pair checked with a point
+	// starts the next query of the pair with the point. the caches are cleared whenever the world changes
+	void initializeGJKWarmStart(int num_points);
+	void clearGJKWarmStart();
+	void getGJKWarmStartStatistics(unsigned int& num_queries, unsigned int& num_hits) const;
+	void resetGJKWarmStartStatistics();
+
 protected:
-	void checkRobotCollisionDerivativesHelper(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const collision_detection::CollisionRobot &robot, const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix *acm) const;
+	void checkRobotCollisionDerivativesHelper(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const collision_detection::CollisionRobot &robot, const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix *acm, int point = -1) const;
 	double distanceRobotDerivativesHelper(const collision_detection::CollisionRobot &robot, const robot_state::RobotState &state, const collision_detection::AllowedCollisionMatrix *acm) const;
 
 	static bool collisionCallback(fcl::CollisionObject *o1, fcl::CollisionObject *o2, void *data);
 	static bool distanceCallback(fcl::CollisionObject* o1, fcl::CollisionObject* o2, void *data, double& min_dist);
+
+	bool reduceMesh(const fcl::CollisionObject& object, const fcl::AABB& bounds, boost::shared_ptr<fcl::CollisionObject>& reduced_object) const;
+	// triangles[b] gets the triangles of the BVH leaves overlapping bounds[b] for each b in active_bounds.
+	// returns false if the object is not a mesh worth reducing
+	bool collectMeshTriangles(const fcl::CollisionObject& object, const std::vector<fcl::AABB>& bounds,
+							  const std::vector<int>& active_bounds, std::vector<std::vector<int> >& triangles) const;
+	boost::shared_ptr<fcl::CollisionObject> createSubMesh(const fcl::CollisionObject& object, const std::vector<int>& triangles) const;
+
+	struct SweptWindow
+	{
+		SweptWindow() : is_culled_(false) {}
+
+		bool is_culled_; // false if objects_ has to be rebuilt
+		fcl::AABB culling_bounds_; // bounds objects_ and reduced_meshes_ were built for
+		std::vector<fcl::CollisionObject*> objects_; // world objects (or their reduced meshes) overlapping culling_bounds_
+		std::vector<boost::shared_ptr<fcl::CollisionObject> > reduced_meshes_;
+		std::vector<std::vector<fcl::CollisionObject*> > candidates_; // world objects of each robot collision object
+	};
+	std::vector<SweptWindow> swept_windows_; // indexed by the first point of the window
+	std::vector<int> swept_window_of_point_; // -1 if the point is not in a window
+
+	// fcl::Convex does not own its arrays
+	struct ConvexPiece
+	{
+		std::vector<fcl::Vec3f> plane_normals_;
+		std::vector<fcl::FCL_REAL> plane_dis_;
+		std::vector<fcl::Vec3f> points_;
+		std::vector<int> polygons_;
+		boost::shared_ptr<fcl::CollisionGeometry> geometry_; // fcl::Convex on the arrays above
+	};
+	std::map<std::string, std::vector<boost::shared_ptr<ConvexPiece> > > convex_pieces_; // indexed by world object
+
+	// replaces the fcl objects of the pieces of a world object with its convex geometries, at the same transforms.
+	// returns false if the object has no convex pieces
+	bool setConvexPieceGeometries(const std::string& id);
+
+	void notifyWorldChange(const collision_detection::World::ObjectConstPtr& object, collision_detection::World::Action action);
+	void updateGJKWarmStartStatistics(const CollisionDataDerivatives& cdd) const;
+
+	mutable std::vector<GJKGuessCache> gjk_guess_caches_; // indexed by point. empty if warm start is disabled
+	mutable unsigned int num_gjk_queries_;
+	mutable unsigned int num_gjk_hits_;
+	collision_detection::World::ObserverHandle world_observer_handle_;
 };
 ITOMP_DEFINE_SHARED_POINTERS(CollisionWorldFCLDerivatives);
 
+inline void CollisionWorldFCLDerivatives::getGJKWarmStartStatistics(unsigned int& num_queries, unsigned int& num_hits) const
+{
+	num_queries = num_gjk_queries_;
+	num_hits = num_gjk_hits_;
+}
+
+inline void CollisionWorldFCLDerivatives::resetGJKWarmStartStatistics()
+{
+	num_gjk_queries_ = num_gjk_hits_ = 0;
+}
+
+inline void CollisionWorldFCLDerivatives::updateGJKWarmStartStatistics(const CollisionDataDerivatives& cdd) const
+{
+	num_gjk_queries_ += cdd.num_gjk_queries;
+	num_gjk_hits_ += cdd.num_gjk_hits;
+}
+
 inline void CollisionWorldFCLDerivatives::checkRobotCollision(const collision_detection::CollisionRequest &req, collision_detection::CollisionResult &res, const collision_detection::CollisionRobot &robot, const robot_state::RobotState &state1, const robot_state::RobotState &state2) const
 {
 	logError("FCL continuous collision checking not yet implemented");
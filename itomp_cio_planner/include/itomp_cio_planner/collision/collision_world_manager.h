@@ -0,0 +1,62 @@
+#ifndef COLLISION_WORLD_MANAGER_H_
+#define COLLISION_WORLD_MANAGER_H_
+
+#include <itomp_cio_planner/common.h>
+#include <itomp_cio_planner/collision/collision_world_fcl_derivatives.h>
+#include <itomp_cio_planner/collision/convex_decomposition.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+namespace itomp_cio_planner
+{
+
+/**
+ * \brief Planner-side collision world kept across planning requests.
+ *
+ * The objects of the planning scene world are copy-on-write, so an object is unchanged since the last update
+ * as long as the scene still holds the same object pointer. Each update applies the added, moved and removed objects
+ * to the planner world, whose observers rebuild the fcl objects (and the convex pieces) of those objects only.
+ * The collision worlds of the evaluation managers share the fcl objects of the planner world.
+ */
+class CollisionWorldManager : public Singleton<CollisionWorldManager>
+{
+public:
+	CollisionWorldManager();
+	virtual ~CollisionWorldManager();
+
+	// applies the changes of the planning scene world since the last update. returns the version of the planner world
+	unsigned int update(const planning_scene::PlanningSceneConstPtr& planning_scene);
+	void clear();
+
+	unsigned int getVersion() const;
+	// convex pieces replacing the meshes of the planner world
+	const std::map<std::string, ConvexDecompositionConstPtr>& getConvexDecompositions() const;
+
+	// copy of the planner world for an evaluation manager
+	CollisionWorldFCLDerivativesPtr createCollisionWorld() const;
+
+private:
+	// decomposes the mesh of the object if it is worth it. returns NULL otherwise
+	ConvexDecompositionConstPtr decompose(const std::string& id, const collision_detection::World::Object& object) const;
+
+	collision_detection::WorldPtr world_;
+	CollisionWorldFCLDerivativesPtr collision_world_;
+	std::map<std::string, collision_detection::World::ObjectConstPtr> scene_objects_; // scene world objects at the last update
+	std::map<std::string, ConvexDecompositionConstPtr> convex_decompositions_;
+	unsigned int version_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline unsigned int CollisionWorldManager::getVersion() const
+{
+	return version_;
+}
+
+inline const std::map<std::string, ConvexDecompositionConstPtr>& CollisionWorldManager::getConvexDecompositions() const
+{
+	return convex_decompositions_;
+}
+
+}
+
+#endif /* COLLISION_WORLD_MANAGER_H_ */
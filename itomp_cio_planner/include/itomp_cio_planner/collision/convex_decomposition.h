@@ -0,0 +1,62 @@
+#ifndef CONVEX_DECOMPOSITION_H_
+#define CONVEX_DECOMPOSITION_H_
+
+#include <itomp_cio_planner/common.h>
+#include <geometric_shapes/shapes.h>
+#include <stdint.h>
+
+namespace itomp_cio_planner
+{
+
+/**
+ * \brief Approximate convex decomposition of a triangle mesh.
+ *
+ * The triangles are split recursively at the median of the longest axis of their bounds,
+ * until the convex hull of each piece is within max_concavity of the piece surface.
+ * Open pieces (e.g. a floor) are extruded by max_concavity behind their surface, so every piece is a solid.
+ * The pieces are stored in a binary cache keyed by the hash of the source mesh and the parameters.
+ */
+class ConvexDecomposition
+{
+public:
+	ConvexDecomposition();
+	virtual ~ConvexDecomposition();
+
+	void decompose(const shapes::Mesh& mesh, double max_concavity, unsigned int max_pieces);
+
+	static uint64_t computeMeshHash(const shapes::Mesh& mesh, double max_concavity, unsigned int max_pieces);
+	bool load(const std::string& file_name, uint64_t mesh_hash);
+	bool save(const std::string& file_name, uint64_t mesh_hash) const;
+
+	// loads the cache file, or decomposes the mesh and writes the cache file if it is missing or out of date
+	void loadOrDecompose(const std::string& file_name, const shapes::Mesh& mesh, double max_concavity, unsigned int max_pieces);
+
+	unsigned int getNumPieces() const;
+	const boost::shared_ptr<const shapes::Mesh>& getPiece(unsigned int i) const;
+
+private:
+	shapes::Mesh* computeConvexHull(const shapes::Mesh& mesh, const std::vector<unsigned int>& triangles,
+									double thickness, double& concavity) const;
+
+	std::vector<boost::shared_ptr<const shapes::Mesh> > pieces_;
+
+	static const char FILE_MAGIC[8];
+	static const uint32_t FILE_VERSION;
+};
+ITOMP_DEFINE_SHARED_POINTERS(ConvexDecomposition)
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline unsigned int ConvexDecomposition::getNumPieces() const
+{
+	return pieces_.size();
+}
+
+inline const boost::shared_ptr<const shapes::Mesh>& ConvexDecomposition::getPiece(unsigned int i) const
+{
+	return pieces_[i];
+}
+
+}
+
+#endif /* CONVEX_DECOMPOSITION_H_ */
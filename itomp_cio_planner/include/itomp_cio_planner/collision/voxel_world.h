@@ -0,0 +1,76 @@
+#ifndef VOXEL_WORLD_H_
+#define VOXEL_WORLD_H_
+
+#include <itomp_cio_planner/common.h>
+#include <fcl/collision_object.h>
+
+namespace itomp_cio_planner
+{
+
+/**
+ * \brief Environment scanned as an octree (OctoMap binary .bt file).
+ *
+ * The occupied leaves are rasterized at the octree resolution into a dense signed distance field
+ * (positive outside, negative inside the occupied voxels, truncated at voxel_environment_max_distance),
+ * which answers link penetration queries with one trilinear lookup per link vertex.
+ * Planar regions of the occupied surface are extracted as rectangles for the contact projection.
+ */
+class VoxelWorld : public Singleton<VoxelWorld>
+{
+public:
+	VoxelWorld();
+	virtual ~VoxelWorld();
+
+	// loads voxel_environment if it has changed since the last call
+	void initialize();
+	bool isLoaded() const;
+
+	double getResolution() const;
+	double getDistance(const Eigen::Vector3d& position) const;
+	// largest penetration depth of the vertices (or the bounds of non-mesh geometries) of the object
+	double getPenetrationDepth(const fcl::CollisionObject& object) const;
+
+	// triangles (3 vertices each, counter-clockwise around the outward normal) covering the planar surface regions
+	void extractSurfaceTriangles(double min_area, std::vector<Eigen::Vector3d>& vertices) const;
+
+private:
+	bool load(const std::string& file_name);
+	void computeDistanceField(const std::vector<char>& occupancy);
+
+	int getIndex(int x, int y, int z) const;
+	Eigen::Vector3d getVoxelCenter(int x, int y, int z) const;
+
+	std::string file_name_;
+	double resolution_;
+	Eigen::Vector3d origin_; // center of voxel (0, 0, 0)
+	int size_[3];
+	double max_distance_;
+	std::vector<float> distances_;
+	std::vector<char> surface_; // occupied voxels with a free 6-neighbor
+};
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline bool VoxelWorld::isLoaded() const
+{
+	return !distances_.empty();
+}
+
+inline double VoxelWorld::getResolution() const
+{
+	return resolution_;
+}
+
+inline int VoxelWorld::getIndex(int x, int y, int z) const
+{
+	return (z * size_[1] + y) * size_[0] + x;
+}
+
+inline Eigen::Vector3d VoxelWorld::getVoxelCenter(int x, int y, int z) const
+{
+	return origin_ + resolution_ * Eigen::Vector3d(x, y, z);
+}
+
+}
+
+#endif /* VOXEL_WORLD_H_ */
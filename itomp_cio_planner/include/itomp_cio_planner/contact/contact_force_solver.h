@@ -0,0 +1,32 @@
+#ifndef CONTACT_FORCE_SOLVER_H_
+#define CONTACT_FORCE_SOLVER_H_
+
+#include <itomp_cio_planner/common.h>
+
+namespace itomp_cio_planner
+{
+
+// Contact point forces of a trajectory point from the kinematics.
+// Minimizes wrench_weight * |tau + A f|^2 + sum_k point_weights(k) * |f_k|^2
+// over the point forces f_k inside their friction cones, by projected Gauss-Seidel
+// over the 3x3 blocks of the normal equations. tau is the residual root joint torque without contact forces.
+class ContactForceSolver
+{
+public:
+    ContactForceSolver();
+
+    // returns the number of iterations
+    int solve(const Eigen::MatrixXd& A, const Eigen::VectorXd& tau, double wrench_weight, const Eigen::VectorXd& point_weights,
+              const std::vector<Eigen::Vector3d>& normals, double friction_coefficient, int max_iterations,
+              Eigen::VectorXd& forces);
+
+private:
+    static Eigen::Vector3d projectToFrictionCone(const Eigen::Vector3d& force, const Eigen::Vector3d& normal, double friction_coefficient);
+
+    Eigen::MatrixXd hessian_;
+    Eigen::VectorXd gradient_;
+};
+
+}
+
+#endif /* CONTACT_FORCE_SOLVER_H_ */
@@ -12,6 +12,12 @@ namespace itomp_cio_planner
 double getContactActiveValue(unsigned int contact, unsigned int contact_point,
                              const std::vector<ContactVariables>& contact_variables);
 
+// position, orientation and velocity error of a contact point w.r.t. its projection,
+// which the contact invariant cost weights by the contact active value
+double getContactInvariantError(unsigned int contact, unsigned int contact_point,
+                                const RigidBodyDynamics::Model& model, const ItompPlanningGroup& planning_group,
+                                const std::vector<ContactVariables>& contact_variables);
+
 
 };
 
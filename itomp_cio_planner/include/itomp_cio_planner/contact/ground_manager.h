@@ -46,6 +46,7 @@ public:
 
 private:
 	void initializeContactSurfaces();
+    void addContactTriangle(const Eigen::Vector3d& position1, const Eigen::Vector3d& position2, const Eigen::Vector3d& position3);
 
     bool getNearestMeshPosition(const Eigen::Vector3d& position_in,
                                 Eigen::Vector3d& position_out, const Eigen::Vector3d& normal_in,
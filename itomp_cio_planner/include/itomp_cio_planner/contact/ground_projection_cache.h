@@ -0,0 +1,70 @@
+#ifndef GROUND_PROJECTION_CACHE_H_
+#define GROUND_PROJECTION_CACHE_H_
+
+#include <itomp_cio_planner/common.h>
+
+namespace itomp_cio_planner
+{
+
+// Memoizes GroundManager::getNearestContactPosition per (point, contact, slot).
+// A projection is reused only when its inputs are bit-identical to the cached ones,
+// e.g. while joint parameters are perturbed for finite differences.
+class GroundProjectionCache
+{
+public:
+    GroundProjectionCache();
+
+    void initialize(int num_points, int num_contacts, int num_slots);
+    void invalidate();
+
+    void getNearestContactPosition(int point, int contact, int slot,
+                                   const Eigen::Vector3d& position_in, const Eigen::Vector3d& orientation_in,
+                                   Eigen::Vector3d& position_out, Eigen::Vector3d& orientation_out,
+                                   Eigen::Vector3d& normal, bool include_ground);
+
+    unsigned long getNumHits() const;
+    unsigned long getNumMisses() const;
+    void resetStatistics();
+
+private:
+    struct Entry
+    {
+        Eigen::Vector3d position_in_;
+        Eigen::Vector3d orientation_in_;
+        Eigen::Vector3d position_out_;
+        Eigen::Vector3d orientation_out_;
+        Eigen::Vector3d normal_;
+        bool include_ground_;
+        bool valid_;
+    };
+
+    int getEntryIndex(int point, int contact, int slot) const;
+
+    std::vector<Entry> entries_;
+    int num_contacts_;
+    int num_slots_;
+
+    unsigned long num_hits_;
+    unsigned long num_misses_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline int GroundProjectionCache::getEntryIndex(int point, int contact, int slot) const
+{
+    return (point * num_contacts_ + contact) * num_slots_ + slot;
+}
+
+inline unsigned long GroundProjectionCache::getNumHits() const
+{
+    return num_hits_;
+}
+
+inline unsigned long GroundProjectionCache::getNumMisses() const
+{
+    return num_misses_;
+}
+
+}
+
+#endif /* GROUND_PROJECTION_CACHE_H_ */
@@ -25,6 +25,12 @@ public:
 		return false;
 	}
 
+	// the cost of a point is the sum of the squares of its residuals.
+	// by default a single residual, the square root of the cost
+	virtual int getNumResiduals(const NewEvalManager* evaluation_manager) const;
+	virtual bool evaluateResiduals(const NewEvalManager* evaluation_manager, int point,
+								   double* residuals) const;
+
 	int getIndex() const;
 	const std::string& getName() const;
 	double getWeight() const;
@@ -52,22 +58,24 @@ inline double TrajectoryCost::getWeight() const
 	return weight_;
 }
 
-ITOMP_TRAJECTORY_COST_DECL(Smoothness)
+ITOMP_TRAJECTORY_COST_DECL_WITH_RESIDUALS(Smoothness)
 //ITOMP_TRAJECTORY_COST_DECL(Obstacle)
 ITOMP_TRAJECTORY_COST_DECL(Validity)
 ITOMP_TRAJECTORY_COST_DECL(ContactInvariant)
-ITOMP_TRAJECTORY_COST_DECL(PhysicsViolation)
-ITOMP_TRAJECTORY_COST_DECL(GoalPose)
+ITOMP_TRAJECTORY_COST_DECL_WITH_RESIDUALS(PhysicsViolation)
+ITOMP_TRAJECTORY_COST_DECL_WITH_RESIDUALS(GoalPose)
 ITOMP_TRAJECTORY_COST_DECL(COM)
 ITOMP_TRAJECTORY_COST_DECL(EndeffectorVelocity)
-ITOMP_TRAJECTORY_COST_DECL(Torque)
-ITOMP_TRAJECTORY_COST_DECL(RVO)
+ITOMP_TRAJECTORY_COST_DECL_WITH_RESIDUALS(Torque)
 ITOMP_TRAJECTORY_COST_DECL(FTR)
 ITOMP_TRAJECTORY_COST_DECL(ROM)
 ITOMP_TRAJECTORY_COST_DECL(CartesianTrajectory)
 ITOMP_TRAJECTORY_COST_DECL(Singularity)
 ITOMP_TRAJECTORY_COST_DECL(FrictionCone)
 
+// loads the ROM files of the ROM cost once. they are kept for all requests
+void loadROMFiles();
+
 class TrajectoryCostObstacle : public TrajectoryCost
 {
 public:
@@ -83,6 +91,24 @@ public:
 	virtual bool evaluate(const NewEvalManager* evaluation_manager,
 						  int point, double& cost) const;
     virtual bool isInvariant(const NewEvalManager* evaluation_manager, const ItompTrajectoryIndex& index) const;
+
+    // request of the obstacle and self-collision queries, also used by the batched queries and the benchmarks
+    static collision_detection::CollisionRequest getCollisionRequest();
+};
+
+class TrajectoryCostRVO : public TrajectoryCost
+{
+public:
+	TrajectoryCostRVO(int index, std::string name, double weight,
+					  const NewEvalManager* evaluation_manager) : TrajectoryCost(index, name, weight)
+	{
+		initialize(evaluation_manager);
+	}
+	virtual ~TrajectoryCostRVO() {}
+	virtual void initialize(const NewEvalManager* evaluation_manager);
+	virtual bool evaluate(const NewEvalManager* evaluation_manager,
+						  int point, double& cost) const;
+    virtual bool isInvariant(const NewEvalManager* evaluation_manager, const ItompTrajectoryIndex& index) const;
 };
 
 }
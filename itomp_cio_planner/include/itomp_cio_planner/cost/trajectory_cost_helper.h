@@ -33,6 +33,24 @@ class TrajectoryCost##C : public TrajectoryCost \
 								int point, double& cost) const;\
 };
 
+#define ITOMP_TRAJECTORY_COST_DECL_WITH_RESIDUALS(C) \
+class TrajectoryCost##C : public TrajectoryCost \
+{\
+	public:\
+		TrajectoryCost##C(int index, std::string name, double weight,\
+						  const NewEvalManager* evaluation_manager) : TrajectoryCost(index, name, weight)\
+		{ \
+			initialize(evaluation_manager); \
+		} \
+		virtual ~TrajectoryCost##C() {} \
+		virtual void initialize(const NewEvalManager* evaluation_manager);\
+		virtual bool evaluate(const NewEvalManager* evaluation_manager, \
+								int point, double& cost) const;\
+		virtual int getNumResiduals(const NewEvalManager* evaluation_manager) const;\
+		virtual bool evaluateResiduals(const NewEvalManager* evaluation_manager, \
+									   int point, double* residuals) const;\
+};
+
 #define ITOMP_TRAJECTORY_COST_ADD(C) \
 if (PlanningParameters::getInstance()->get##C##CostWeight() > 0.0) \
 { \
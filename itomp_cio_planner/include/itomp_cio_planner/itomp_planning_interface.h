@@ -1,11 +1,12 @@
 #ifndef ITOMP_PLANNING_INTERFACE_H_
 #define ITOMP_PLANNING_INTERFACE_H_
 
+#include <itomp_cio_planner/common.h>
 #include <moveit/planning_interface/planning_interface.h>
-#include <itomp_cio_planner/planner/itomp_planner_node.h>
 
 namespace itomp_cio_planner
 {
+ITOMP_FORWARD_DECL(ItompPlannerNode)
 
 class ItompPlanningContext: public planning_interface::PlanningContext
 {
@@ -17,6 +18,9 @@ public:
 
 	virtual bool solve(planning_interface::MotionPlanResponse &res);
 	virtual bool solve(planning_interface::MotionPlanDetailedResponse &res);
+	// plans the requests of multiple agents together (see ItompPlannerNode::planTrajectories)
+	bool solve(const std::vector<planning_interface::MotionPlanRequest>& reqs,
+			   std::vector<planning_interface::MotionPlanResponse>& res);
 
 	virtual void clear();
 	virtual bool terminate();
@@ -20,6 +20,9 @@ public:
 
 	unsigned int rbdl_joint_index_; // q
 	std::vector<unsigned int> rbdl_affected_body_ids_; // used in partial FK
+	unsigned int rbdl_subtree_begin_; // affected body ids as a range [begin, end). begin == end if they are not contiguous
+	unsigned int rbdl_subtree_end_;
+	std::vector<unsigned int> rbdl_ancestor_body_ids_; // from the parent body to the root
 };
 }
 #endif
@@ -57,6 +57,9 @@ public:
 	const RigidBodyDynamics::Model& getRBDLRobotModel() const;
 
 private:
+	void computeSubtreeRange(ItompRobotJoint& joint, unsigned int body_id) const;
+	void benchmarkPartialKinematics(const ItompPlanningGroup& planning_group, int num_trials) const;
+
 	robot_model::RobotModelConstPtr moveit_robot_model_;
 	std::string reference_frame_; /**< Reference frame for all kinematics operations */
 
@@ -0,0 +1,44 @@
+#ifndef RBDL_MODEL_CACHE_H_
+#define RBDL_MODEL_CACHE_H_
+
+#include <itomp_cio_planner/common.h>
+#include <itomp_cio_planner/model/rbdl_urdf_reader.h>
+#include <rbdl/rbdl.h>
+#include <stdint.h>
+
+namespace itomp_cio_planner
+{
+
+/**
+ * \brief Binary cache of the RBDL model built from the urdf and of the
+ * index tables derived from it in ItompRobotModel.
+ *
+ * The cache stores the arguments of the AddBody calls made by ReadURDFModel,
+ * so the model is rebuilt without parsing the urdf xml.
+ * It is only used if the stored urdf hash matches the current urdf.
+ */
+class RBDLModelCache
+{
+public:
+	RBDLModelCache();
+	virtual ~RBDLModelCache();
+
+	static uint64_t computeURDFHash(const std::string& urdf_string);
+
+	bool load(const std::string& file_name, uint64_t urdf_hash);
+	bool save(const std::string& file_name, uint64_t urdf_hash) const;
+
+	bool buildModel(RigidBodyDynamics::Model& model) const;
+
+	RBDLBodyRecordVector body_records_;
+	std::vector<std::vector<unsigned int> > rbdl_affected_body_ids_;
+	std::vector<std::string> rbdl_number_to_joint_name_;
+
+private:
+	static const char FILE_MAGIC[8];
+	static const uint32_t FILE_VERSION;
+};
+
+}
+
+#endif /* RBDL_MODEL_CACHE_H_ */
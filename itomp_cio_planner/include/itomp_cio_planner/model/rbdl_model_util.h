@@ -23,6 +23,61 @@ void updatePartialKinematicsAndDynamics(RigidBodyDynamics::Model &model,
                                         const std::vector<double> *joint_forces,
 										const std::vector<unsigned int>& body_ids);
 
+// partial update for a subtree whose bodies have the contiguous ids [subtree_begin, subtree_end).
+// ancestor_body_ids is the chain from the parent of subtree_begin to the root.
+void updateSubtreeKinematicsAndDynamics(RigidBodyDynamics::Model &model,
+                                        const RigidBodyDynamics::Math::VectorNd &Q,
+                                        const RigidBodyDynamics::Math::VectorNd &QDot,
+                                        const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                        RigidBodyDynamics::Math::VectorNd &Tau,
+                                        const std::vector<RigidBodyDynamics::Math::SpatialVector> *f_ext,
+                                        const std::vector<double> *joint_forces,
+                                        unsigned int subtree_begin, unsigned int subtree_end,
+                                        const std::vector<unsigned int>& ancestor_body_ids);
+
+// forward kinematics without the RNEA backward pass. model.f[i] is set to the momentum rate of body i
+// in base coordinates, and momentum_rate to their sum, for computeRootJointTorques
+void updateFullKinematicsAndMomentumRates(RigidBodyDynamics::Model &model,
+                                          const RigidBodyDynamics::Math::VectorNd &Q,
+                                          const RigidBodyDynamics::Math::VectorNd &QDot,
+                                          const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                          RigidBodyDynamics::Math::SpatialVector &momentum_rate);
+
+// updates the kinematics and momentum rates of body_ids (sorted, parents first), and their sum in momentum_rate
+void updatePartialKinematicsAndMomentumRates(RigidBodyDynamics::Model &model,
+                                             const RigidBodyDynamics::Math::VectorNd &Q,
+                                             const RigidBodyDynamics::Math::VectorNd &QDot,
+                                             const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                             RigidBodyDynamics::Math::SpatialVector &momentum_rate,
+                                             const std::vector<unsigned int>& body_ids);
+
+// reduced-order variant of updateFullKinematicsAndMomentumRates. accelerations are computed only for the
+// root bodies, and the whole body is treated as its composite inertia moving with the last root body.
+// root_body_ids is the root joint chain as in computeRootJointTorques
+void updateFullKinematicsAndCentroidalMomentumRate(RigidBodyDynamics::Model &model,
+                                                   const RigidBodyDynamics::Math::VectorNd &Q,
+                                                   const RigidBodyDynamics::Math::VectorNd &QDot,
+                                                   const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                                   RigidBodyDynamics::Math::SpatialVector &momentum_rate,
+                                                   const std::vector<unsigned int>& root_body_ids);
+
+void updatePartialKinematicsAndCentroidalMomentumRate(RigidBodyDynamics::Model &model,
+                                                      const RigidBodyDynamics::Math::VectorNd &Q,
+                                                      const RigidBodyDynamics::Math::VectorNd &QDot,
+                                                      const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                                      RigidBodyDynamics::Math::SpatialVector &momentum_rate,
+                                                      const std::vector<unsigned int>& root_body_ids,
+                                                      const std::vector<unsigned int>& body_ids);
+
+// torques of the unactuated root joints (a chain of 1-dof joints from the base, root first),
+// from the momentum rate of the whole body and the external and passive forces
+void computeRootJointTorques(RigidBodyDynamics::Model &model,
+                             const RigidBodyDynamics::Math::SpatialVector &momentum_rate,
+                             const std::vector<RigidBodyDynamics::Math::SpatialVector> *f_ext,
+                             const std::vector<double> *joint_forces,
+                             const std::vector<unsigned int>& root_body_ids,
+                             RigidBodyDynamics::Math::VectorNd &Tau);
+
 void updatePartialDynamics(RigidBodyDynamics::Model &model,
 						   const RigidBodyDynamics::Math::VectorNd &Q,
 						   const RigidBodyDynamics::Math::VectorNd &QDot,
@@ -37,6 +92,28 @@ void UpdatePartialKinematics(RigidBodyDynamics::Model & model,
 							 const RigidBodyDynamics::Math::VectorNd& QDDot,
 							 const std::vector<unsigned int>& body_ids);
 
+// preallocated buffers of InverseKinematics6D.
+// reusing a workspace across solves avoids allocations and warm-starts the damping from the last solve.
+struct InverseKinematicsWorkspace
+{
+    InverseKinematicsWorkspace(double initial_lambda = 0.01);
+    void resize(unsigned int num_bodies, unsigned int qdot_size);
+
+    RigidBodyDynamics::Math::MatrixNd J_;
+    RigidBodyDynamics::Math::MatrixNd G_;
+    RigidBodyDynamics::Math::MatrixNd JJT_;
+    RigidBodyDynamics::Math::MatrixNd A_;
+    Eigen::LLT<Eigen::MatrixXd> llt_;
+    RigidBodyDynamics::Math::VectorNd e_;
+    RigidBodyDynamics::Math::VectorNd e_trial_;
+    RigidBodyDynamics::Math::VectorNd z_;
+    RigidBodyDynamics::Math::VectorNd delta_q_;
+    RigidBodyDynamics::Math::VectorNd q_trial_;
+
+    double lambda_;
+    unsigned int iterations_;
+};
+
 bool InverseKinematics6D(RigidBodyDynamics::Model &model,
                          const RigidBodyDynamics::Math::VectorNd &Qinit,
                          const std::vector<unsigned int>& body_id,
@@ -48,6 +125,28 @@ bool InverseKinematics6D(RigidBodyDynamics::Model &model,
                          unsigned int max_iter = 50
                         );
 
+// damped least squares on the SO(3) log error with adaptive (Levenberg-Marquardt) damping.
+// returns false if the damping saturates before the error is within step_tol (local minimum or unreachable target)
+bool InverseKinematics6D(RigidBodyDynamics::Model &model,
+                         const RigidBodyDynamics::Math::VectorNd &Qinit,
+                         const std::vector<unsigned int>& body_id,
+                         const std::vector<RigidBodyDynamics::Math::Vector3d>& target_pos,
+                         const std::vector<RigidBodyDynamics::Math::Matrix3d>& target_ori,
+                         RigidBodyDynamics::Math::VectorNd &Qres,
+                         InverseKinematicsWorkspace &workspace,
+                         double step_tol = 1.0e-12,
+                         unsigned int max_iter = 50
+                        );
+
+// solves IK for targets reached by random perturbations of Q, and prints iterations and time per solve
+// of InverseKinematics6D and of the euler angle based solver it replaced
+void BenchmarkInverseKinematics6D(const RigidBodyDynamics::Model &model,
+                                  const RigidBodyDynamics::Math::VectorNd &Q,
+                                  const std::vector<unsigned int>& body_id,
+                                  unsigned int num_solves,
+                                  double perturbation = 0.1
+                                 );
+
 void CalcPointJacobian6D (
         RigidBodyDynamics::Model &model,
         const RigidBodyDynamics::Math::VectorNd &Q,
@@ -6,7 +6,29 @@
 
 namespace itomp_cio_planner
 {
-bool ReadURDFModel (const std::string& xml_string, RigidBodyDynamics::Model* model, bool verbose = false);
+
+// arguments of a single Model::AddBody call made while constructing the model from urdf
+struct RBDLBodyRecord
+{
+	EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+	unsigned int parent_id_;
+	RigidBodyDynamics::Math::SpatialTransform joint_frame_;
+	unsigned int joint_dof_count_; // 0 : fixed joint
+	RigidBodyDynamics::Math::SpatialVector joint_axes_[6];
+	double mass_;
+	RigidBodyDynamics::Math::Vector3d com_;
+	RigidBodyDynamics::Math::Matrix3d inertia_;
+	std::string name_;
+};
+typedef std::vector<RBDLBodyRecord, Eigen::aligned_allocator<RBDLBodyRecord> > RBDLBodyRecordVector;
+
+bool ReadURDFModel (const std::string& xml_string, RigidBodyDynamics::Model* model, bool verbose = false,
+					RBDLBodyRecordVector* body_records = NULL);
+
+// rebuilds the model by replaying the recorded AddBody calls
+bool ConstructModelFromRecords (const RBDLBodyRecordVector& body_records, RigidBodyDynamics::Model* model);
+
 }
 
 #endif /* RBDL_URDF_READER_H_ */
@@ -0,0 +1,65 @@
+#ifndef AUGMENTED_LAGRANGIAN_H_
+#define AUGMENTED_LAGRANGIAN_H_
+
+#include <itomp_cio_planner/common.h>
+#include <itomp_cio_planner/optimization/new_eval_manager.h>
+
+namespace itomp_cio_planner
+{
+
+// Root wrench balance (the 6 root joint torques) and contact consistency (sqrt of the contact invariant cost
+// of each contact point) as equality constraints c = 0 of the phases > 2.
+// The physics violation and contact invariant costs become the shifted penalties rho * |c + s|^2
+// (augmented Lagrangian with the multipliers 2 * weight * rho * s), and after each inner optimization
+// the shifts are moved by the constraint values. rho is increased when the violation does not decrease enough.
+class AugmentedLagrangian : public Singleton<AugmentedLagrangian>
+{
+public:
+    AugmentedLagrangian();
+    virtual ~AugmentedLagrangian();
+
+    // zero multipliers
+    void reset(int num_points, int num_contacts);
+
+    // enabled, and the constraint costs are evaluated in the current phase
+    bool isActive() const;
+
+    double getPenaltyScale() const;
+    double getPhysicsShift(int point, int joint) const;
+    double getContactShift(int point, int contact, int contact_point) const;
+
+    // largest constraint value of the evaluated trajectory
+    double computeViolation(const NewEvalManager* evaluation_manager) const;
+    // multiplier update from the evaluated trajectory. returns the violation
+    double update(const NewEvalManager* evaluation_manager);
+
+private:
+    void computeConstraintValues(const NewEvalManager* evaluation_manager,
+                                 Eigen::MatrixXd& physics_values, Eigen::MatrixXd& contact_values) const;
+
+    Eigen::MatrixXd physics_shifts_; // (point, root joint)
+    Eigen::MatrixXd contact_shifts_; // (point, contact * NUM_ENDEFFECTOR_CONTACT_POINTS + contact point)
+    double penalty_scale_;
+    double last_violation_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline double AugmentedLagrangian::getPenaltyScale() const
+{
+    return penalty_scale_;
+}
+
+inline double AugmentedLagrangian::getPhysicsShift(int point, int joint) const
+{
+    return physics_shifts_(point, joint);
+}
+
+inline double AugmentedLagrangian::getContactShift(int point, int contact, int contact_point) const
+{
+    return contact_shifts_(point, contact * NUM_ENDEFFECTOR_CONTACT_POINTS + contact_point);
+}
+
+}
+
+#endif /* AUGMENTED_LAGRANGIAN_H_ */
@@ -0,0 +1,106 @@
+#ifndef CROWD_MANAGER_H_
+#define CROWD_MANAGER_H_
+
+#include <itomp_cio_planner/common.h>
+#include <itomp_cio_planner/trajectory/element_trajectory.h>
+#include <moveit_msgs/Constraints.h>
+#include <stdint.h>
+
+namespace itomp_cio_planner
+{
+
+/**
+ * \brief Root positions of the agents of a crowd and a time-indexed spatial hash over them.
+ *
+ * For each trajectory point, the agents are sorted by their grid cell so that
+ * the neighbors of an agent are found in the 3x3 cells around it.
+ * The cell size is the largest agent diameter.
+ */
+class CrowdManager : public Singleton<CrowdManager>
+{
+public:
+    CrowdManager();
+    virtual ~CrowdManager();
+
+    void initialize(int num_agents, int num_points, bool batch_mode);
+    // agent 0 is the planning agent itself
+    void initializeFromConstraints(const std::vector<moveit_msgs::Constraints>& neighbors, int num_points);
+
+    void setAgentRadius(int agent, double radius);
+    void setAgentPosition(int agent, int point, double x, double y);
+    void setAgentTrajectory(int agent, const ElementTrajectoryConstPtr& joint_trajectory);
+
+    void buildSpatialHash();
+
+    double computeNeighborCost(int agent, int point, double x, double y) const;
+    double computeNeighborCostBruteForce(int agent, int point, double x, double y) const;
+
+    int getNumAgents() const;
+    bool isBatchMode() const;
+    bool hasNeighbors() const;
+    int getCurrentAgent() const;
+    void setCurrentAgent(int agent);
+
+    static void runSyntheticBenchmark(int num_agents, int num_points);
+
+private:
+    uint64_t getCellKey(int ix, int iy) const;
+    int getCellCoordinate(double x) const;
+    double computePairCost(int agent, int point, double x, double y, int neighbor) const;
+
+    int num_agents_;
+    int num_points_;
+    bool batch_mode_;
+    int current_agent_;
+    double cell_size_;
+
+    // num_points x num_agents. negative radius means the agent is inactive at the point
+    Eigen::MatrixXd positions_x_;
+    Eigen::MatrixXd positions_y_;
+    Eigen::MatrixXd radii_;
+
+    // sorted (cell key, agent) pairs of each point
+    std::vector<std::vector<std::pair<uint64_t, int> > > cells_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline int CrowdManager::getNumAgents() const
+{
+    return num_agents_;
+}
+
+inline bool CrowdManager::isBatchMode() const
+{
+    return batch_mode_;
+}
+
+inline bool CrowdManager::hasNeighbors() const
+{
+    return num_agents_ > 1;
+}
+
+inline int CrowdManager::getCurrentAgent() const
+{
+    return current_agent_;
+}
+
+inline void CrowdManager::setCurrentAgent(int agent)
+{
+    current_agent_ = agent;
+}
+
+inline uint64_t CrowdManager::getCellKey(int ix, int iy) const
+{
+    // order-preserving mapping of signed coordinates
+    return ((uint64_t) ((uint32_t) ix ^ 0x80000000u) << 32) | (uint64_t) ((uint32_t) iy ^ 0x80000000u);
+}
+
+inline int CrowdManager::getCellCoordinate(double x) const
+{
+    return (int) std::floor(x / cell_size_);
+}
+
+}
+
+#endif /* CROWD_MANAGER_H_ */
@@ -3,6 +3,7 @@
 
 #include <itomp_cio_planner/common.h>
 #include <itomp_cio_planner/optimization/new_eval_manager.h>
+#include <itomp_cio_planner/optimization/phase_convergence_monitor.h>
 
 namespace itomp_cio_planner
 {
@@ -18,14 +19,29 @@ public:
 	virtual bool updatePlanningParameters();
 	virtual void runSingleIteration(int iteration) = 0;
 
+	PhaseConvergenceMonitor& getConvergenceMonitor();
+
 protected:
+	// box constraints of the trajectory parameters
+	void computeParameterBounds(ItompTrajectory::ParameterVector& x_lower, ItompTrajectory::ParameterVector& x_upper) const;
+	void writeTrajectory(int iteration) const;
+	// logs and resets the ground projection cache statistics of the evaluation managers of the phase
+	void printGroundProjectionCacheStatistics(const std::vector<NewEvalManagerPtr>& derivatives_evaluation_managers);
+
 	NewEvalManagerPtr evaluation_manager_;
 	ItompPlanningGroupConstPtr planning_group_;
 
 	int last_planning_parameter_index_;
+
+	PhaseConvergenceMonitor convergence_monitor_;
 };
 ITOMP_DEFINE_SHARED_POINTERS(ImprovementManager);
 
+inline PhaseConvergenceMonitor& ImprovementManager::getConvergenceMonitor()
+{
+	return convergence_monitor_;
+}
+
 }
 ;
 
@@ -0,0 +1,64 @@
+#ifndef IMPROVEMENT_MANAGER_GAUSS_NEWTON_H_
+#define IMPROVEMENT_MANAGER_GAUSS_NEWTON_H_
+
+#include <itomp_cio_planner/optimization/improvement_manager.h>
+#include <itomp_cio_planner/common.h>
+#include <itomp_cio_planner/optimization/new_eval_manager.h>
+#include <itomp_cio_planner/util/banded_cholesky.h>
+
+namespace itomp_cio_planner
+{
+
+// Levenberg-Marquardt over the cost residuals of the trajectory points.
+// A keyframe parameter changes only the points between its neighboring keyframes,
+// so each Jacobian column is a block of those points from one partial evaluation, and with the parameters
+// ordered by keyframe the normal equations J^T J are banded and solved by a banded Cholesky factorization.
+class ImprovementManagerGaussNewton: public ImprovementManager
+{
+public:
+	ImprovementManagerGaussNewton();
+	virtual ~ImprovementManagerGaussNewton();
+
+	virtual void initialize(const NewEvalManagerPtr& evaluation_manager, const ItompPlanningGroupConstPtr& planning_group);
+	virtual bool updatePlanningParameters();
+	virtual void runSingleIteration(int iteration);
+
+protected:
+	void optimize(int iteration, ItompTrajectory::ParameterVector& variables);
+
+	double evaluate(const ItompTrajectory::ParameterVector& variables);
+	void computeParameterOrder();
+	void computeJacobian(const ItompTrajectory::ParameterVector& variables);
+	void computeNormalEquations();
+
+	void benchmarkLBFGS(int iteration, ItompTrajectory::ParameterVector& variables, int num_trials);
+
+	int num_threads_;
+	std::vector<NewEvalManagerPtr> derivatives_evaluation_manager_;
+
+	double eps_;
+	double damping_;
+
+	ros::Time start_time_;
+	int evaluation_count_;
+	int derivative_count_;
+
+	// optimized parameters, ordered by keyframe
+	std::vector<int> parameter_order_;
+
+	Eigen::MatrixXd residual_matrix_;
+	// column i of the Jacobian is jacobian_blocks_[i] at the points [jacobian_point_begin_[i], jacobian_point_end_[i])
+	std::vector<Eigen::MatrixXd> jacobian_blocks_;
+	std::vector<unsigned int> jacobian_point_begin_;
+	std::vector<unsigned int> jacobian_point_end_;
+
+	BandedCholesky normal_matrix_;
+	Eigen::VectorXd gradient_;
+
+	ImprovementManagerPtr lbfgs_benchmark_manager_;
+};
+
+}
+;
+
+#endif
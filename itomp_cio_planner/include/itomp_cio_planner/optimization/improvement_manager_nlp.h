@@ -11,6 +11,8 @@ namespace itomp_cio_planner
 
 typedef dlib::matrix<double, 0, 1> column_vector;
 
+ITOMP_FORWARD_DECL(ImprovementManagerNLP)
+
 class ImprovementManagerNLP: public ImprovementManager
 {
 public:
@@ -29,9 +31,27 @@ protected:
 	column_vector derivative_ref(const column_vector& variables);
 
 	void optimize(int iteration, column_vector& variables);
+	// iteration budget of the current phase
+	int getMaxIterations() const;
+	template <typename StopStrategy>
+	void findMin(StopStrategy stop_strategy, column_vector& variables, const column_vector& x_lower, const column_vector& x_upper);
+
+	// diagonal preconditioning: dlib optimizes x / variable_scales_
+	void computeVariableScales(const column_vector& variables, const column_vector& x_lower, const column_vector& x_upper);
+	double evaluateScaled(const column_vector& scaled_variables);
+	column_vector derivativeScaled(const column_vector& scaled_variables);
 
     void computeEvaluationOrder(long variable_size);
 
+    // time window decomposition: overlapping windows of keyframe points are optimized concurrently
+    // by window managers, and the parameters shared by several windows are averaged (consensus)
+    bool useTimeWindows() const;
+    void optimizeTimeWindows(int iteration, column_vector& variables);
+    void initializeTimeWindow(const NewEvalManagerPtr& evaluation_manager, const ItompPlanningGroupConstPtr& planning_group,
+                              int point_begin, int point_end);
+    void optimizeTimeWindow(column_vector& variables);
+    bool isTimeWindowParameter(long parameter_index) const;
+
 	int num_threads_;
 	std::vector<NewEvalManagerPtr> derivatives_evaluation_manager_;
 
@@ -44,8 +64,16 @@ protected:
 
 	ros::Time start_time_;
 	int evaluation_count_;
+	int derivative_count_;
 
     std::vector<long> evaluation_order_;
+
+    column_vector variable_scales_; // empty if not preconditioned
+
+    std::vector<ImprovementManagerNLPPtr> time_window_managers_;
+    // keyframe points [begin, end) optimized by a window manager. end is 0 if this is not a window manager
+    int time_window_point_begin_;
+    int time_window_point_end_;
 };
 
 }
@@ -23,7 +23,11 @@ public:
                    const std::vector<moveit_msgs::Constraints>& trajectory_constraints);
 	virtual ~ItompOptimizer();
 
-	bool optimize();
+	static const int NUM_PHASES = 5;
+
+	// runs the phases [first_phase, num_phases). first_phase > 0 refines the current trajectory,
+	// which is not reinterpolated after phase 0
+	bool optimize(int num_phases = NUM_PHASES, int first_phase = 0);
 
 	const PlanningInfo& getPlanningInfo() const;
 
@@ -36,6 +40,7 @@ private:
                     const std::vector<moveit_msgs::Constraints>& trajectory_constraints);
 
 	bool updateBestTrajectory();
+	void runAugmentedLagrangian();
 
 	int trajectory_index_;
 	double planning_start_time_;
@@ -5,6 +5,8 @@
 #include <itomp_cio_planner/model/itomp_robot_model.h>
 #include <itomp_cio_planner/trajectory/itomp_trajectory.h>
 #include <itomp_cio_planner/contact/contact_variables.h>
+#include <itomp_cio_planner/contact/ground_projection_cache.h>
+#include <itomp_cio_planner/contact/contact_force_solver.h>
 #include <kdl/frames.hpp>
 #include <kdl/jntarray.hpp>
 #include <ros/publisher.h>
@@ -32,10 +34,27 @@ public:
 					const ItompPlanningGroupConstPtr& planning_group,
 					double planning_start_time, double trajectory_start_time,
                     const std::vector<moveit_msgs::Constraints>& trajectory_constraints);
+    // runs the benchmarks enabled by the *_benchmark_num_trials parameters on the current trajectory.
+    // used by the benchmark_evaluation tool. the planner does not run them
+    void runBenchmarks();
 
     const ItompTrajectoryConstPtr& getTrajectory() const;
     ItompTrajectoryPtr& getTrajectoryNonConst();
 
+    // the partial evaluations of the copies of this manager restore the unchanged points from it
+    // instead of from the first created manager
+    void setAsReference();
+    // points of the full evaluations. the costs of the other points keep their last values
+    void setEvaluationRange(int point_begin, int point_end);
+
+    // adaptive discretization: evaluates the start, goal and keyframe points and the points of high accelerations
+    // and contact activation changes of the current trajectory, weighted by the intervals they stand for
+    void adaptDiscretization();
+    void resetDiscretization();
+    // cost weight of the point in trajectory discretization intervals. 0 if the point is not evaluated
+    double getPointWeight(int point) const;
+    bool isPointEvaluated(int point) const;
+
     void getParameters(ItompTrajectory::ParameterVector& parameters) const;
     void setParameters(const ItompTrajectory::ParameterVector& parameters);
 
@@ -47,7 +66,18 @@ public:
     void computeCostDerivatives(int parameter_index, const ItompTrajectory::ParameterVector& parameters,
                             double* derivative_out, std::vector<double*>& cost_derivative_out, double eps);
 
+    // residuals of the active costs (see TrajectoryCost::evaluateResiduals) scaled by the square roots of the cost weights,
+    // residual_matrix(point, r) for the getNumPointResiduals() residuals of each point. returns the trajectory cost
+    int getNumPointResiduals() const;
+    double evaluateResiduals(Eigen::MatrixXd& residual_matrix);
+    // central differences of the residuals of the points [point_begin, point_end) changed by the parameter.
+    // derivatives(point - point_begin, r)
+    void computeResidualDerivatives(int parameter_index, const ItompTrajectory::ParameterVector& parameters,
+                                    Eigen::MatrixXd& derivatives, unsigned int& point_begin, unsigned int& point_end, double eps);
+
 	bool isLastTrajectoryFeasible() const;
+	// number of full evaluations
+	int getNumEvaluations() const;
 	double getTrajectoryCost() const;
 	void printTrajectoryCost(int iteration, bool details = false);
     void resetBestTrajectoryCost();
@@ -64,9 +94,15 @@ public:
 
     const CollisionWorldFCLDerivativesPtr& getCollisionWorldFCLDerivatives() const;
     const CollisionRobotFCLDerivativesPtr& getCollisionRobotFCLDerivatives() const;
+    // world contacts of the point computed by the batched obstacle queries of the last full evaluation.
+    // NULL if the point has changed since then
+    const collision_detection::CollisionResult* getBatchedObstacleResult(int point) const;
 
     void printLinkTransforms() const;
 
+    const GroundProjectionCache& getGroundProjectionCache() const;
+    void resetGroundProjectionCacheStatistics();
+
 private:
 	void initializeContactVariables();
     void correctContacts(bool update_kinematics = true);
@@ -74,8 +110,35 @@ private:
 
 	void performFullForwardKinematicsAndDynamics(int point_begin, int point_end);
     void performPartialForwardKinematicsAndDynamics(int point_begin, int point_end, const ItompTrajectoryIndex& index);
+    void restoreRBDLModel(int point);
+    void invalidateRBDLModelStates();
+
+    void initializeRootBodyIds();
+    int getDynamicsFidelity() const;
+    void compareDynamicsFidelities(int num_trials);
+
+    void updateSweptBroadphase(int point_begin, int point_end, bool force = false);
+    void benchmarkSweptBroadphase(int num_trials);
+
+    void benchmarkConvexDecompositions(int num_trials);
+    void benchmarkGJKWarmStart(int num_trials);
 
+    bool updateBatchedObstacleQueries(int point_begin, int point_end, bool force = false);
+    void invalidateBatchedObstacleQueries(int point_begin, int point_end);
+    void benchmarkBatchedObstacleQueries(int num_trials);
+
+    void changeParameterPoint(double value, int parameter_index, unsigned int& point_begin, unsigned int& point_end, bool first);
+    void updateCollisionQueries(int point_begin, int point_end, const ItompTrajectoryIndex& index);
     bool evaluatePointRange(int point_begin, int point_end, Eigen::MatrixXd& cost_matrix, const ItompTrajectoryIndex& index);
+    // index is NULL for a full evaluation
+    void evaluatePointRangeResiduals(int point_begin, int point_end, Eigen::MatrixXd& residual_matrix, const ItompTrajectoryIndex* index);
+
+    void benchmarkAdaptiveDiscretization(int num_trials);
+
+    void initializeExternalWrenches();
+    void applyExternalWrenches(int point);
+    bool isContactForceSolveActive() const;
+    void solveContactForces(int point, const Eigen::VectorXd& q, const Eigen::VectorXd& q_dot, const Eigen::VectorXd& q_ddot);
 
     void computePassiveForces(int point,
                               const RigidBodyDynamics::Math::VectorNd &q,
@@ -94,17 +157,55 @@ private:
 	double trajectory_start_time_;
 	bool last_trajectory_feasible_;
     double best_cost_;
+    int num_evaluations_;
+    int evaluation_point_begin_;
+    int evaluation_point_end_;
+    std::vector<double> point_weights_; // the weights of the reference manager are used
 
 	std::vector<RigidBodyDynamics::Model> rbdl_models_;
     std::vector<Eigen::VectorXd> joint_torques_; // computed from inverse dynamics
 	std::vector<std::vector<RigidBodyDynamics::Math::SpatialVector> > external_forces_;
 	std::vector<std::vector<ContactVariables> > contact_variables_;
+    std::vector<double> passive_forces_;
+
+    // external wrench schedule. (torque, force) of each body at each point
+    std::vector<unsigned int> external_wrench_body_ids_;
+    Eigen::MatrixXd external_wrench_values_;
+
+    GroundProjectionCache ground_projection_cache_;
+    ContactForceSolver contact_force_solver_;
+
+    // what partial FK changed in rbdl_models_ w.r.t. the reference manager, so that only those bodies are restored
+    enum RBDL_MODEL_STATE
+    {
+        RBDL_MODEL_STATE_STALE = 0,
+        RBDL_MODEL_STATE_FORCES_MODIFIED,
+        RBDL_MODEL_STATE_SUBTREE_MODIFIED,
+    };
+    std::vector<int> rbdl_model_states_;
+    std::vector<const ItompRobotJoint*> rbdl_model_modified_joints_;
+
+    // when only the root joint torques are used (physics violation cost without torque cost),
+    // they are computed from the momentum rate of the whole body instead of the full RNEA (see DYNAMICS_FIDELITY).
+    // rbdl_models_[point].f then holds the momentum rate of each body in base coordinates
+    std::vector<unsigned int> root_body_ids_; // bodies of the 6 floating root dofs. empty if the root is fixed
+    std::vector<RigidBodyDynamics::Math::SpatialVector> root_momentum_rates_;
+
+    // convex pieces replacing the world object meshes in collision_world_derivatives_
+    std::map<std::string, ConvexDecompositionConstPtr> convex_decompositions_;
+
+    // world contacts of each point from one multi-pose BVH traversal per robot collision object
+    std::vector<collision_detection::CollisionResult> batched_obstacle_results_;
+    std::vector<char> batched_obstacle_result_valid_;
 
 	Eigen::MatrixXd evaluation_cost_matrix_;
+    Eigen::MatrixXd residual_matrix_plus_;
+    Eigen::MatrixXd residual_matrix_minus_;
 
     std::vector<moveit_msgs::Constraints> trajectory_constraints_;
 
     static const NewEvalManager* ref_evaluation_manager_;
+    const NewEvalManager* reference_manager_;
 
     // non-shared pointer members
     //FullTrajectoryPtr full_trajectory_;
@@ -118,6 +219,8 @@ private:
     CollisionRobotFCLDerivativesPtr collision_robot_derivatives_;
 
     friend class ItompOptimizer;
+    friend class ItompPlannerNode;
+    friend class AugmentedLagrangian;
 
 	friend class TrajectoryCostContactInvariant;
 	friend class TrajectoryCostObstacle;
@@ -128,6 +231,7 @@ private:
 	friend class TrajectoryCostCOM;
 	friend class TrajectoryCostEndeffectorVelocity;
 	friend class TrajectoryCostROM;
+	friend class TrajectoryCostRVO;
 };
 ITOMP_DEFINE_SHARED_POINTERS(NewEvalManager)
 
@@ -148,6 +252,11 @@ inline bool NewEvalManager::isLastTrajectoryFeasible() const
 	return last_trajectory_feasible_;
 }
 
+inline int NewEvalManager::getNumEvaluations() const
+{
+    return num_evaluations_;
+}
+
 inline double NewEvalManager::getTrajectoryCost() const
 {
 	return evaluation_cost_matrix_.sum();
@@ -188,6 +297,31 @@ inline const CollisionRobotFCLDerivativesPtr& NewEvalManager::getCollisionRobotF
     return collision_robot_derivatives_;
 }
 
+inline double NewEvalManager::getPointWeight(int point) const
+{
+    return reference_manager_->point_weights_[point];
+}
+
+inline bool NewEvalManager::isPointEvaluated(int point) const
+{
+    return reference_manager_->point_weights_[point] > 0.0;
+}
+
+inline const collision_detection::CollisionResult* NewEvalManager::getBatchedObstacleResult(int point) const
+{
+    return batched_obstacle_result_valid_[point] ? &batched_obstacle_results_[point] : NULL;
+}
+
+inline const GroundProjectionCache& NewEvalManager::getGroundProjectionCache() const
+{
+    return ground_projection_cache_;
+}
+
+inline void NewEvalManager::resetGroundProjectionCacheStatistics()
+{
+    ground_projection_cache_.resetStatistics();
+}
+
 }
 
 #endif
@@ -0,0 +1,100 @@
+#ifndef PHASE_CONVERGENCE_MONITOR_H_
+#define PHASE_CONVERGENCE_MONITOR_H_
+
+#include <itomp_cio_planner/common.h>
+#include <itomp_cio_planner/trajectory/itomp_trajectory.h>
+#include <itomp_cio_planner/optimization/new_eval_manager.h>
+
+namespace itomp_cio_planner
+{
+
+// Stops the optimization of a phase when it has converged instead of after a fixed iteration budget.
+// A phase has converged when the relative cost decrease stays below a threshold for some iterations,
+// or the gradient projected on the box constraints vanishes, and (for the phases > 2 without
+// the augmented Lagrangian) the contact and dynamics constraint violation is within the tolerance.
+// The iteration cap is the fixed budget times phase_convergence_max_iterations_factor.
+class PhaseConvergenceMonitor
+{
+public:
+    PhaseConvergenceMonitor();
+
+    void begin(int fixed_max_iterations, const NewEvalManager* evaluation_manager,
+               const ItompTrajectory::ParameterVector& x_lower, const ItompTrajectory::ParameterVector& x_upper);
+    // cost and gradient at the current iterate. returns false when the optimization should stop
+    bool update(const ItompTrajectory::ParameterVector& variables, double cost, const ItompTrajectory::ParameterVector& gradient);
+    void end();
+
+    // phase optimized in time windows, each window with its own monitor. the phase has converged when
+    // all windows have converged in the last consensus iteration. cost is the cost of the consensus
+    void beginTimeWindows(int fixed_max_iterations, double cost);
+    void updateTimeWindows(const std::vector<const PhaseConvergenceMonitor*>& window_monitors, double cost);
+
+    bool isConverged() const;
+    int getNumIterations() const;
+    int getMaxIterations() const;
+    // cost decrease of the phase relative to its initial cost
+    double getPhaseRelativeDecrease() const;
+    double getConstraintViolation() const;
+
+    // iterations of all phases since the last reset, and the fixed budgets of those phases
+    void resetStatistics();
+    int getTotalIterations() const;
+    int getTotalFixedIterations() const;
+
+private:
+    const NewEvalManager* evaluation_manager_;
+    ItompTrajectory::ParameterVector x_lower_;
+    ItompTrajectory::ParameterVector x_upper_;
+    bool check_constraints_;
+
+    int fixed_max_iterations_;
+    int max_iterations_;
+    int num_iterations_;
+    int num_stalled_iterations_;
+    bool converged_;
+
+    double initial_cost_;
+    double last_cost_;
+    double relative_decrease_;
+    double projected_gradient_norm_;
+    double constraint_violation_;
+
+    int total_iterations_;
+    int total_fixed_iterations_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline bool PhaseConvergenceMonitor::isConverged() const
+{
+    return converged_;
+}
+
+inline int PhaseConvergenceMonitor::getNumIterations() const
+{
+    return num_iterations_;
+}
+
+inline int PhaseConvergenceMonitor::getMaxIterations() const
+{
+    return max_iterations_;
+}
+
+inline double PhaseConvergenceMonitor::getConstraintViolation() const
+{
+    return constraint_violation_;
+}
+
+inline int PhaseConvergenceMonitor::getTotalIterations() const
+{
+    return total_iterations_;
+}
+
+inline int PhaseConvergenceMonitor::getTotalFixedIterations() const
+{
+    return total_fixed_iterations_;
+}
+
+}
+
+#endif /* PHASE_CONVERGENCE_MONITOR_H_ */
@@ -20,6 +20,10 @@ public:
 
     bool updateParameter(const ItompTrajectoryIndex& index) const;
 
+    // the contact forces are solved in each evaluation instead of being optimized
+    bool getContactForcesSolved() const;
+    void setContactForcesSolved(bool solved);
+
     int agent_id_;
     int support_foot_;
     Eigen::Vector3d initial_goal_pos;
@@ -28,6 +32,7 @@ private:
     unsigned int phase_;
     int num_points_;
     ItompPlanningGroupConstPtr planning_group_;
+    bool contact_forces_solved_;
 };
 
 inline unsigned int PhaseManager::getPhase() const
@@ -40,6 +45,16 @@ inline void PhaseManager::setPhase(unsigned int phase)
     phase_ = phase;
 }
 
+inline bool PhaseManager::getContactForcesSolved() const
+{
+    return contact_forces_solved_;
+}
+
+inline void PhaseManager::setContactForcesSolved(bool solved)
+{
+    contact_forces_solved_ = solved;
+}
+
 }
 
 #endif
@@ -32,7 +32,29 @@ public:
                         const planning_interface::MotionPlanRequest &req,
                         planning_interface::MotionPlanResponse &res);
 
+    /**
+     * \brief Plans the trajectories of multiple agents in one session.
+     *
+     * Agents are optimized in turn for crowd_num_rounds rounds.
+     * The RVO cost of each agent uses the latest trajectories of the other agents.
+     * The rounds after the first one refine the trajectories of the last round from phase 1.
+     */
+    bool planTrajectories(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                          const std::vector<planning_interface::MotionPlanRequest>& reqs,
+                          std::vector<planning_interface::MotionPlanResponse>& res);
+
 private:
+    // loads what is kept across the requests (ROM files, OpenMP threads) and runs the stages of a dummy request,
+    // so that the first request sees the steady-state latency
+    void prewarm();
+
+    // evaluates the first goal_candidates goal constraints of req concurrently, runs the first goal_candidate_screening_phases
+    // phases on the goal_candidate_survivors best ones, and returns the index of the best one. the others are not optimized further
+    int selectGoalCandidate(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                            const planning_interface::MotionPlanRequest &req,
+                            const ItompPlanningGroupConstPtr& planning_group,
+                            double trajectory_start_time);
+
 	bool validateRequest(const planning_interface::MotionPlanRequest &req);
     std::vector<std::string> getPlanningGroups(const std::string& group_name) const;
     void fillInResult(const robot_state::RobotStatePtr& robot_state,
@@ -55,6 +77,7 @@ private:
     ItompTrajectoryPtr itomp_trajectory_;
 	ItompOptimizerPtr optimizer_;
 	PlanningInfoManager planning_info_manager_;
+    bool is_first_request_;
 };
 ITOMP_DEFINE_SHARED_POINTERS(ItompPlannerNode)
 
@@ -88,8 +88,7 @@ public:
     int getParameterJointIndex(int trajectory_index) const;
 
     double getDiscretization() const;
-
-    bool avoidNeighbors(const std::vector<moveit_msgs::Constraints>& neighbors);
+    unsigned int getKeyframeInterval() const;
 
     int getNumJoints() const;
     unsigned int getNumParameters() const;
@@ -97,6 +96,20 @@ public:
     bool setJointPositions(Eigen::VectorXd& trajectory_data, const ParameterVector& parameters, int point) const;
     void getJointPositions(ParameterVector& parameters, const Eigen::VectorXd& trajectory_data, int point) const;
 
+    /**
+     * \brief Writes the parameters and all element trajectories in the binary trajectory file format.
+     * Values are stored bit-exact in little-endian byte order.
+     */
+    bool writeTrajectoryFile(const std::string& file_name) const;
+    /**
+     * \brief Restores the element trajectories from a binary trajectory file.
+     */
+    bool readTrajectoryFile(const std::string& file_name);
+    /**
+     * \brief Reads only the parameter vector of a binary trajectory file.
+     */
+    bool readTrajectoryFileParameters(const std::string& file_name, ParameterVector& parameters) const;
+
 protected:
     ItompTrajectory(const std::string& name, unsigned int num_points, const std::vector<NewTrajectoryPtr>& components,
                     unsigned int num_keyframes, unsigned int keyframe_interval, double duration, double discretization);
@@ -106,6 +119,7 @@ protected:
     void interpolateInputJointTrajectory(const std::vector<unsigned int>& group_rbdl_indices,
                                          const ItompPlanningGroupConstPtr& planning_group,
                                          const moveit_msgs::TrajectoryConstraints& trajectory_constraints);
+    bool readTrajectoryFile(const std::string& file_name, ParameterVector* parameters, ItompTrajectory* target) const;
 
     unsigned int num_keyframes_;
     unsigned int keyframe_interval_;
@@ -151,6 +165,11 @@ inline double ItompTrajectory::getDiscretization() const
     return discretization_;
 }
 
+inline unsigned int ItompTrajectory::getKeyframeInterval() const
+{
+    return keyframe_interval_;
+}
+
 inline void ItompTrajectory::interpolateStartEnd(SUB_COMPONENT_TYPE sub_component_type,
         const std::vector<unsigned int>* element_indices)
 {
@@ -0,0 +1,61 @@
+#ifndef BANDED_CHOLESKY_H_
+#define BANDED_CHOLESKY_H_
+
+#include <itomp_cio_planner/common.h>
+
+namespace itomp_cio_planner
+{
+
+// Symmetric positive definite matrix whose non-zero elements are within bandwidth of the diagonal,
+// factorized in place as L L^T. Only the lower band is stored, column by column:
+// element (row, col) at band_(row - col, col). O(n * bandwidth^2) factorization, O(n * bandwidth) solve.
+class BandedCholesky
+{
+public:
+    BandedCholesky();
+
+    // zero matrix
+    void resize(int size, int bandwidth);
+
+    int getSize() const;
+    int getBandwidth() const;
+
+    // element of the lower band (col <= row <= col + bandwidth)
+    double& coeffRef(int row, int col);
+    double coeff(int row, int col) const;
+
+    // false if the matrix is not positive definite
+    bool factorize();
+    // solves A x = b of the factorized matrix, in place
+    void solve(Eigen::VectorXd& x) const;
+
+private:
+    Eigen::MatrixXd band_;
+    int bandwidth_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline int BandedCholesky::getSize() const
+{
+    return band_.cols();
+}
+
+inline int BandedCholesky::getBandwidth() const
+{
+    return bandwidth_;
+}
+
+inline double& BandedCholesky::coeffRef(int row, int col)
+{
+    return band_(row - col, col);
+}
+
+inline double BandedCholesky::coeff(int row, int col) const
+{
+    return band_(row - col, col);
+}
+
+}
+
+#endif /* BANDED_CHOLESKY_H_ */
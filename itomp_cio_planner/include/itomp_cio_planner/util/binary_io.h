@@ -0,0 +1,111 @@
+#ifndef BINARY_IO_H_
+#define BINARY_IO_H_
+
+#include <itomp_cio_planner/common.h>
+#include <stdint.h>
+
+namespace itomp_cio_planner
+{
+
+// Binary files are always stored in little-endian byte order.
+
+class BinaryWriter
+{
+public:
+	BinaryWriter();
+
+	void reserve(std::size_t size);
+
+	void writeBytes(const void* data, std::size_t size);
+	void writeUInt32(uint32_t value);
+	void writeUInt64(uint64_t value);
+	void writeDouble(double value);
+	void writeDoubles(const double* values, std::size_t count);
+	void writeString(const std::string& str);
+
+	bool writeToFile(const std::string& file_name) const;
+
+	const std::vector<char>& getBuffer() const;
+
+private:
+	std::vector<char> buffer_;
+};
+
+// read-only memory mapped file
+class MappedFile
+{
+public:
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string& file_name);
+	void close();
+
+	bool isOpen() const;
+	const char* getData() const;
+	std::size_t getSize() const;
+
+private:
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+
+	int fd_;
+	void* data_;
+	std::size_t size_;
+};
+
+class BinaryReader
+{
+public:
+	BinaryReader(const char* data, std::size_t size);
+
+	bool readBytes(void* data, std::size_t size);
+	bool readUInt32(uint32_t& value);
+	bool readUInt64(uint64_t& value);
+	bool readDouble(double& value);
+	bool readDoubles(double* values, std::size_t count);
+	bool readString(std::string& str);
+
+	std::size_t getRemaining() const;
+
+private:
+	const char* data_;
+	std::size_t size_;
+	std::size_t offset_;
+};
+
+/////////////////////// inline functions follow ////////////////////////
+
+inline void BinaryWriter::reserve(std::size_t size)
+{
+	buffer_.reserve(size);
+}
+
+inline const std::vector<char>& BinaryWriter::getBuffer() const
+{
+	return buffer_;
+}
+
+inline bool MappedFile::isOpen() const
+{
+	return data_ != NULL;
+}
+
+inline const char* MappedFile::getData() const
+{
+	return static_cast<const char*>(data_);
+}
+
+inline std::size_t MappedFile::getSize() const
+{
+	return size_;
+}
+
+inline std::size_t BinaryReader::getRemaining() const
+{
+	return size_ - offset_;
+}
+
+}
+
+#endif /* BINARY_IO_H_ */
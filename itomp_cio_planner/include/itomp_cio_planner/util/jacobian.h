@@ -41,10 +41,14 @@ public:
 
 	// temporary
 	static void GetProjection(int point, const Eigen::VectorXd& q, Eigen::VectorXd& a);
-    static void projectToNullSpace(const dlib::matrix<double, 0, 1>& x, dlib::matrix<double, 0, 1>& s);
+    // projects the step (or the gradient) s at the variables x of the optimizer
+    static void projectToNullSpace(const dlib::matrix<double, 0, 1>& x, dlib::matrix<double, 0, 1>& s, bool is_gradient = false);
+    // the optimizer of the calling thread works on the scaled variables x / scales. NULL if not preconditioned
+    static void setVariableScales(const dlib::matrix<double, 0, 1>* scales);
 
 private:
 	void ComputeSVD();
+	static void projectJointPositionsToNullSpace(const dlib::matrix<double, 0, 1>& x, dlib::matrix<double, 0, 1>& s);
 
 private:
 	bool computeInverse_;
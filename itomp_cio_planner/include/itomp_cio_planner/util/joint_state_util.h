@@ -10,9 +10,11 @@ namespace itomp_cio_planner
 sensor_msgs::JointState jointConstraintsToJointState(
 	const std::vector<moveit_msgs::Constraints> &constraints);
 
+// goal state of the goal constraints goal_index of req. goal_index -1 merges all the goal constraints
 sensor_msgs::JointState getGoalStateFromGoalConstraints(
 	const ItompRobotModelConstPtr& itomp_robot_model,
-	const planning_interface::MotionPlanRequest &req);
+	const planning_interface::MotionPlanRequest &req,
+	int goal_index = -1);
 
 void jointStateToArray(const ItompRobotModelConstPtr& itomp_robot_model,
 					   const sensor_msgs::JointState &joint_state,
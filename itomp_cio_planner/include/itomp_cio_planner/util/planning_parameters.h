@@ -13,6 +13,27 @@
 namespace itomp_cio_planner
 {
 
+// external wrench applied to a body during [start_time_, end_time_]
+// wrenches are (torque, force) in the world frame, linearly interpolated from wrench_ to end_wrench_
+struct ExternalWrench
+{
+	std::string body_name_;
+	double start_time_;
+	double end_time_;
+	std::vector<double> wrench_;
+	std::vector<double> end_wrench_;
+};
+
+// how the dynamics is evaluated in a phase. reduced fidelities compute only the unactuated root torques,
+// so they are used only while the torque cost is inactive
+enum DYNAMICS_FIDELITY
+{
+	DYNAMICS_FIDELITY_FULL = 0, // rigid-body inverse dynamics of all joints
+	DYNAMICS_FIDELITY_ROOT_WRENCH, // exact root torques from the momentum rate of every body
+	DYNAMICS_FIDELITY_CENTROIDAL, // root torques from the composite inertia moving with the root body
+	DYNAMICS_FIDELITY_NUM,
+};
+
 class PlanningParameters: public Singleton<PlanningParameters>
 {
 public:
@@ -120,6 +141,81 @@ public:
 
     double getPassiveForceRatio() const;
 
+    const std::string& getRBDLModelCacheFile() const;
+
+    bool getExportTrajectoryText() const;
+    bool getExportPhaseTrajectories() const;
+
+    const std::vector<ExternalWrench>& getExternalWrenches() const;
+
+    double getAgentRadius() const;
+    int getCrowdNumRounds() const;
+    int getCrowdBenchmarkNumAgents() const;
+
+    int getIKBenchmarkNumSolves() const;
+    int getPartialFKBenchmarkNumTrials() const;
+
+    // configured fidelity of the phase, or the given fidelity if the phase has no entry
+    int getDynamicsFidelity(unsigned int phase, int unlisted_fidelity) const;
+    int getDynamicsFidelityBenchmarkNumTrials() const;
+
+    int getBroadphaseWindowSize() const;
+    double getBroadphaseWindowMargin() const;
+    int getBroadphaseBenchmarkNumTrials() const;
+
+    bool getConvexDecomposition() const;
+    const std::string& getConvexDecompositionCachePrefix() const;
+    double getConvexDecompositionMaxConcavity() const;
+    int getConvexDecompositionMaxPieces() const;
+    int getConvexDecompositionBenchmarkNumTrials() const;
+
+    const std::string& getVoxelEnvironment() const;
+    double getVoxelEnvironmentMaxDistance() const;
+    double getVoxelPlaneMinArea() const;
+
+    bool getGJKWarmStart() const;
+    int getGJKWarmStartBenchmarkNumTrials() const;
+
+    bool getBatchedObstacleQueries() const;
+    int getBatchedObstacleQueriesBenchmarkNumTrials() const;
+
+    bool getContactForceSolve() const;
+    int getContactForceSolveMaxIterations() const;
+    double getContactForceSolveRegularization() const;
+
+    bool getGaussNewton() const;
+    double getGaussNewtonDamping() const;
+    int getGaussNewtonBenchmarkNumTrials() const;
+
+    bool getAugmentedLagrangian() const;
+    int getAugmentedLagrangianMaxIterations() const;
+    double getAugmentedLagrangianPenaltyIncrease() const;
+    double getAugmentedLagrangianTolerance() const;
+
+    bool getDiagonalPreconditioning() const;
+
+    bool getPhaseConvergence() const;
+    double getPhaseConvergenceRelativeDecrease() const;
+    int getPhaseConvergenceNumStalledIterations() const;
+    double getPhaseConvergenceGradientNorm() const;
+    double getPhaseConvergenceConstraintViolation() const;
+    int getPhaseConvergenceMaxIterationsFactor() const;
+    int getTimeWindowSize() const;
+    int getTimeWindowOverlap() const;
+    int getTimeWindowConsensusIterations() const;
+    bool getAdaptiveDiscretization() const;
+    double getAdaptiveDiscretizationAccelerationRatio() const;
+    double getAdaptiveDiscretizationContactChange() const;
+    int getAdaptiveDiscretizationBenchmarkNumTrials() const;
+    bool getPrewarm() const;
+    const std::string& getPrewarmGroup() const;
+
+    bool getIncrementalCollisionWorld() const;
+
+    int getGoalCandidates() const;
+    int getGoalCandidateSurvivors() const;
+    int getGoalCandidateScreeningPhases() const;
+
 private:
 	int updateIndex;
 	double trajectory_duration_;
@@ -198,6 +294,80 @@ private:
 
     double passive_force_ratio_;
 
+    std::string rbdl_model_cache_file_;
+
+    bool export_trajectory_text_;
+    bool export_phase_trajectories_;
+
+    std::vector<ExternalWrench> external_wrenches_;
+
+    double agent_radius_;
+    int crowd_num_rounds_;
+    int crowd_benchmark_num_agents_;
+
+    int ik_benchmark_num_solves_;
+    int partial_fk_benchmark_num_trials_;
+
+    std::vector<int> dynamics_fidelity_;
+    int dynamics_fidelity_benchmark_num_trials_;
+
+    int broadphase_window_size_;
+    double broadphase_window_margin_;
+    int broadphase_benchmark_num_trials_;
+
+    bool convex_decomposition_;
+    std::string convex_decomposition_cache_prefix_;
+    double convex_decomposition_max_concavity_;
+    int convex_decomposition_max_pieces_;
+    int convex_decomposition_benchmark_num_trials_;
+
+    std::string voxel_environment_;
+    double voxel_environment_max_distance_;
+    double voxel_plane_min_area_;
+
+    bool gjk_warm_start_;
+    int gjk_warm_start_benchmark_num_trials_;
+
+    bool batched_obstacle_queries_;
+    int batched_obstacle_queries_benchmark_num_trials_;
+
+    bool contact_force_solve_;
+    int contact_force_solve_max_iterations_;
+    double contact_force_solve_regularization_;
+
+    bool gauss_newton_;
+    double gauss_newton_damping_;
+    int gauss_newton_benchmark_num_trials_;
+
+    bool augmented_lagrangian_;
+    int augmented_lagrangian_max_iterations_;
+    double augmented_lagrangian_penalty_increase_;
+    double augmented_lagrangian_tolerance_;
+
+    bool diagonal_preconditioning_;
+
+    bool phase_convergence_;
+    double phase_convergence_relative_decrease_;
+    int phase_convergence_num_stalled_iterations_;
+    double phase_convergence_gradient_norm_;
+    double phase_convergence_constraint_violation_;
+    int phase_convergence_max_iterations_factor_;
+    int time_window_size_;
+    int time_window_overlap_;
+    int time_window_consensus_iterations_;
+    bool adaptive_discretization_;
+    double adaptive_discretization_acceleration_ratio_;
+    double adaptive_discretization_contact_change_;
+    int adaptive_discretization_benchmark_num_trials_;
+    bool prewarm_;
+    std::string prewarm_group_;
+
+    bool incremental_collision_world_;
+
+    int goal_candidates_;
+    int goal_candidate_survivors_;
+    int goal_candidate_screening_phases_;
+
 	friend class Singleton<PlanningParameters> ;
 };
 
@@ -492,5 +662,287 @@ inline double PlanningParameters::getPassiveForceRatio() const
     return passive_force_ratio_;
 }
 
+inline const std::string& PlanningParameters::getRBDLModelCacheFile() const
+{
+    return rbdl_model_cache_file_;
+}
+
+inline bool PlanningParameters::getExportTrajectoryText() const
+{
+    return export_trajectory_text_;
+}
+
+inline bool PlanningParameters::getExportPhaseTrajectories() const
+{
+    return export_phase_trajectories_;
+}
+
+inline const std::vector<ExternalWrench>& PlanningParameters::getExternalWrenches() const
+{
+    return external_wrenches_;
+}
+
+inline double PlanningParameters::getAgentRadius() const
+{
+    return agent_radius_;
+}
+
+inline int PlanningParameters::getCrowdNumRounds() const
+{
+    return crowd_num_rounds_;
+}
+
+inline int PlanningParameters::getCrowdBenchmarkNumAgents() const
+{
+    return crowd_benchmark_num_agents_;
+}
+
+inline int PlanningParameters::getIKBenchmarkNumSolves() const
+{
+    return ik_benchmark_num_solves_;
+}
+
+inline int PlanningParameters::getPartialFKBenchmarkNumTrials() const
+{
+    return partial_fk_benchmark_num_trials_;
+}
+
+inline int PlanningParameters::getDynamicsFidelity(unsigned int phase, int unlisted_fidelity) const
+{
+    if (phase < dynamics_fidelity_.size())
+        return dynamics_fidelity_[phase];
+    return unlisted_fidelity;
+}
+
+inline int PlanningParameters::getDynamicsFidelityBenchmarkNumTrials() const
+{
+    return dynamics_fidelity_benchmark_num_trials_;
+}
+
+inline int PlanningParameters::getBroadphaseWindowSize() const
+{
+    return broadphase_window_size_;
+}
+
+inline double PlanningParameters::getBroadphaseWindowMargin() const
+{
+    return broadphase_window_margin_;
+}
+
+inline int PlanningParameters::getBroadphaseBenchmarkNumTrials() const
+{
+    return broadphase_benchmark_num_trials_;
+}
+
+inline bool PlanningParameters::getConvexDecomposition() const
+{
+    return convex_decomposition_;
+}
+
+inline const std::string& PlanningParameters::getConvexDecompositionCachePrefix() const
+{
+    return convex_decomposition_cache_prefix_;
+}
+
+inline double PlanningParameters::getConvexDecompositionMaxConcavity() const
+{
+    return convex_decomposition_max_concavity_;
+}
+
+inline int PlanningParameters::getConvexDecompositionMaxPieces() const
+{
+    return convex_decomposition_max_pieces_;
+}
+
+inline int PlanningParameters::getConvexDecompositionBenchmarkNumTrials() const
+{
+    return convex_decomposition_benchmark_num_trials_;
+}
+
+inline const std::string& PlanningParameters::getVoxelEnvironment() const
+{
+    return voxel_environment_;
+}
+
+inline double PlanningParameters::getVoxelEnvironmentMaxDistance() const
+{
+    return voxel_environment_max_distance_;
+}
+
+inline double PlanningParameters::getVoxelPlaneMinArea() const
+{
+    return voxel_plane_min_area_;
+}
+
+inline bool PlanningParameters::getGJKWarmStart() const
+{
+    return gjk_warm_start_;
+}
+
+inline int PlanningParameters::getGJKWarmStartBenchmarkNumTrials() const
+{
+    return gjk_warm_start_benchmark_num_trials_;
+}
+
+inline bool PlanningParameters::getBatchedObstacleQueries() const
+{
+    return batched_obstacle_queries_;
+}
+
+inline int PlanningParameters::getBatchedObstacleQueriesBenchmarkNumTrials() const
+{
+    return batched_obstacle_queries_benchmark_num_trials_;
+}
+
+inline bool PlanningParameters::getContactForceSolve() const
+{
+    return contact_force_solve_;
+}
+
+inline int PlanningParameters::getContactForceSolveMaxIterations() const
+{
+    return contact_force_solve_max_iterations_;
+}
+
+inline double PlanningParameters::getContactForceSolveRegularization() const
+{
+    return contact_force_solve_regularization_;
+}
+
+inline bool PlanningParameters::getGaussNewton() const
+{
+    return gauss_newton_;
+}
+
+inline double PlanningParameters::getGaussNewtonDamping() const
+{
+    return gauss_newton_damping_;
+}
+
+inline int PlanningParameters::getGaussNewtonBenchmarkNumTrials() const
+{
+    return gauss_newton_benchmark_num_trials_;
+}
+
+inline bool PlanningParameters::getAugmentedLagrangian() const
+{
+    return augmented_lagrangian_;
+}
+
+inline int PlanningParameters::getAugmentedLagrangianMaxIterations() const
+{
+    return augmented_lagrangian_max_iterations_;
+}
+
+inline double PlanningParameters::getAugmentedLagrangianPenaltyIncrease() const
+{
+    return augmented_lagrangian_penalty_increase_;
+}
+
+inline double PlanningParameters::getAugmentedLagrangianTolerance() const
+{
+    return augmented_lagrangian_tolerance_;
+}
+
+inline bool PlanningParameters::getDiagonalPreconditioning() const
+{
+    return diagonal_preconditioning_;
+}
+
+inline bool PlanningParameters::getPhaseConvergence() const
+{
+    return phase_convergence_;
+}
+
+inline double PlanningParameters::getPhaseConvergenceRelativeDecrease() const
+{
+    return phase_convergence_relative_decrease_;
+}
+
+inline int PlanningParameters::getPhaseConvergenceNumStalledIterations() const
+{
+    return phase_convergence_num_stalled_iterations_;
+}
+
+inline double PlanningParameters::getPhaseConvergenceGradientNorm() const
+{
+    return phase_convergence_gradient_norm_;
+}
+
+inline double PlanningParameters::getPhaseConvergenceConstraintViolation() const
+{
+    return phase_convergence_constraint_violation_;
+}
+
+inline int PlanningParameters::getPhaseConvergenceMaxIterationsFactor() const
+{
+    return phase_convergence_max_iterations_factor_;
+}
+
+inline int PlanningParameters::getTimeWindowSize() const
+{
+    return time_window_size_;
+}
+
+inline int PlanningParameters::getTimeWindowOverlap() const
+{
+    return time_window_overlap_;
+}
+
+inline int PlanningParameters::getTimeWindowConsensusIterations() const
+{
+    return time_window_consensus_iterations_;
+}
+
+inline bool PlanningParameters::getAdaptiveDiscretization() const
+{
+    return adaptive_discretization_;
+}
+
+inline double PlanningParameters::getAdaptiveDiscretizationAccelerationRatio() const
+{
+    return adaptive_discretization_acceleration_ratio_;
+}
+
+inline double PlanningParameters::getAdaptiveDiscretizationContactChange() const
+{
+    return adaptive_discretization_contact_change_;
+}
+
+inline int PlanningParameters::getAdaptiveDiscretizationBenchmarkNumTrials() const
+{
+    return adaptive_discretization_benchmark_num_trials_;
+}
+
+inline bool PlanningParameters::getPrewarm() const
+{
+    return prewarm_;
+}
+
+inline const std::string& PlanningParameters::getPrewarmGroup() const
+{
+    return prewarm_group_;
+}
+
+inline bool PlanningParameters::getIncrementalCollisionWorld() const
+{
+    return incremental_collision_world_;
+}
+
+inline int PlanningParameters::getGoalCandidates() const
+{
+    return goal_candidates_;
+}
+
+inline int PlanningParameters::getGoalCandidateSurvivors() const
+{
+    return goal_candidate_survivors_;
+}
+
+inline int PlanningParameters::getGoalCandidateScreeningPhases() const
+{
+    return goal_candidate_screening_phases_;
+}
+
 }
 #endif /* PLANNINGPARAMETERS_H_ */
@@ -28,6 +28,20 @@ void CollisionRobotFCLDerivatives::constructInternalFCLObject(const robot_state:
 
     manager_.manager_->clear();
     manager_.object_.registerTo(manager_.manager_.get());
+
+    clearGJKWarmStart();
+}
+
+void CollisionRobotFCLDerivatives::initializeGJKWarmStart(int num_points)
+{
+    gjk_guess_caches_.clear();
+    gjk_guess_caches_.resize(num_points);
+}
+
+void CollisionRobotFCLDerivatives::clearGJKWarmStart()
+{
+    for (std::size_t i = 0; i < gjk_guess_caches_.size(); ++i)
+        gjk_guess_caches_[i].clear();
 }
 
 void CollisionRobotFCLDerivatives::updateInternalFCLObjectTransforms(const robot_state::RobotState &state)
@@ -70,6 +84,44 @@ void CollisionRobotFCLDerivatives::updateInternalFCLObjectTransforms(const robot
     */
 }
 
+void CollisionRobotFCLDerivatives::computeInternalFCLObjectAABBs(const robot_state::RobotState &state, std::vector<fcl::AABB>& aabbs) const
+{
+    const FCLObject& fcl_obj = manager_.object_;
+    aabbs.resize(fcl_obj.collision_objects_.size());
+
+    // same bounds as fcl::CollisionObject::computeAABB for a rotated object
+    std::size_t index = 0;
+    for (std::size_t i = 0 ; i < geoms_.size() ; ++i)
+    {
+        if (geoms_[i] && geoms_[i]->collision_geometry_)
+        {
+            const fcl::CollisionGeometry* geometry = fcl_obj.collision_objects_[index]->collisionGeometry().get();
+            fcl::Transform3f transform = transform2fcl(state.getCollisionBodyTransform(geoms_[i]->collision_geometry_data_->ptr.link,
+                                         geoms_[i]->collision_geometry_data_->shape_index));
+            fcl::Vec3f center = transform.transform(geometry->aabb_center);
+            fcl::Vec3f delta(geometry->aabb_radius, geometry->aabb_radius, geometry->aabb_radius);
+            aabbs[index] = fcl::AABB(center - delta, center + delta);
+            ++index;
+        }
+    }
+}
+
+void CollisionRobotFCLDerivatives::computeInternalFCLObjectTransforms(const robot_state::RobotState &state, std::vector<fcl::Transform3f>& transforms) const
+{
+    transforms.resize(manager_.object_.collision_objects_.size());
+
+    std::size_t index = 0;
+    for (std::size_t i = 0 ; i < geoms_.size() ; ++i)
+    {
+        if (geoms_[i] && geoms_[i]->collision_geometry_)
+        {
+            transforms[index] = transform2fcl(state.getCollisionBodyTransform(geoms_[i]->collision_geometry_data_->ptr.link,
+                                              geoms_[i]->collision_geometry_data_->shape_index));
+            ++index;
+        }
+    }
+}
+
 
 void CollisionRobotFCLDerivatives::checkSelfCollision(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state) const
 {
@@ -82,6 +134,12 @@ void CollisionRobotFCLDerivatives::checkSelfCollision(const CollisionRequest &re
 	checkSelfCollisionDerivativesHelper(req, res, state, &acm);
 }
 
+void CollisionRobotFCLDerivatives::checkSelfCollision(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state,
+		const AllowedCollisionMatrix &acm, int point) const
+{
+	checkSelfCollisionDerivativesHelper(req, res, state, &acm, point);
+}
+
 double CollisionRobotFCLDerivatives::distanceSelf(const robot_state::RobotState &state) const
 {
 	return distanceSelfDerivativesHelper(state, NULL);
@@ -93,13 +151,15 @@ double CollisionRobotFCLDerivatives::distanceSelf(const robot_state::RobotState
 }
 
 void CollisionRobotFCLDerivatives::checkSelfCollisionDerivativesHelper(const CollisionRequest &req, CollisionResult &res, const robot_state::RobotState &state,
-		const AllowedCollisionMatrix *acm) const
+		const AllowedCollisionMatrix *acm, int point) const
 {
 	CollisionData cd(&req, &res, acm);
 	cd.enableGroup(getRobotModel());
 
 	CollisionDataDerivatives cdd;
 	cdd.cd = &cd;
+	if (point >= 0 && point < (int)gjk_guess_caches_.size())
+		cdd.gjk_guesses = &gjk_guess_caches_[point];
 
     manager_.manager_->collide(&cdd, &CollisionRobotFCLDerivatives::collisionCallback);
 	if (req.distance)
@@ -242,7 +302,7 @@ bool CollisionRobotFCLDerivatives::collisionCallback(fcl::CollisionObject *o1, f
 		std::size_t num_max_cost_sources = cdata->req_->max_cost_sources;
 		bool enable_contact = true;
 		fcl::CollisionResult col_result;
-		int num_contacts = fcl::collide(o1, o2, fcl::CollisionRequest(std::numeric_limits<size_t>::max(), enable_contact, num_max_cost_sources, enable_cost), col_result);
+		int num_contacts = collideWarmStarted(o1, o2, fcl::CollisionRequest(std::numeric_limits<size_t>::max(), enable_contact, num_max_cost_sources, enable_cost), col_result, *cdd);
 		if (num_contacts > 0)
 		{
 			if (cdata->req_->verbose)
@@ -303,7 +363,7 @@ bool CollisionRobotFCLDerivatives::collisionCallback(fcl::CollisionObject *o1, f
 			bool enable_contact = true;
 
 			fcl::CollisionResult col_result;
-			int num_contacts = fcl::collide(o1, o2, fcl::CollisionRequest(want_contact_count, enable_contact, num_max_cost_sources, enable_cost), col_result);
+			int num_contacts = collideWarmStarted(o1, o2, fcl::CollisionRequest(want_contact_count, enable_contact, num_max_cost_sources, enable_cost), col_result, *cdd);
 			if (num_contacts > 0)
 			{
 				int num_contacts_initial = num_contacts;
@@ -357,7 +417,7 @@ bool CollisionRobotFCLDerivatives::collisionCallback(fcl::CollisionObject *o1, f
 			std::size_t num_max_cost_sources = cdata->req_->max_cost_sources;
 			bool enable_contact = false;
 			fcl::CollisionResult col_result;
-			int num_contacts = fcl::collide(o1, o2, fcl::CollisionRequest(1, enable_contact, num_max_cost_sources, enable_cost), col_result);
+			int num_contacts = collideWarmStarted(o1, o2, fcl::CollisionRequest(1, enable_contact, num_max_cost_sources, enable_cost), col_result, *cdd);
 			if (num_contacts > 0)
 			{
 				cdata->res_->collision = true;
@@ -8,20 +8,46 @@
 #include <itomp_cio_planner/collision/collision_world_fcl_derivatives.h>
 #include <itomp_cio_planner/collision/collision_robot_fcl_derivatives.h>
 #include <itomp_cio_planner/collision/collision_common_derivatives.h>
+#include <itomp_cio_planner/util/planning_parameters.h>
+#include <fcl/BVH/BVH_model.h>
+#include <ros/assert.h>
+#include <boost/bind.hpp>
+#include <algorithm>
+#include <cmath>
 
 using namespace collision_detection;
 
 namespace itomp_cio_planner
 {
 
+namespace
+{
+
+// BVH node of a packet traversal with the range of the active bounds buffer holding the bounds overlapping its parent
+struct PacketNode
+{
+	int node;
+	int active_begin;
+	int active_end;
+};
+
+}
+
 CollisionWorldFCLDerivatives::CollisionWorldFCLDerivatives(const CollisionWorldFCL &other, const WorldPtr& world) :
-	CollisionWorldFCL(other, world)
+	CollisionWorldFCL(other, world), num_gjk_queries_(0), num_gjk_hits_(0)
 {
+	world_observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionWorldFCLDerivatives::notifyWorldChange, this, _1, _2));
+}
 
+CollisionWorldFCLDerivatives::CollisionWorldFCLDerivatives(const CollisionWorldFCLDerivatives &other, const WorldPtr& world) :
+	CollisionWorldFCL(other, world), convex_pieces_(other.convex_pieces_), num_gjk_queries_(0), num_gjk_hits_(0)
+{
+	world_observer_handle_ = getWorld()->addObserver(boost::bind(&CollisionWorldFCLDerivatives::notifyWorldChange, this, _1, _2));
 }
 
 CollisionWorldFCLDerivatives::~CollisionWorldFCLDerivatives()
 {
+	getWorld()->removeObserver(world_observer_handle_);
 }
 
 void CollisionWorldFCLDerivatives::checkRobotCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state) const
@@ -34,7 +60,7 @@ void CollisionWorldFCLDerivatives::checkRobotCollision(const CollisionRequest &r
 	checkRobotCollisionDerivativesHelper(req, res, robot, state, &acm);
 }
 
-void CollisionWorldFCLDerivatives::checkRobotCollisionDerivativesHelper(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix *acm) const
+void CollisionWorldFCLDerivatives::checkRobotCollisionDerivativesHelper(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix *acm, int point) const
 {
     const CollisionRobotFCLDerivatives &robot_fcl = static_cast<const CollisionRobotFCLDerivatives&>(robot);
     const FCLObject& fcl_obj = robot_fcl.manager_.object_;
@@ -43,15 +69,417 @@ void CollisionWorldFCLDerivatives::checkRobotCollisionDerivativesHelper(const Co
 	cd.enableGroup(robot.getRobotModel());
 	CollisionDataDerivatives cdd;
 	cdd.cd = &cd;
+	if (point >= 0 && point < (int)gjk_guess_caches_.size())
+		cdd.gjk_guesses = &gjk_guess_caches_[point];
 
 	for (std::size_t i = 0 ; !cd.done_ && i < fcl_obj.collision_objects_.size() ; ++i)
 		manager_->collide(fcl_obj.collision_objects_[i].get(), &cdd,
 						  &CollisionWorldFCLDerivatives::collisionCallback);
+	updateGJKWarmStartStatistics(cdd);
 
 	if (req.distance)
 		res.distance = distanceRobotDerivativesHelper(robot, state, acm);
 }
 
+void CollisionWorldFCLDerivatives::checkRobotCollision(const CollisionRequest &req, CollisionResult &res, const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix &acm, int point) const
+{
+	if (point < 0 || point >= (int)swept_window_of_point_.size() || swept_window_of_point_[point] < 0)
+	{
+		checkRobotCollisionDerivativesHelper(req, res, robot, state, &acm, point);
+		return;
+	}
+
+	const CollisionRobotFCLDerivatives &robot_fcl = static_cast<const CollisionRobotFCLDerivatives&>(robot);
+	const FCLObject& fcl_obj = robot_fcl.manager_.object_;
+	const SweptWindow& window = swept_windows_[swept_window_of_point_[point]];
+	ROS_ASSERT(window.candidates_.size() == fcl_obj.collision_objects_.size());
+
+	CollisionData cd(&req, &res, &acm);
+	cd.enableGroup(robot.getRobotModel());
+	CollisionDataDerivatives cdd;
+	cdd.cd = &cd;
+	if (point < (int)gjk_guess_caches_.size())
+		cdd.gjk_guesses = &gjk_guess_caches_[point];
+
+	for (std::size_t i = 0 ; !cd.done_ && i < fcl_obj.collision_objects_.size() ; ++i)
+	{
+		fcl::CollisionObject* robot_object = fcl_obj.collision_objects_[i].get();
+		const std::vector<fcl::CollisionObject*>& candidates = window.candidates_[i];
+		for (std::size_t j = 0; !cd.done_ && j < candidates.size(); ++j)
+		{
+			if (candidates[j]->getAABB().overlap(robot_object->getAABB()))
+				collisionCallback(candidates[j], robot_object, &cdd);
+		}
+	}
+	updateGJKWarmStartStatistics(cdd);
+
+	if (req.distance)
+		res.distance = distanceRobotDerivativesHelper(robot, state, &acm);
+}
+
+void CollisionWorldFCLDerivatives::initializeGJKWarmStart(int num_points)
+{
+	gjk_guess_caches_.clear();
+	gjk_guess_caches_.resize(num_points);
+}
+
+void CollisionWorldFCLDerivatives::clearGJKWarmStart()
+{
+	for (std::size_t i = 0; i < gjk_guess_caches_.size(); ++i)
+		gjk_guess_caches_[i].clear();
+}
+
+void CollisionWorldFCLDerivatives::notifyWorldChange(const World::ObjectConstPtr& object, World::Action action)
+{
+	// the cached pairs may refer to destroyed fcl objects
+	clearGJKWarmStart();
+
+	// the fcl objects of the pieces have been destroyed by the CollisionWorldFCL observer,
+	// or rebuilt from the meshes of the pieces (e.g. moved pieces)
+	if (action & World::DESTROY)
+		convex_pieces_.erase(object->id_);
+	else if (setConvexPieceGeometries(object->id_))
+		manager_->update();
+
+	// the culled objects may have been destroyed or moved
+	for (std::size_t i = 0; i < swept_windows_.size(); ++i)
+		swept_windows_[i].is_culled_ = false;
+	clearSweptBroadphase();
+}
+
+void CollisionWorldFCLDerivatives::initializeSweptBroadphase(int num_points)
+{
+	swept_windows_.clear();
+	swept_windows_.resize(num_points);
+	swept_window_of_point_.resize(num_points);
+	clearSweptBroadphase();
+}
+
+void CollisionWorldFCLDerivatives::clearSweptBroadphase()
+{
+	std::fill(swept_window_of_point_.begin(), swept_window_of_point_.end(), -1);
+}
+
+void CollisionWorldFCLDerivatives::updateSweptBroadphase(int point_begin, int point_end, const std::vector<fcl::AABB>& swept_aabbs)
+{
+	// the finite differences move the swept bounds only slightly, so the meshes are reduced with some slack
+	const double margin = PlanningParameters::getInstance()->getBroadphaseWindowMargin();
+
+	SweptWindow& window = swept_windows_[point_begin];
+
+	fcl::AABB robot_bounds;
+	for (std::size_t i = 0; i < swept_aabbs.size(); ++i)
+		robot_bounds += swept_aabbs[i];
+
+	if (!window.is_culled_ || !window.culling_bounds_.contain(robot_bounds))
+	{
+		window.culling_bounds_ = robot_bounds;
+		window.culling_bounds_.expand(fcl::Vec3f(margin, margin, margin));
+		window.objects_.clear();
+		window.reduced_meshes_.clear();
+
+		for (std::map<std::string, FCLObject>::const_iterator it = fcl_objs_.begin(); it != fcl_objs_.end(); ++it)
+		{
+			const std::vector<boost::shared_ptr<fcl::CollisionObject> >& collision_objects = it->second.collision_objects_;
+			for (std::size_t k = 0; k < collision_objects.size(); ++k)
+			{
+				fcl::CollisionObject* object = collision_objects[k].get();
+				if (!object->getAABB().overlap(window.culling_bounds_))
+					continue;
+
+				boost::shared_ptr<fcl::CollisionObject> reduced_object;
+				if (reduceMesh(*object, window.culling_bounds_, reduced_object))
+				{
+					// no triangle in the swept bounds
+					if (!reduced_object)
+						continue;
+					window.reduced_meshes_.push_back(reduced_object);
+					object = reduced_object.get();
+				}
+				window.objects_.push_back(object);
+			}
+		}
+		window.is_culled_ = true;
+	}
+
+	window.candidates_.resize(swept_aabbs.size());
+	for (std::size_t i = 0; i < swept_aabbs.size(); ++i)
+	{
+		window.candidates_[i].clear();
+		for (std::size_t k = 0; k < window.objects_.size(); ++k)
+		{
+			if (window.objects_[k]->getAABB().overlap(swept_aabbs[i]))
+				window.candidates_[i].push_back(window.objects_[k]);
+		}
+	}
+
+	for (int point = point_begin; point < point_end; ++point)
+		swept_window_of_point_[point] = point_begin;
+}
+
+bool CollisionWorldFCLDerivatives::reduceMesh(const fcl::CollisionObject& object, const fcl::AABB& bounds, boost::shared_ptr<fcl::CollisionObject>& reduced_object) const
+{
+	std::vector<fcl::AABB> packet_bounds(1, bounds);
+	std::vector<int> active_bounds(1, 0);
+	std::vector<std::vector<int> > triangles(1);
+	if (!collectMeshTriangles(object, packet_bounds, active_bounds, triangles))
+		return false;
+
+	reduced_object.reset();
+	if (!triangles[0].empty())
+		reduced_object = createSubMesh(object, triangles[0]);
+	return true;
+}
+
+bool CollisionWorldFCLDerivatives::collectMeshTriangles(const fcl::CollisionObject& object, const std::vector<fcl::AABB>& bounds,
+		const std::vector<int>& active_bounds, std::vector<std::vector<int> >& triangles) const
+{
+	// small meshes are cheaper to check than to rebuild
+	const int MIN_REDUCED_MESH_TRIANGLES = 64;
+
+	if (object.getObjectType() != fcl::OT_BVH || object.getNodeType() != fcl::BV_OBBRSS)
+		return false;
+	const fcl::BVHModel<fcl::OBBRSS>* mesh = static_cast<const fcl::BVHModel<fcl::OBBRSS>*>(object.collisionGeometry().get());
+	if (mesh->num_tris < MIN_REDUCED_MESH_TRIANGLES)
+		return false;
+
+	// bounds in the mesh frame
+	fcl::Transform3f inv_transform = object.getTransform();
+	inv_transform.inverse();
+	std::vector<fcl::AABB> local_bounds(bounds.size());
+	for (std::size_t i = 0; i < active_bounds.size(); ++i)
+	{
+		const fcl::AABB& aabb = bounds[active_bounds[i]];
+		fcl::AABB& local_aabb = local_bounds[active_bounds[i]];
+		for (int c = 0; c < 8; ++c)
+		{
+			fcl::Vec3f corner((c & 1) ? aabb.max_[0] : aabb.min_[0],
+							  (c & 2) ? aabb.max_[1] : aabb.min_[1],
+							  (c & 4) ? aabb.max_[2] : aabb.min_[2]);
+			local_aabb += inv_transform.transform(corner);
+		}
+		triangles[active_bounds[i]].clear();
+	}
+
+	// one traversal for all bounds
+	std::vector<int> active_buffer(active_bounds);
+	std::vector<PacketNode> node_stack;
+	PacketNode root = { 0, 0, (int)active_buffer.size() };
+	node_stack.push_back(root);
+	while (!node_stack.empty())
+	{
+		PacketNode packet_node = node_stack.back();
+		node_stack.pop_back();
+		const fcl::BVNode<fcl::OBBRSS>& node = mesh->getBV(packet_node.node);
+
+		const fcl::OBB& obb = node.bv.obb;
+		fcl::Vec3f half_extent;
+		for (int j = 0; j < 3; ++j)
+			half_extent[j] = std::abs(obb.axis[0][j]) * obb.extent[0] + std::abs(obb.axis[1][j]) * obb.extent[1]
+							 + std::abs(obb.axis[2][j]) * obb.extent[2];
+		fcl::AABB node_aabb(obb.To - half_extent, obb.To + half_extent);
+
+		int active_begin = active_buffer.size();
+		for (int i = packet_node.active_begin; i < packet_node.active_end; ++i)
+		{
+			int b = active_buffer[i];
+			if (local_bounds[b].overlap(node_aabb))
+				active_buffer.push_back(b);
+		}
+		int active_end = active_buffer.size();
+		if (active_begin == active_end)
+			continue;
+
+		if (node.isLeaf())
+		{
+			for (int i = active_begin; i < active_end; ++i)
+			{
+				std::vector<int>& bound_triangles = triangles[active_buffer[i]];
+				for (int k = 0; k < node.num_primitives; ++k)
+					bound_triangles.push_back(node.first_primitive + k);
+			}
+			active_buffer.resize(active_begin);
+		}
+		else
+		{
+			PacketNode left = { node.leftChild(), active_begin, active_end };
+			PacketNode right = { node.rightChild(), active_begin, active_end };
+			node_stack.push_back(left);
+			node_stack.push_back(right);
+		}
+	}
+	return true;
+}
+
+boost::shared_ptr<fcl::CollisionObject> CollisionWorldFCLDerivatives::createSubMesh(const fcl::CollisionObject& object, const std::vector<int>& triangles) const
+{
+	const fcl::BVHModel<fcl::OBBRSS>* mesh = static_cast<const fcl::BVHModel<fcl::OBBRSS>*>(object.collisionGeometry().get());
+
+	fcl::BVHModel<fcl::OBBRSS>* sub_mesh = new fcl::BVHModel<fcl::OBBRSS>();
+	sub_mesh->beginModel(triangles.size(), 3 * triangles.size());
+	for (std::size_t i = 0; i < triangles.size(); ++i)
+	{
+		const fcl::Triangle& triangle = mesh->tri_indices[triangles[i]];
+		sub_mesh->addTriangle(mesh->vertices[triangle[0]], mesh->vertices[triangle[1]], mesh->vertices[triangle[2]]);
+	}
+	sub_mesh->endModel();
+	sub_mesh->setUserData(mesh->getUserData());
+	return boost::shared_ptr<fcl::CollisionObject>(new fcl::CollisionObject(boost::shared_ptr<fcl::CollisionGeometry>(sub_mesh), object.getTransform()));
+}
+
+void CollisionWorldFCLDerivatives::checkRobotCollisionBatch(const CollisionRequest &req, std::vector<CollisionResult> &results, const CollisionRobot &robot,
+		int object_index, const std::vector<fcl::Transform3f>& transforms, const AllowedCollisionMatrix &acm) const
+{
+	const CollisionRobotFCLDerivatives &robot_fcl = static_cast<const CollisionRobotFCLDerivatives&>(robot);
+	const boost::shared_ptr<fcl::CollisionGeometry>& geometry = robot_fcl.manager_.object_.collision_objects_[object_index]->collisionGeometry();
+	int num_poses = transforms.size();
+	ROS_ASSERT(results.size() == transforms.size());
+
+	// the robot object at each pose. the objects are temporary, so they do not use the GJK warm start
+	std::vector<boost::shared_ptr<fcl::CollisionObject> > pose_objects(num_poses);
+	std::vector<fcl::AABB> pose_bounds(num_poses);
+	fcl::AABB packet_bounds;
+	std::vector<CollisionData> cds;
+	cds.reserve(num_poses);
+	std::vector<CollisionDataDerivatives> cdds(num_poses);
+	for (int i = 0; i < num_poses; ++i)
+	{
+		pose_objects[i].reset(new fcl::CollisionObject(geometry, transforms[i]));
+		pose_bounds[i] = pose_objects[i]->getAABB();
+		packet_bounds += pose_bounds[i];
+
+		cds.push_back(CollisionData(&req, &results[i], &acm));
+		cds.back().enableGroup(robot.getRobotModel());
+		cdds[i].cd = &cds[i];
+	}
+
+	std::vector<int> active_poses;
+	std::vector<std::vector<int> > pose_triangles(num_poses);
+	for (std::map<std::string, FCLObject>::const_iterator it = fcl_objs_.begin(); it != fcl_objs_.end(); ++it)
+	{
+		const std::vector<boost::shared_ptr<fcl::CollisionObject> >& collision_objects = it->second.collision_objects_;
+		for (std::size_t k = 0; k < collision_objects.size(); ++k)
+		{
+			fcl::CollisionObject* object = collision_objects[k].get();
+			if (!object->getAABB().overlap(packet_bounds))
+				continue;
+
+			active_poses.clear();
+			for (int i = 0; i < num_poses; ++i)
+			{
+				if (!cds[i].done_ && object->getAABB().overlap(pose_bounds[i]))
+					active_poses.push_back(i);
+			}
+			if (active_poses.empty())
+				continue;
+
+			// the poses reaching no leaf of the mesh are culled. the others run the narrow phase against the world mesh BVH
+			bool is_mesh = collectMeshTriangles(*object, pose_bounds, active_poses, pose_triangles);
+			for (std::size_t i = 0; i < active_poses.size(); ++i)
+			{
+				if (is_mesh && pose_triangles[active_poses[i]].empty())
+					continue;
+				collisionCallback(object, pose_objects[active_poses[i]].get(), &cdds[active_poses[i]]);
+			}
+		}
+	}
+}
+
+void CollisionWorldFCLDerivatives::applyConvexDecompositions(const std::map<std::string, ConvexDecompositionConstPtr>& decompositions)
+{
+	for (std::map<std::string, ConvexDecompositionConstPtr>::const_iterator it = decompositions.begin(); it != decompositions.end(); ++it)
+	{
+		const std::string& id = it->first;
+		const ConvexDecomposition& decomposition = *it->second;
+
+		collision_detection::World::ObjectConstPtr object = getWorld()->getObject(id);
+		if (!object || object->shapes_.size() != 1 || decomposition.getNumPieces() == 0)
+			continue;
+		Eigen::Affine3d pose = object->shape_poses_[0];
+
+		std::vector<shapes::ShapeConstPtr> shapes(decomposition.getNumPieces());
+		EigenSTL::vector_Affine3d poses(decomposition.getNumPieces(), pose);
+		for (unsigned int i = 0; i < decomposition.getNumPieces(); ++i)
+			shapes[i] = decomposition.getPiece(i);
+
+		// the world observer rebuilds the fcl objects of the pieces
+		getWorld()->removeObject(id);
+		getWorld()->addToObject(id, shapes, poses);
+
+		std::map<std::string, FCLObject>::iterator fcl_it = fcl_objs_.find(id);
+		if (fcl_it == fcl_objs_.end() || fcl_it->second.collision_objects_.size() != shapes.size())
+		{
+			logError("Convex pieces of %s are checked as meshes", id.c_str());
+			continue;
+		}
+
+		for (unsigned int i = 0; i < shapes.size(); ++i)
+		{
+			const shapes::Mesh& piece = *decomposition.getPiece(i);
+
+			boost::shared_ptr<ConvexPiece> convex_piece(new ConvexPiece);
+			convex_piece->points_.resize(piece.vertex_count);
+			for (unsigned int v = 0; v < piece.vertex_count; ++v)
+				convex_piece->points_[v].setValue(piece.vertices[3 * v], piece.vertices[3 * v + 1], piece.vertices[3 * v + 2]);
+			convex_piece->plane_normals_.resize(piece.triangle_count);
+			convex_piece->plane_dis_.resize(piece.triangle_count);
+			convex_piece->polygons_.resize(4 * piece.triangle_count);
+			for (unsigned int t = 0; t < piece.triangle_count; ++t)
+			{
+				const fcl::Vec3f& p0 = convex_piece->points_[piece.triangles[3 * t]];
+				const fcl::Vec3f& p1 = convex_piece->points_[piece.triangles[3 * t + 1]];
+				const fcl::Vec3f& p2 = convex_piece->points_[piece.triangles[3 * t + 2]];
+				fcl::Vec3f normal = (p1 - p0).cross(p2 - p0);
+				normal.normalize();
+				convex_piece->plane_normals_[t] = normal;
+				convex_piece->plane_dis_[t] = normal.dot(p0);
+				convex_piece->polygons_[4 * t] = 3;
+				for (int j = 0; j < 3; ++j)
+					convex_piece->polygons_[4 * t + 1 + j] = piece.triangles[3 * t + j];
+			}
+
+			fcl::Convex* convex = new fcl::Convex(&convex_piece->plane_normals_[0], &convex_piece->plane_dis_[0], piece.triangle_count,
+												  &convex_piece->points_[0], piece.vertex_count, &convex_piece->polygons_[0]);
+			convex->computeLocalAABB();
+			convex_piece->geometry_.reset(convex);
+			convex_pieces_[id].push_back(convex_piece);
+		}
+		setConvexPieceGeometries(id);
+	}
+	manager_->update();
+}
+
+void CollisionWorldFCLDerivatives::moveConvexDecomposition(const std::string& id, const Eigen::Affine3d& pose)
+{
+	collision_detection::World::ObjectConstPtr object = getWorld()->getObject(id);
+	if (!object)
+		return;
+
+	// the pieces share the pose of the decomposed mesh. after each move the observers rebuild the fcl objects
+	// from the cached meshes of the pieces, which are replaced with the convex geometries again
+	for (unsigned int i = 0; i < object->shapes_.size(); ++i)
+		getWorld()->moveShapeInObject(id, object->shapes_[i], pose);
+}
+
+bool CollisionWorldFCLDerivatives::setConvexPieceGeometries(const std::string& id)
+{
+	std::map<std::string, std::vector<boost::shared_ptr<ConvexPiece> > >::const_iterator it = convex_pieces_.find(id);
+	std::map<std::string, FCLObject>::iterator fcl_it = fcl_objs_.find(id);
+	if (it == convex_pieces_.end() || fcl_it == fcl_objs_.end() || fcl_it->second.collision_objects_.size() != it->second.size())
+		return false;
+
+	FCLObject& fcl_obj = fcl_it->second;
+	fcl_obj.unregisterFrom(manager_.get());
+	for (unsigned int i = 0; i < it->second.size(); ++i)
+	{
+		const boost::shared_ptr<fcl::CollisionGeometry>& geometry = it->second[i]->geometry_;
+		geometry->setUserData(fcl_obj.collision_objects_[i]->collisionGeometry()->getUserData());
+		fcl_obj.collision_objects_[i].reset(new fcl::CollisionObject(geometry, fcl_obj.collision_objects_[i]->getTransform()));
+	}
+	fcl_obj.registerTo(manager_.get());
+	return true;
+}
+
 double CollisionWorldFCLDerivatives::distanceRobotDerivativesHelper(const CollisionRobot &robot, const robot_state::RobotState &state, const AllowedCollisionMatrix *acm) const
 {
     const CollisionRobotFCLDerivatives& robot_fcl = static_cast<const CollisionRobotFCLDerivatives&>(robot);
@@ -202,7 +630,7 @@ bool CollisionWorldFCLDerivatives::collisionCallback(fcl::CollisionObject *o1, f
 		std::size_t num_max_cost_sources = cdata->req_->max_cost_sources;
 		bool enable_contact = true;
 		fcl::CollisionResult col_result;
-		int num_contacts = fcl::collide(o1, o2, fcl::CollisionRequest(std::numeric_limits<size_t>::max(), enable_contact, num_max_cost_sources, enable_cost), col_result);
+		int num_contacts = collideWarmStarted(o1, o2, fcl::CollisionRequest(std::numeric_limits<size_t>::max(), enable_contact, num_max_cost_sources, enable_cost), col_result, *cdd);
 		if (num_contacts > 0)
 		{
 			if (cdata->req_->verbose)
@@ -263,7 +691,7 @@ bool CollisionWorldFCLDerivatives::collisionCallback(fcl::CollisionObject *o1, f
 			bool enable_contact = true;
 
 			fcl::CollisionResult col_result;
-			int num_contacts = fcl::collide(o1, o2, fcl::CollisionRequest(want_contact_count, enable_contact, num_max_cost_sources, enable_cost), col_result);
+			int num_contacts = collideWarmStarted(o1, o2, fcl::CollisionRequest(want_contact_count, enable_contact, num_max_cost_sources, enable_cost), col_result, *cdd);
 			if (num_contacts > 0)
 			{
 				int num_contacts_initial = num_contacts;
@@ -317,7 +745,7 @@ bool CollisionWorldFCLDerivatives::collisionCallback(fcl::CollisionObject *o1, f
 			std::size_t num_max_cost_sources = cdata->req_->max_cost_sources;
 			bool enable_contact = false;
 			fcl::CollisionResult col_result;
-			int num_contacts = fcl::collide(o1, o2, fcl::CollisionRequest(1, enable_contact, num_max_cost_sources, enable_cost), col_result);
+			int num_contacts = collideWarmStarted(o1, o2, fcl::CollisionRequest(1, enable_contact, num_max_cost_sources, enable_cost), col_result, *cdd);
 			if (num_contacts > 0)
 			{
 				cdata->res_->collision = true;
@@ -0,0 +1,162 @@
+#include <itomp_cio_planner/collision/collision_world_manager.h>
+#include <itomp_cio_planner/util/planning_parameters.h>
+#include <ros/ros.h>
+
+using namespace collision_detection;
+
+namespace itomp_cio_planner
+{
+
+CollisionWorldManager::CollisionWorldManager()
+	: version_(0)
+{
+
+}
+
+CollisionWorldManager::~CollisionWorldManager()
+{
+	clear();
+}
+
+void CollisionWorldManager::clear()
+{
+	collision_world_.reset();
+	world_.reset();
+	scene_objects_.clear();
+	convex_decompositions_.clear();
+}
+
+unsigned int CollisionWorldManager::update(const planning_scene::PlanningSceneConstPtr& planning_scene)
+{
+	ros::WallTime start_time = ros::WallTime::now();
+
+	if (!PlanningParameters::getInstance()->getIncrementalCollisionWorld())
+		clear();
+
+	const WorldConstPtr& scene_world = planning_scene->getWorld();
+	std::vector<std::string> object_ids = scene_world->getObjectIds();
+
+	int num_added = 0;
+	int num_moved = 0;
+	int num_removed = 0;
+	std::map<std::string, ConvexDecompositionConstPtr> changed_decompositions;
+
+	if (!collision_world_)
+	{
+		// shares the fcl objects of the scene collision world
+		world_.reset(new World(*scene_world));
+		collision_world_.reset(new CollisionWorldFCLDerivatives(dynamic_cast<const CollisionWorldFCL&>(*planning_scene->getCollisionWorld()), world_));
+
+		for (unsigned int i = 0; i < object_ids.size(); ++i)
+		{
+			World::ObjectConstPtr object = scene_world->getObject(object_ids[i]);
+			scene_objects_[object_ids[i]] = object;
+			ConvexDecompositionConstPtr decomposition = decompose(object_ids[i], *object);
+			if (decomposition)
+				changed_decompositions[object_ids[i]] = decomposition;
+			++num_added;
+		}
+	}
+	else
+	{
+		for (std::map<std::string, World::ObjectConstPtr>::iterator it = scene_objects_.begin(); it != scene_objects_.end(); )
+		{
+			if (scene_world->hasObject(it->first))
+			{
+				++it;
+				continue;
+			}
+
+			world_->removeObject(it->first);
+			convex_decompositions_.erase(it->first);
+			scene_objects_.erase(it++);
+			++num_removed;
+		}
+
+		for (unsigned int i = 0; i < object_ids.size(); ++i)
+		{
+			const std::string& id = object_ids[i];
+			World::ObjectConstPtr object = scene_world->getObject(id);
+			std::map<std::string, World::ObjectConstPtr>::iterator it = scene_objects_.find(id);
+			if (it != scene_objects_.end() && it->second == object)
+				continue;
+
+			// same shapes at new poses
+			bool moved = (it != scene_objects_.end() && it->second->shapes_ == object->shapes_);
+			std::map<std::string, ConvexDecompositionConstPtr>::iterator decomposition_it = convex_decompositions_.find(id);
+			if (moved && decomposition_it == convex_decompositions_.end())
+			{
+				for (unsigned int j = 0; j < object->shapes_.size(); ++j)
+					world_->moveShapeInObject(id, object->shapes_[j], object->shape_poses_[j]);
+			}
+			else if (moved)
+			{
+				// the convex pieces keep their geometries. the mesh is not added again
+				collision_world_->moveConvexDecomposition(id, object->shape_poses_[0]);
+			}
+			else
+			{
+				world_->removeObject(id);
+				world_->addToObject(id, object->shapes_, object->shape_poses_);
+				ConvexDecompositionConstPtr decomposition = decompose(id, *object);
+				if (decomposition)
+					changed_decompositions[id] = decomposition;
+				else if (decomposition_it != convex_decompositions_.end())
+					convex_decompositions_.erase(decomposition_it);
+			}
+
+			scene_objects_[id] = object;
+			if (moved)
+				++num_moved;
+			else
+				++num_added;
+		}
+	}
+
+	if (!changed_decompositions.empty())
+	{
+		collision_world_->applyConvexDecompositions(changed_decompositions);
+		for (std::map<std::string, ConvexDecompositionConstPtr>::const_iterator it = changed_decompositions.begin(); it != changed_decompositions.end(); ++it)
+			convex_decompositions_[it->first] = it->second;
+	}
+
+	if (num_added + num_moved + num_removed > 0)
+		++version_;
+
+	if (PlanningParameters::getInstance()->getPrintPlanningInfo())
+		ROS_INFO("Collision world version %u : %d objects added, %d moved, %d removed, %d unchanged in %f sec",
+				 version_, num_added, num_moved, num_removed, (int)object_ids.size() - num_added - num_moved,
+				 (ros::WallTime::now() - start_time).toSec());
+
+	return version_;
+}
+
+CollisionWorldFCLDerivativesPtr CollisionWorldManager::createCollisionWorld() const
+{
+	const WorldPtr world(new World(*world_));
+	return CollisionWorldFCLDerivativesPtr(new CollisionWorldFCLDerivatives(*collision_world_, world));
+}
+
+ConvexDecompositionConstPtr CollisionWorldManager::decompose(const std::string& id, const World::Object& object) const
+{
+	const PlanningParameters* parameters = PlanningParameters::getInstance();
+	if (!parameters->getConvexDecomposition())
+		return ConvexDecompositionConstPtr();
+
+	if (object.shapes_.size() != 1 || object.shapes_[0]->type != shapes::MESH)
+		return ConvexDecompositionConstPtr();
+
+	// meshes with fewer triangles than pieces are cheaper as they are
+	const shapes::Mesh& mesh = static_cast<const shapes::Mesh&>(*object.shapes_[0]);
+	int max_pieces = parameters->getConvexDecompositionMaxPieces();
+	if ((int)mesh.triangle_count <= max_pieces)
+		return ConvexDecompositionConstPtr();
+
+	const std::string& cache_prefix = parameters->getConvexDecompositionCachePrefix();
+	ConvexDecompositionPtr decomposition(new ConvexDecomposition);
+	decomposition->loadOrDecompose(cache_prefix.empty() ? std::string() : cache_prefix + id + ".cvx",
+								   mesh, parameters->getConvexDecompositionMaxConcavity(), max_pieces);
+	return decomposition;
+}
+
+}
@@ -0,0 +1,301 @@
+#include <itomp_cio_planner/collision/convex_decomposition.h>
+#include <itomp_cio_planner/util/binary_io.h>
+#include <geometric_shapes/bodies.h>
+#include <ros/ros.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace itomp_cio_planner
+{
+
+// binary convex decomposition file format
+// header : magic, version, mesh hash, num_pieces
+// pieces : (vertex_count, triangle_count, vertices, triangles) for each
+const char ConvexDecomposition::FILE_MAGIC[8] = { 'I', 'T', 'O', 'M', 'P', 'C', 'V', 'X' };
+const uint32_t ConvexDecomposition::FILE_VERSION = 1;
+
+namespace
+{
+
+inline Eigen::Vector3d getVertex(const shapes::Mesh& mesh, unsigned int v)
+{
+	return Eigen::Vector3d(mesh.vertices[3 * v], mesh.vertices[3 * v + 1], mesh.vertices[3 * v + 2]);
+}
+
+inline Eigen::Vector3d getTriangleCentroid(const shapes::Mesh& mesh, unsigned int t)
+{
+	return (getVertex(mesh, mesh.triangles[3 * t]) + getVertex(mesh, mesh.triangles[3 * t + 1])
+			+ getVertex(mesh, mesh.triangles[3 * t + 2])) / 3.0;
+}
+
+// twice the area times the normal
+inline Eigen::Vector3d getTriangleAreaNormal(const shapes::Mesh& mesh, unsigned int t)
+{
+	Eigen::Vector3d v0 = getVertex(mesh, mesh.triangles[3 * t]);
+	return (getVertex(mesh, mesh.triangles[3 * t + 1]) - v0).cross(getVertex(mesh, mesh.triangles[3 * t + 2]) - v0);
+}
+
+inline void hashBytes(uint64_t& hash, const void* data, std::size_t size)
+{
+	// 64-bit FNV-1a
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (std::size_t i = 0; i < size; ++i)
+	{
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+struct CentroidLess
+{
+	CentroidLess(const shapes::Mesh& mesh, int axis) : mesh_(mesh), axis_(axis) {}
+	bool operator()(unsigned int t1, unsigned int t2) const
+	{
+		return getTriangleCentroid(mesh_, t1)(axis_) < getTriangleCentroid(mesh_, t2)(axis_);
+	}
+	const shapes::Mesh& mesh_;
+	int axis_;
+};
+
+}
+
+ConvexDecomposition::ConvexDecomposition()
+{
+}
+
+ConvexDecomposition::~ConvexDecomposition()
+{
+}
+
+void ConvexDecomposition::decompose(const shapes::Mesh& mesh, double max_concavity, unsigned int max_pieces)
+{
+	pieces_.clear();
+
+	std::vector<std::vector<unsigned int> > piece_stack(1);
+	for (unsigned int t = 0; t < mesh.triangle_count; ++t)
+		piece_stack[0].push_back(t);
+
+	while (!piece_stack.empty())
+	{
+		std::vector<unsigned int> triangles;
+		triangles.swap(piece_stack.back());
+		piece_stack.pop_back();
+		if (triangles.empty())
+			continue;
+
+		double concavity;
+		shapes::Mesh* hull = computeConvexHull(mesh, triangles, max_concavity, concavity);
+
+		bool can_split = triangles.size() > 1 && pieces_.size() + piece_stack.size() + 2 <= max_pieces;
+		if (hull != NULL && (concavity <= max_concavity || !can_split))
+		{
+			pieces_.push_back(boost::shared_ptr<const shapes::Mesh>(hull));
+			continue;
+		}
+		delete hull;
+
+		if (!can_split)
+		{
+			ROS_WARN("Convex decomposition : %d triangles do not have a convex hull. They are dropped", (int)triangles.size());
+			continue;
+		}
+
+		// split at the median centroid along the longest axis
+		Eigen::Vector3d min_bound = Eigen::Vector3d::Constant(std::numeric_limits<double>::max());
+		Eigen::Vector3d max_bound = -min_bound;
+		for (unsigned int i = 0; i < triangles.size(); ++i)
+		{
+			Eigen::Vector3d centroid = getTriangleCentroid(mesh, triangles[i]);
+			min_bound = min_bound.cwiseMin(centroid);
+			max_bound = max_bound.cwiseMax(centroid);
+		}
+		int axis;
+		(max_bound - min_bound).maxCoeff(&axis);
+
+		std::vector<unsigned int>::iterator median = triangles.begin() + triangles.size() / 2;
+		std::nth_element(triangles.begin(), median, triangles.end(), CentroidLess(mesh, axis));
+
+		piece_stack.push_back(std::vector<unsigned int>(triangles.begin(), median));
+		piece_stack.push_back(std::vector<unsigned int>(median, triangles.end()));
+	}
+}
+
+shapes::Mesh* ConvexDecomposition::computeConvexHull(const shapes::Mesh& mesh, const std::vector<unsigned int>& triangles,
+		double thickness, double& concavity) const
+{
+	concavity = 0.0;
+
+	std::vector<unsigned int> vertex_ids;
+	vertex_ids.reserve(3 * triangles.size());
+	Eigen::Vector3d area_normal = Eigen::Vector3d::Zero();
+	double area = 0.0;
+	for (unsigned int i = 0; i < triangles.size(); ++i)
+	{
+		for (int j = 0; j < 3; ++j)
+			vertex_ids.push_back(mesh.triangles[3 * triangles[i] + j]);
+		Eigen::Vector3d n = getTriangleAreaNormal(mesh, triangles[i]);
+		area_normal += n;
+		area += n.norm();
+	}
+	std::sort(vertex_ids.begin(), vertex_ids.end());
+	vertex_ids.erase(std::unique(vertex_ids.begin(), vertex_ids.end()), vertex_ids.end());
+
+	// mostly flat pieces are extruded behind the surface
+	bool extrude = area > 0.0 && area_normal.norm() > 0.5 * area;
+	Eigen::Vector3d offset = extrude ? Eigen::Vector3d(-thickness * area_normal.normalized()) : Eigen::Vector3d::Zero();
+
+	unsigned int num_points = vertex_ids.size() * (extrude ? 2 : 1);
+	shapes::Mesh points(num_points, 0);
+	for (unsigned int i = 0; i < num_points; ++i)
+	{
+		Eigen::Vector3d p = getVertex(mesh, vertex_ids[i % vertex_ids.size()]);
+		if (i >= vertex_ids.size())
+			p += offset;
+		for (int j = 0; j < 3; ++j)
+			points.vertices[3 * i + j] = p(j);
+	}
+
+	bodies::ConvexMesh convex_mesh(&points);
+	const std::vector<unsigned int>& hull_triangles = convex_mesh.getTriangles();
+	const EigenSTL::vector_Vector3d& hull_vertices = convex_mesh.getVertices();
+	const EigenSTL::vector_Vector4f& planes = convex_mesh.getPlanes();
+	if (hull_triangles.empty())
+		return NULL;
+
+	// concavity : the largest distance from the surface to the hull along the surface normal
+	for (unsigned int i = 0; i < triangles.size(); ++i)
+	{
+		Eigen::Vector3d n = getTriangleAreaNormal(mesh, triangles[i]);
+		if (n.norm() == 0.0)
+			continue;
+		n.normalize();
+		Eigen::Vector3d c = getTriangleCentroid(mesh, triangles[i]);
+
+		double distance = std::numeric_limits<double>::max();
+		for (unsigned int p = 0; p < planes.size(); ++p)
+		{
+			Eigen::Vector3d plane_normal(planes[p].x(), planes[p].y(), planes[p].z());
+			double n_dot = plane_normal.dot(n);
+			if (n_dot > 1e-9)
+				distance = std::min(distance, std::max(0.0, -(plane_normal.dot(c) + planes[p].w()) / n_dot));
+		}
+		if (distance != std::numeric_limits<double>::max())
+			concavity = std::max(concavity, distance);
+	}
+
+	shapes::Mesh* hull = new shapes::Mesh(hull_vertices.size(), hull_triangles.size() / 3);
+	for (unsigned int i = 0; i < hull_vertices.size(); ++i)
+		for (int j = 0; j < 3; ++j)
+			hull->vertices[3 * i + j] = hull_vertices[i](j);
+	std::copy(hull_triangles.begin(), hull_triangles.end(), hull->triangles);
+	hull->computeTriangleNormals();
+	return hull;
+}
+
+uint64_t ConvexDecomposition::computeMeshHash(const shapes::Mesh& mesh, double max_concavity, unsigned int max_pieces)
+{
+	uint64_t hash = 14695981039346656037ULL;
+	hashBytes(hash, mesh.vertices, 3 * mesh.vertex_count * sizeof(double));
+	hashBytes(hash, mesh.triangles, 3 * mesh.triangle_count * sizeof(unsigned int));
+	hashBytes(hash, &max_concavity, sizeof(max_concavity));
+	hashBytes(hash, &max_pieces, sizeof(max_pieces));
+	return hash;
+}
+
+bool ConvexDecomposition::load(const std::string& file_name, uint64_t mesh_hash)
+{
+	pieces_.clear();
+
+	MappedFile file;
+	if (!file.open(file_name))
+		return false;
+
+	BinaryReader reader(file.getData(), file.getSize());
+
+	char magic[sizeof(FILE_MAGIC)];
+	uint32_t version, num_pieces;
+	uint64_t file_mesh_hash;
+	if (!reader.readBytes(magic, sizeof(magic)) || memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0
+			|| !reader.readUInt32(version) || version != FILE_VERSION
+			|| !reader.readUInt64(file_mesh_hash) || !reader.readUInt32(num_pieces))
+	{
+		ROS_INFO("Convex decomposition file %s has an invalid header", file_name.c_str());
+		return false;
+	}
+	if (file_mesh_hash != mesh_hash)
+	{
+		ROS_INFO("Convex decomposition file %s is out of date", file_name.c_str());
+		return false;
+	}
+
+	for (unsigned int i = 0; i < num_pieces; ++i)
+	{
+		uint32_t vertex_count, triangle_count;
+		if (!reader.readUInt32(vertex_count) || !reader.readUInt32(triangle_count)
+				|| reader.getRemaining() < (3 * vertex_count) * sizeof(double) + (3 * triangle_count) * sizeof(uint32_t))
+		{
+			ROS_ERROR("Invalid convex decomposition file %s", file_name.c_str());
+			pieces_.clear();
+			return false;
+		}
+
+		shapes::Mesh* piece = new shapes::Mesh(vertex_count, triangle_count);
+		reader.readDoubles(piece->vertices, 3 * vertex_count);
+		for (unsigned int j = 0; j < 3 * triangle_count; ++j)
+		{
+			uint32_t index;
+			reader.readUInt32(index);
+			piece->triangles[j] = index;
+		}
+		piece->computeTriangleNormals();
+		pieces_.push_back(boost::shared_ptr<const shapes::Mesh>(piece));
+	}
+
+	return true;
+}
+
+bool ConvexDecomposition::save(const std::string& file_name, uint64_t mesh_hash) const
+{
+	BinaryWriter writer;
+	writer.writeBytes(FILE_MAGIC, sizeof(FILE_MAGIC));
+	writer.writeUInt32(FILE_VERSION);
+	writer.writeUInt64(mesh_hash);
+	writer.writeUInt32(pieces_.size());
+	for (unsigned int i = 0; i < pieces_.size(); ++i)
+	{
+		const shapes::Mesh& piece = *pieces_[i];
+		writer.writeUInt32(piece.vertex_count);
+		writer.writeUInt32(piece.triangle_count);
+		writer.writeDoubles(piece.vertices, 3 * piece.vertex_count);
+		for (unsigned int j = 0; j < 3 * piece.triangle_count; ++j)
+			writer.writeUInt32(piece.triangles[j]);
+	}
+
+	if (!writer.writeToFile(file_name))
+	{
+		ROS_ERROR("Failed to write convex decomposition file %s", file_name.c_str());
+		return false;
+	}
+	return true;
+}
+
+void ConvexDecomposition::loadOrDecompose(const std::string& file_name, const shapes::Mesh& mesh, double max_concavity, unsigned int max_pieces)
+{
+	uint64_t mesh_hash = computeMeshHash(mesh, max_concavity, max_pieces);
+	if (!file_name.empty() && load(file_name, mesh_hash))
+	{
+		ROS_INFO("Loaded %d convex pieces from %s", getNumPieces(), file_name.c_str());
+		return;
+	}
+
+	ros::WallTime start_time = ros::WallTime::now();
+	decompose(mesh, max_concavity, max_pieces);
+	ROS_INFO("Convex decomposition of %d triangles into %d pieces took %f sec", mesh.triangle_count, getNumPieces(),
+			 (ros::WallTime::now() - start_time).toSec());
+
+	if (!file_name.empty())
+		save(file_name, mesh_hash);
+}
+
+}
@@ -0,0 +1,391 @@
+#include <itomp_cio_planner/collision/voxel_world.h>
+#include <itomp_cio_planner/util/planning_parameters.h>
+#include <fcl/BVH/BVH_model.h>
+#include <octomap/OcTree.h>
+#include <ros/ros.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace itomp_cio_planner
+{
+
+namespace
+{
+
+const float EDT_INF = 1e20f;
+
+// squared Euclidean distance transform of the sampled function f along one line (Felzenszwalb and Huttenlocher)
+void distanceTransform1D(float* f, int n, int stride, std::vector<float>& d, std::vector<int>& v, std::vector<float>& z)
+{
+	d.resize(n);
+	v.resize(n);
+	z.resize(n + 1);
+
+	int k = 0;
+	v[0] = 0;
+	z[0] = -EDT_INF;
+	z[1] = EDT_INF;
+	for (int q = 1; q < n; ++q)
+	{
+		float s = ((f[q * stride] + q * q) - (f[v[k] * stride] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		while (s <= z[k])
+		{
+			--k;
+			s = ((f[q * stride] + q * q) - (f[v[k] * stride] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+		}
+		++k;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = EDT_INF;
+	}
+
+	k = 0;
+	for (int q = 0; q < n; ++q)
+	{
+		while (z[k + 1] < q)
+			++k;
+		d[q] = (q - v[k]) * (q - v[k]) + f[v[k] * stride];
+	}
+	for (int q = 0; q < n; ++q)
+		f[q * stride] = d[q];
+}
+
+// two triangles of the rectangle corner + [0, 1] * edge_u + [0, 1] * edge_v, counter-clockwise around edge_u x edge_v
+void addRectangle(const Eigen::Vector3d& corner, const Eigen::Vector3d& edge_u, const Eigen::Vector3d& edge_v,
+				  std::vector<Eigen::Vector3d>& vertices)
+{
+	vertices.push_back(corner);
+	vertices.push_back(corner + edge_u);
+	vertices.push_back(corner + edge_u + edge_v);
+	vertices.push_back(corner);
+	vertices.push_back(corner + edge_u + edge_v);
+	vertices.push_back(corner + edge_v);
+}
+
+void distanceTransform3D(std::vector<float>& f, const int size[3])
+{
+	std::vector<float> d;
+	std::vector<int> v;
+	std::vector<float> z;
+
+	for (int z_index = 0; z_index < size[2]; ++z_index)
+		for (int y = 0; y < size[1]; ++y)
+			distanceTransform1D(&f[(z_index * size[1] + y) * size[0]], size[0], 1, d, v, z);
+	for (int z_index = 0; z_index < size[2]; ++z_index)
+		for (int x = 0; x < size[0]; ++x)
+			distanceTransform1D(&f[z_index * size[1] * size[0] + x], size[1], size[0], d, v, z);
+	for (int y = 0; y < size[1]; ++y)
+		for (int x = 0; x < size[0]; ++x)
+			distanceTransform1D(&f[y * size[0] + x], size[2], size[0] * size[1], d, v, z);
+}
+
+}
+
+VoxelWorld::VoxelWorld() :
+	resolution_(0.0), origin_(Eigen::Vector3d::Zero()), max_distance_(0.0)
+{
+	size_[0] = size_[1] = size_[2] = 0;
+}
+
+VoxelWorld::~VoxelWorld()
+{
+}
+
+void VoxelWorld::initialize()
+{
+	const std::string& file_name = PlanningParameters::getInstance()->getVoxelEnvironment();
+	if (file_name == file_name_)
+		return;
+
+	file_name_ = file_name;
+	distances_.clear();
+	surface_.clear();
+	if (file_name_ != "")
+		load(file_name_);
+}
+
+bool VoxelWorld::load(const std::string& file_name)
+{
+	ros::WallTime start_time = ros::WallTime::now();
+
+	octomap::OcTree tree(0.1);
+	if (!tree.readBinary(file_name))
+	{
+		ROS_ERROR("Failed to read octree %s", file_name.c_str());
+		return false;
+	}
+
+	resolution_ = tree.getResolution();
+	max_distance_ = PlanningParameters::getInstance()->getVoxelEnvironmentMaxDistance();
+
+	double min_bound[3], max_bound[3];
+	tree.getMetricMin(min_bound[0], min_bound[1], min_bound[2]);
+	tree.getMetricMax(max_bound[0], max_bound[1], max_bound[2]);
+
+	// pad the grid so that the distance field reaches max_distance_ around the occupied voxels
+	int padding = (int)std::ceil(max_distance_ / resolution_) + 1;
+	for (int i = 0; i < 3; ++i)
+	{
+		origin_(i) = min_bound[i] + (0.5 - padding) * resolution_;
+		size_[i] = std::max(0, (int)std::floor((max_bound[i] - min_bound[i]) / resolution_ + 0.5)) + 2 * padding;
+	}
+
+	std::vector<char> occupancy(size_[0] * size_[1] * size_[2], 0);
+	int num_occupied = 0;
+	for (octomap::OcTree::leaf_iterator it = tree.begin_leafs(), end = tree.end_leafs(); it != end; ++it)
+	{
+		if (!tree.isNodeOccupied(*it))
+			continue;
+
+		// pruned leaves cover several voxels
+		int n = std::max(1, (int)std::floor(it.getSize() / resolution_ + 0.5));
+		Eigen::Vector3d first_center = Eigen::Vector3d(it.getX(), it.getY(), it.getZ())
+									   - Eigen::Vector3d::Constant(0.5 * (n - 1) * resolution_);
+		Eigen::Vector3d first_voxel = (first_center - origin_) / resolution_;
+		int x0 = (int)std::floor(first_voxel(0) + 0.5), y0 = (int)std::floor(first_voxel(1) + 0.5), z0 = (int)std::floor(first_voxel(2) + 0.5);
+		for (int z = std::max(0, z0); z < std::min(size_[2], z0 + n); ++z)
+			for (int y = std::max(0, y0); y < std::min(size_[1], y0 + n); ++y)
+				for (int x = std::max(0, x0); x < std::min(size_[0], x0 + n); ++x)
+				{
+					occupancy[getIndex(x, y, z)] = 1;
+					++num_occupied;
+				}
+	}
+
+	computeDistanceField(occupancy);
+
+	ROS_INFO("Voxel environment %s : %d x %d x %d voxels (resolution %f, %d occupied) loaded in %f sec", file_name.c_str(),
+			 size_[0], size_[1], size_[2], resolution_, num_occupied, (ros::WallTime::now() - start_time).toSec());
+
+	return true;
+}
+
+void VoxelWorld::computeDistanceField(const std::vector<char>& occupancy)
+{
+	int num_voxels = occupancy.size();
+
+	// squared voxel distances to the nearest occupied / free voxel
+	std::vector<float> outside(num_voxels), inside(num_voxels);
+	for (int i = 0; i < num_voxels; ++i)
+	{
+		outside[i] = occupancy[i] ? 0.0f : EDT_INF;
+		inside[i] = occupancy[i] ? EDT_INF : 0.0f;
+	}
+	distanceTransform3D(outside, size_);
+	distanceTransform3D(inside, size_);
+
+	// distances are measured from the voxel boundary, half a voxel from the center
+	distances_.resize(num_voxels);
+	for (int i = 0; i < num_voxels; ++i)
+	{
+		double distance = occupancy[i] ? -(std::sqrt(inside[i]) - 0.5) * resolution_ : (std::sqrt(outside[i]) - 0.5) * resolution_;
+		distances_[i] = std::max(-max_distance_, std::min(max_distance_, distance));
+	}
+
+	surface_.assign(num_voxels, 0);
+	for (int z = 1; z < size_[2] - 1; ++z)
+		for (int y = 1; y < size_[1] - 1; ++y)
+			for (int x = 1; x < size_[0] - 1; ++x)
+			{
+				int index = getIndex(x, y, z);
+				if (occupancy[index] && (!occupancy[index - 1] || !occupancy[index + 1]
+										 || !occupancy[index - size_[0]] || !occupancy[index + size_[0]]
+										 || !occupancy[index - size_[0] * size_[1]] || !occupancy[index + size_[0] * size_[1]]))
+					surface_[index] = 1;
+			}
+}
+
+double VoxelWorld::getDistance(const Eigen::Vector3d& position) const
+{
+	Eigen::Vector3d voxel = (position - origin_) / resolution_;
+	for (int i = 0; i < 3; ++i)
+	{
+		if (voxel(i) < 0.0 || voxel(i) > size_[i] - 1)
+			return max_distance_;
+	}
+
+	// trilinear interpolation
+	int x = std::min((int)voxel(0), size_[0] - 2);
+	int y = std::min((int)voxel(1), size_[1] - 2);
+	int z = std::min((int)voxel(2), size_[2] - 2);
+	double tx = voxel(0) - x, ty = voxel(1) - y, tz = voxel(2) - z;
+
+	int index = getIndex(x, y, z);
+	int dy = size_[0], dz = size_[0] * size_[1];
+	double d00 = (1.0 - tx) * distances_[index] + tx * distances_[index + 1];
+	double d10 = (1.0 - tx) * distances_[index + dy] + tx * distances_[index + dy + 1];
+	double d01 = (1.0 - tx) * distances_[index + dz] + tx * distances_[index + dz + 1];
+	double d11 = (1.0 - tx) * distances_[index + dy + dz] + tx * distances_[index + dy + dz + 1];
+	return (1.0 - tz) * ((1.0 - ty) * d00 + ty * d10) + tz * ((1.0 - ty) * d01 + ty * d11);
+}
+
+double VoxelWorld::getPenetrationDepth(const fcl::CollisionObject& object) const
+{
+	double depth = 0.0;
+	if (!isLoaded())
+		return depth;
+
+	// the object is farther than its bounding sphere radius from the occupied voxels
+	const fcl::AABB& aabb = object.getAABB();
+	fcl::Vec3f center = aabb.center();
+	if (getDistance(Eigen::Vector3d(center[0], center[1], center[2])) > aabb.radius())
+		return depth;
+
+	const fcl::Transform3f& transform = object.getTransform();
+	if (object.getObjectType() == fcl::OT_BVH && object.getNodeType() == fcl::BV_OBBRSS)
+	{
+		const fcl::BVHModel<fcl::OBBRSS>* mesh = static_cast<const fcl::BVHModel<fcl::OBBRSS>*>(object.collisionGeometry().get());
+		for (int i = 0; i < mesh->num_vertices; ++i)
+		{
+			fcl::Vec3f p = transform.transform(mesh->vertices[i]);
+			depth = std::max(depth, -getDistance(Eigen::Vector3d(p[0], p[1], p[2])));
+		}
+	}
+	else
+	{
+		for (int c = 0; c < 8; ++c)
+		{
+			Eigen::Vector3d corner((c & 1) ? aabb.max_[0] : aabb.min_[0],
+								   (c & 2) ? aabb.max_[1] : aabb.min_[1],
+								   (c & 4) ? aabb.max_[2] : aabb.min_[2]);
+			depth = std::max(depth, -getDistance(corner));
+		}
+		depth = std::max(depth, -getDistance(Eigen::Vector3d(center[0], center[1], center[2])));
+	}
+
+	return depth;
+}
+
+void VoxelWorld::extractSurfaceTriangles(double min_area, std::vector<Eigen::Vector3d>& vertices) const
+{
+	vertices.clear();
+	if (!isLoaded())
+		return;
+
+	const double NORMAL_COS_THRESHOLD = std::cos(20.0 * M_PI / 180.0);
+
+	// outward normals of the surface voxels from the distance field gradient
+	int num_voxels = surface_.size();
+	std::vector<Eigen::Vector3d> normals(num_voxels, Eigen::Vector3d::Zero());
+	int strides[3] = { 1, size_[0], size_[0] * size_[1] };
+	for (int i = 0; i < num_voxels; ++i)
+	{
+		if (!surface_[i])
+			continue;
+		for (int j = 0; j < 3; ++j)
+			normals[i](j) = distances_[i + strides[j]] - distances_[i - strides[j]];
+		if (normals[i].norm() > ITOMP_EPS)
+			normals[i].normalize();
+	}
+
+	// region growing over 26-connected surface voxels with similar normals on a common plane
+	std::vector<char> visited(num_voxels, 0);
+	std::vector<int> region, voxel_stack;
+	int num_regions = 0;
+	for (int seed = 0; seed < num_voxels; ++seed)
+	{
+		if (!surface_[seed] || visited[seed] || normals[seed].norm() < 0.5)
+			continue;
+
+		const Eigen::Vector3d seed_normal = normals[seed];
+		const Eigen::Vector3d seed_center = getVoxelCenter(seed % size_[0], (seed / size_[0]) % size_[1], seed / strides[2]);
+
+		region.clear();
+		voxel_stack.assign(1, seed);
+		visited[seed] = 1;
+		while (!voxel_stack.empty())
+		{
+			int index = voxel_stack.back();
+			voxel_stack.pop_back();
+			region.push_back(index);
+
+			int x = index % size_[0], y = (index / size_[0]) % size_[1], z = index / strides[2];
+			for (int dz = -1; dz <= 1; ++dz)
+				for (int dy = -1; dy <= 1; ++dy)
+					for (int dx = -1; dx <= 1; ++dx)
+					{
+						int neighbor = getIndex(x + dx, y + dy, z + dz);
+						if (!surface_[neighbor] || visited[neighbor] || normals[neighbor].dot(seed_normal) < NORMAL_COS_THRESHOLD
+								|| std::abs(seed_normal.dot(getVoxelCenter(x + dx, y + dy, z + dz) - seed_center)) > resolution_)
+							continue;
+						visited[neighbor] = 1;
+						voxel_stack.push_back(neighbor);
+					}
+		}
+
+		if (region.size() * resolution_ * resolution_ < min_area)
+			continue;
+		++num_regions;
+
+		// plane on the voxel faces
+		Eigen::Vector3d normal = Eigen::Vector3d::Zero();
+		Eigen::Vector3d centroid = Eigen::Vector3d::Zero();
+		for (unsigned int i = 0; i < region.size(); ++i)
+		{
+			normal += normals[region[i]];
+			centroid += getVoxelCenter(region[i] % size_[0], (region[i] / size_[0]) % size_[1], region[i] / strides[2]);
+		}
+		normal.normalize();
+		centroid /= region.size();
+		// cells are centered at the voxel centers projected from the seed
+		Eigen::Vector3d plane_origin = seed_center + (normal.dot(centroid - seed_center) + 0.5 * resolution_) * normal;
+
+		// in-plane basis. u x v = normal
+		Eigen::Vector3d u = normal.cross(std::abs(normal(0)) < 0.9 ? Eigen::Vector3d::UnitX() : Eigen::Vector3d::UnitY());
+		u.normalize();
+		Eigen::Vector3d v = normal.cross(u);
+
+		// voxels rasterized in the plane, sorted by row
+		std::vector<std::pair<int, int> > cells(region.size());
+		for (unsigned int i = 0; i < region.size(); ++i)
+		{
+			Eigen::Vector3d p = getVoxelCenter(region[i] % size_[0], (region[i] / size_[0]) % size_[1], region[i] / strides[2]) - seed_center;
+			cells[i] = std::make_pair((int)std::floor(p.dot(v) / resolution_ + 0.5), (int)std::floor(p.dot(u) / resolution_ + 0.5));
+		}
+		std::sort(cells.begin(), cells.end());
+		cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+		// runs of cells in a row are merged with identical runs of the previous row into rectangles
+		std::map<std::pair<int, int>, int> open_rectangles; // (u_begin, u_end) of the runs in previous_row -> v_begin
+		int previous_row = std::numeric_limits<int>::min();
+		unsigned int i = 0;
+		while (i <= cells.size())
+		{
+			std::map<std::pair<int, int>, int> next_open_rectangles;
+			int row = previous_row;
+			if (i < cells.size())
+			{
+				row = cells[i].first;
+				while (i < cells.size() && cells[i].first == row)
+				{
+					unsigned int j = i;
+					while (j + 1 < cells.size() && cells[j + 1].first == row && cells[j + 1].second == cells[j].second + 1)
+						++j;
+					std::pair<int, int> run(cells[i].second, cells[j].second);
+					std::map<std::pair<int, int>, int>::const_iterator it = open_rectangles.find(run);
+					next_open_rectangles[run] = (it != open_rectangles.end() && row == previous_row + 1) ? it->second : row;
+					i = j + 1;
+				}
+			}
+			else
+				++i;
+
+			// close the rectangles not continued in the row
+			for (std::map<std::pair<int, int>, int>::const_iterator it = open_rectangles.begin(); it != open_rectangles.end(); ++it)
+			{
+				std::map<std::pair<int, int>, int>::const_iterator next_it = next_open_rectangles.find(it->first);
+				if (next_it == next_open_rectangles.end() || next_it->second != it->second)
+					addRectangle(plane_origin + (it->first.first - 0.5) * resolution_ * u + (it->second - 0.5) * resolution_ * v,
+								 (it->first.second - it->first.first + 1) * resolution_ * u,
+								 (previous_row - it->second + 1) * resolution_ * v, vertices);
+			}
+			open_rectangles.swap(next_open_rectangles);
+			previous_row = row;
+		}
+	}
+
+	ROS_INFO("%d planar regions (%d triangles) extracted from the voxel environment", num_regions, (int)vertices.size() / 3);
+}
+
+}
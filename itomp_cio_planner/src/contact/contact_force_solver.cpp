@@ -0,0 +1,75 @@
+#include <itomp_cio_planner/contact/contact_force_solver.h>
+#include <ros/assert.h>
+#include <algorithm>
+
+namespace itomp_cio_planner
+{
+
+ContactForceSolver::ContactForceSolver()
+{
+}
+
+int ContactForceSolver::solve(const Eigen::MatrixXd& A, const Eigen::VectorXd& tau, double wrench_weight, const Eigen::VectorXd& point_weights,
+                              const std::vector<Eigen::Vector3d>& normals, double friction_coefficient, int max_iterations,
+                              Eigen::VectorXd& forces)
+{
+    // force changes below 1e-3 N stop the iterations
+    const double CONVERGENCE_THRESHOLD = 1e-3;
+
+    int num_points = point_weights.size();
+    ROS_ASSERT(A.cols() == 3 * num_points && forces.size() == 3 * num_points);
+
+    hessian_.noalias() = wrench_weight * A.transpose() * A;
+    for (int k = 0; k < num_points; ++k)
+        hessian_.block<3, 3>(3 * k, 3 * k) += point_weights(k) * Eigen::Matrix3d::Identity();
+    gradient_.noalias() = wrench_weight * A.transpose() * tau;
+
+    // starts from the unconstrained minimizer, which is the solution if it is inside the cones
+    forces = hessian_.ldlt().solve(-gradient_);
+    for (int k = 0; k < num_points; ++k)
+        forces.segment<3>(3 * k) = projectToFrictionCone(forces.segment<3>(3 * k), normals[k], friction_coefficient);
+
+    int iteration = 0;
+    while (iteration < max_iterations)
+    {
+        ++iteration;
+
+        double max_change = 0.0;
+        for (int k = 0; k < num_points; ++k)
+        {
+            const Eigen::Matrix3d block = hessian_.block<3, 3>(3 * k, 3 * k);
+            Eigen::Vector3d force = forces.segment<3>(3 * k);
+
+            // minimizer of the block with the other forces fixed, projected to the cone
+            Eigen::Vector3d residual = gradient_.segment<3>(3 * k) + hessian_.middleRows<3>(3 * k) * forces - block * force;
+            Eigen::Vector3d new_force = projectToFrictionCone(block.ldlt().solve(-residual), normals[k], friction_coefficient);
+
+            max_change = std::max(max_change, (new_force - force).cwiseAbs().maxCoeff());
+            forces.segment<3>(3 * k) = new_force;
+        }
+
+        if (max_change < CONVERGENCE_THRESHOLD)
+            break;
+    }
+
+    return iteration;
+}
+
+Eigen::Vector3d ContactForceSolver::projectToFrictionCone(const Eigen::Vector3d& force, const Eigen::Vector3d& normal, double friction_coefficient)
+{
+    double normal_force = force.dot(normal);
+    Eigen::Vector3d tangential_force = force - normal_force * normal;
+    double tangential_norm = tangential_force.norm();
+
+    if (tangential_norm <= friction_coefficient * normal_force)
+        return force;
+
+    // inside the polar cone
+    if (friction_coefficient * tangential_norm <= -normal_force)
+        return Eigen::Vector3d::Zero();
+
+    double projected_normal_force = (friction_coefficient * tangential_norm + normal_force) / (friction_coefficient * friction_coefficient + 1.0);
+    return projected_normal_force * normal + (friction_coefficient * projected_normal_force / tangential_norm) * tangential_force;
+}
+
+}
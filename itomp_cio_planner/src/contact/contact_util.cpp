@@ -1,4 +1,6 @@
 #include <itomp_cio_planner/contact/contact_util.h>
+#include <itomp_cio_planner/util/exponential_map.h>
+#include <itomp_cio_planner/util/planning_parameters.h>
 
 using namespace std;
 
@@ -13,4 +15,46 @@ double getContactActiveValue(unsigned int contact, unsigned int contact_point,
     return c;
 }
 
+double getContactInvariantError(unsigned int contact, unsigned int contact_point,
+                                const RigidBodyDynamics::Model& model, const ItompPlanningGroup& planning_group,
+                                const std::vector<ContactVariables>& contact_variables)
+{
+    const ContactVariables& variables = contact_variables[contact];
+    Eigen::Quaterniond projected_orientation = exponential_map::ExponentialMapToQuaternion(variables.projected_orientation_);
+
+    if (PlanningParameters::getInstance()->getCIEvaluationOnPoints())
+    {
+        int rbdl_point_id = planning_group.contact_points_[contact].getContactPointRBDLIds(contact_point);
+
+        const RigidBodyDynamics::Math::SpatialTransform& contact_body_transform = model.X_base[rbdl_point_id];
+
+        const Eigen::Vector3d& body_position = contact_body_transform.r;
+        Eigen::Vector3d position_diff = body_position - variables.projected_point_positions_[contact_point];
+
+        Eigen::Quaterniond body_orientation(contact_body_transform.E);
+        double angle = body_orientation.angularDistance(projected_orientation);
+
+        double position_diff_cost = position_diff(2) * position_diff(2) + angle * angle * 0.01;
+        double contact_body_velocity_cost = model.v[rbdl_point_id].squaredNorm() * 0.01;
+
+        return position_diff_cost + contact_body_velocity_cost;
+    }
+    else
+    {
+        int rbdl_body_id = planning_group.contact_points_[contact].getRBDLBodyId();
+        const RigidBodyDynamics::Math::SpatialTransform& contact_body_transform = model.X_base[rbdl_body_id];
+
+        const Eigen::Vector3d& body_position = contact_body_transform.r;
+        Eigen::Vector3d position_diff = body_position - variables.projected_position_;
+
+        Eigen::Quaterniond body_orientation(contact_body_transform.E);
+        double angle = body_orientation.angularDistance(projected_orientation);
+
+        double position_diff_cost = position_diff.squaredNorm() + angle * angle * 0.01;
+        double contact_body_velocity_cost = model.v[rbdl_body_id].squaredNorm();
+
+        return position_diff_cost + contact_body_velocity_cost;
+    }
+}
+
 }
@@ -5,6 +5,7 @@
  *      Author: chpark
  */
 #include <itomp_cio_planner/contact/ground_manager.h>
+#include <itomp_cio_planner/collision/voxel_world.h>
 #include <itomp_cio_planner/optimization/phase_manager.h>
 #include <itomp_cio_planner/util/planning_parameters.h>
 #include <itomp_cio_planner/util/point_to_triangle_projection.h>
@@ -288,9 +289,22 @@ void GroundManager::initializeContactSurfaces()
 {
 	triangles_.clear();
 
+    // planar regions of the scanned environment
+    if (VoxelWorld::getInstance()->isLoaded())
+    {
+        std::vector<Eigen::Vector3d> vertices;
+        VoxelWorld::getInstance()->extractSurfaceTriangles(PlanningParameters::getInstance()->getVoxelPlaneMinArea(), vertices);
+        for (int k = 0; k < vertices.size() / 3; ++k)
+            addContactTriangle(vertices[3 * k], vertices[3 * k + 1], vertices[3 * k + 2]);
+    }
+
     std::string contact_model = PlanningParameters::getInstance()->getContactModel();
     if (contact_model == "")
+    {
+        if (!triangles_.empty())
+            NewVizManager::getInstance()->renderContactSurface();
         return;
+    }
 
     const std::vector<double>& contact_model_position = PlanningParameters::getInstance()->getContactModelPosition();
     double contact_model_scale = PlanningParameters::getInstance()->getContactModelScale();
@@ -310,45 +324,50 @@ void GroundManager::initializeContactSurfaces()
         Eigen::Vector3d position2(mesh->vertices[3 * triangle_vertex2], mesh->vertices[3 * triangle_vertex2 + 1], mesh->vertices[3 * triangle_vertex2 + 2]);
         Eigen::Vector3d position3(mesh->vertices[3 * triangle_vertex3], mesh->vertices[3 * triangle_vertex3 + 1], mesh->vertices[3 * triangle_vertex3 + 2]);
 
-        Eigen::Vector3d p0 = (position2 - position1);
-        Eigen::Vector3d p1 = (position3 - position1);
-        p0.normalize();
-        p1.normalize();
-        Eigen::Vector3d normal = p0.cross(p1);
-        if (normal.norm() < ITOMP_EPS)
-            continue;
-        normal.normalize();
+        addContactTriangle(position1 + translation, position2 + translation, position3 + translation);
+    }
 
-        // TODO: z-axis only
-        if (PlanningParameters::getInstance()->getContactZPlaneOnly() && normal(2) < 0.99)
-            continue;
+    NewVizManager::getInstance()->renderContactSurface();
+}
+
+void GroundManager::addContactTriangle(const Eigen::Vector3d& position1, const Eigen::Vector3d& position2, const Eigen::Vector3d& position3)
+{
+    Eigen::Vector3d p0 = (position2 - position1);
+    Eigen::Vector3d p1 = (position3 - position1);
+    p0.normalize();
+    p1.normalize();
+    Eigen::Vector3d normal = p0.cross(p1);
+    if (normal.norm() < ITOMP_EPS)
+        return;
+    normal.normalize();
 
-        Triangle tri;
-        tri.points_[0] = position1 + translation;
-        tri.points_[1] = position2 + translation;
-        tri.points_[2] = position3 + translation;
-        tri.normal_ = normal;
+    // TODO: z-axis only
+    if (PlanningParameters::getInstance()->getContactZPlaneOnly() && normal(2) < 0.99)
+        return;
 
-        tri.plane_index_ = -1;
-        for (int i = 0; i < planes_.size(); ++i)
-        {
-            Plane& plane = planes_[i];
-            if (plane.isTriangleIn(tri))
-            {
-                plane.triangle_indices_.insert(triangles_.size());
-                tri.plane_index_ = i;
-            }
-        }
-        if (tri.plane_index_ == -1)
+    Triangle tri;
+    tri.points_[0] = position1;
+    tri.points_[1] = position2;
+    tri.points_[2] = position3;
+    tri.normal_ = normal;
+
+    tri.plane_index_ = -1;
+    for (int i = 0; i < planes_.size(); ++i)
+    {
+        Plane& plane = planes_[i];
+        if (plane.isTriangleIn(tri))
         {
-            tri.plane_index_ = planes_.size();
-            planes_.push_back(Plane(tri));
-            planes_.back().triangle_indices_.insert(triangles_.size());
+            plane.triangle_indices_.insert(triangles_.size());
+            tri.plane_index_ = i;
         }
-        triangles_.push_back(tri);
     }
-
-    NewVizManager::getInstance()->renderContactSurface();
+    if (tri.plane_index_ == -1)
+    {
+        tri.plane_index_ = planes_.size();
+        planes_.push_back(Plane(tri));
+        planes_.back().triangle_indices_.insert(triangles_.size());
+    }
+    triangles_.push_back(tri);
 }
 
 }
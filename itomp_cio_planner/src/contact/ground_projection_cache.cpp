@@ -0,0 +1,69 @@
+#include <itomp_cio_planner/contact/ground_projection_cache.h>
+#include <itomp_cio_planner/contact/ground_manager.h>
+#include <cstring>
+
+namespace itomp_cio_planner
+{
+
+static bool isBitIdentical(const Eigen::Vector3d& a, const Eigen::Vector3d& b)
+{
+    return std::memcmp(a.data(), b.data(), 3 * sizeof(double)) == 0;
+}
+
+GroundProjectionCache::GroundProjectionCache()
+    : num_contacts_(0), num_slots_(0), num_hits_(0), num_misses_(0)
+{
+}
+
+void GroundProjectionCache::initialize(int num_points, int num_contacts, int num_slots)
+{
+    num_contacts_ = num_contacts;
+    num_slots_ = num_slots;
+    entries_.resize(num_points * num_contacts * num_slots);
+    invalidate();
+    resetStatistics();
+}
+
+void GroundProjectionCache::invalidate()
+{
+    for (int i = 0; i < entries_.size(); ++i)
+        entries_[i].valid_ = false;
+}
+
+void GroundProjectionCache::resetStatistics()
+{
+    num_hits_ = 0;
+    num_misses_ = 0;
+}
+
+void GroundProjectionCache::getNearestContactPosition(int point, int contact, int slot,
+        const Eigen::Vector3d& position_in, const Eigen::Vector3d& orientation_in,
+        Eigen::Vector3d& position_out, Eigen::Vector3d& orientation_out,
+        Eigen::Vector3d& normal, bool include_ground)
+{
+    Entry& entry = entries_[getEntryIndex(point, contact, slot)];
+
+    if (entry.valid_ && entry.include_ground_ == include_ground &&
+            isBitIdentical(entry.position_in_, position_in) && isBitIdentical(entry.orientation_in_, orientation_in))
+    {
+        ++num_hits_;
+    }
+    else
+    {
+        ++num_misses_;
+
+        // inputs may alias the outputs, so store them before projecting
+        entry.position_in_ = position_in;
+        entry.orientation_in_ = orientation_in;
+        entry.include_ground_ = include_ground;
+        GroundManager::getInstance()->getNearestContactPosition(entry.position_in_, entry.orientation_in_,
+                entry.position_out_, entry.orientation_out_, entry.normal_, include_ground);
+        entry.valid_ = true;
+    }
+
+    position_out = entry.position_out_;
+    orientation_out = entry.orientation_out_;
+    normal = entry.normal_;
+}
+
+}
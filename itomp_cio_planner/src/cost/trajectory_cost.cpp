@@ -6,7 +6,10 @@
 #include <itomp_cio_planner/rom/ROM.h>
 #include <itomp_cio_planner/collision/collision_world_fcl_derivatives.h>
 #include <itomp_cio_planner/collision/collision_robot_fcl_derivatives.h>
+#include <itomp_cio_planner/collision/voxel_world.h>
 #include <itomp_cio_planner/optimization/phase_manager.h>
+#include <itomp_cio_planner/optimization/augmented_lagrangian.h>
+#include <itomp_cio_planner/optimization/crowd_manager.h>
 #include <ros/package.h>
 
 namespace itomp_cio_planner
@@ -23,6 +26,19 @@ TrajectoryCost::~TrajectoryCost()
 
 }
 
+int TrajectoryCost::getNumResiduals(const NewEvalManager* evaluation_manager) const
+{
+    return 1;
+}
+
+bool TrajectoryCost::evaluateResiduals(const NewEvalManager* evaluation_manager, int point, double* residuals) const
+{
+    double cost = 0.0;
+    bool is_feasible = evaluate(evaluation_manager, point, cost);
+    residuals[0] = std::sqrt(std::max(cost, 0.0));
+    return is_feasible;
+}
+
 ITOMP_TRAJECTORY_COST_EMPTY_INIT_FUNC(Smoothness)
 bool TrajectoryCostSmoothness::evaluate(
 	const NewEvalManager* evaluation_manager, int point, double& cost) const
@@ -72,6 +88,45 @@ bool TrajectoryCostSmoothness::evaluate(
 	return true;
 }
 
+int TrajectoryCostSmoothness::getNumResiduals(const NewEvalManager* evaluation_manager) const
+{
+    const ItompTrajectoryConstPtr trajectory = evaluation_manager->getTrajectory();
+    return trajectory->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_VELOCITY,
+                                            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getNumElements() +
+           trajectory->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_ACCELERATION,
+                                            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getNumElements();
+}
+
+bool TrajectoryCostSmoothness::evaluateResiduals(const NewEvalManager* evaluation_manager, int point, double* residuals) const
+{
+    const ItompTrajectoryConstPtr trajectory = evaluation_manager->getTrajectory();
+    const ElementTrajectoryConstPtr traj_vel = trajectory->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_VELOCITY,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+    const ElementTrajectoryConstPtr traj_acc = trajectory->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_ACCELERATION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+    int num_vel = traj_vel->getNumElements();
+    int num_acc = traj_acc->getNumElements();
+
+    if (PhaseManager::getInstance()->getPhase() < 1)
+    {
+        std::fill(residuals, residuals + num_vel + num_acc, 0.0);
+        return true;
+    }
+
+    const Eigen::MatrixXd& mat_vel = traj_vel->getTrajectoryPoint(point);
+    const Eigen::MatrixXd& mat_acc = traj_acc->getTrajectoryPoint(point);
+
+    // same normalization as the cost
+    double scale_vel = std::sqrt(PlanningParameters::getInstance()->getSmoothnessCostVelocity() / num_vel);
+    double scale_acc = std::sqrt(PlanningParameters::getInstance()->getSmoothnessCostAcceleration() / num_acc);
+    for (int i = 0; i < num_vel; ++i)
+        residuals[i] = scale_vel * mat_vel(i);
+    for (int i = 0; i < num_acc; ++i)
+        residuals[num_vel + i] = scale_acc * mat_acc(i);
+
+    return true;
+}
+
 void TrajectoryCostObstacle::initialize(const NewEvalManager* evaluation_manager)
 {
 
@@ -92,6 +147,16 @@ bool TrajectoryCostObstacle::isInvariant(const NewEvalManager* evaluation_manage
             index.sub_component != ItompTrajectory::SUB_COMPONENT_TYPE_ALL);
 }
 
+collision_detection::CollisionRequest TrajectoryCostObstacle::getCollisionRequest()
+{
+    collision_detection::CollisionRequest collision_request;
+    collision_request.verbose = false;
+    collision_request.contacts = true;
+    collision_request.max_contacts = 1000;
+    collision_request.distance = false;
+    return collision_request;
+}
+
 bool TrajectoryCostObstacle::evaluate(const NewEvalManager* evaluation_manager, int point, double& cost) const
 {
     double collision_scale = 1.0;
@@ -111,12 +176,8 @@ bool TrajectoryCostObstacle::evaluate(const NewEvalManager* evaluation_manager,
                trajectory->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
                        ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getNumElements());
 
-    collision_detection::CollisionRequest collision_request;
+    const collision_detection::CollisionRequest collision_request = getCollisionRequest();
     collision_detection::CollisionResult collision_result;
-    collision_request.verbose = false;
-    collision_request.contacts = true;
-    collision_request.max_contacts = 1000;
-    collision_request.distance = false;
 
     const Eigen::MatrixXd mat = trajectory->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
                                 ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getTrajectoryPoint(point);
@@ -135,10 +196,14 @@ bool TrajectoryCostObstacle::evaluate(const NewEvalManager* evaluation_manager,
     const collision_detection::CollisionResult::ContactMap& contact_map = collision_result.contacts;
 
 
-    collision_world_derivatives->checkRobotCollision(collision_request, collision_result,
-            *collision_robot_derivatives,
-            *robot_state,
-            planning_scene->getAllowedCollisionMatrix());
+    const collision_detection::CollisionResult* batched_result = evaluation_manager->getBatchedObstacleResult(point);
+    if (batched_result != NULL)
+        collision_result = *batched_result;
+    else
+        collision_world_derivatives->checkRobotCollision(collision_request, collision_result,
+                *collision_robot_derivatives,
+                *robot_state,
+                planning_scene->getAllowedCollisionMatrix(), point);
 
 
 
@@ -163,6 +228,18 @@ bool TrajectoryCostObstacle::evaluate(const NewEvalManager* evaluation_manager,
           //cost += contact.depth * contact.depth * collision_scale;
     }
 
+    // scanned environment
+    if (VoxelWorld::getInstance()->isLoaded())
+    {
+        const std::vector<boost::shared_ptr<fcl::CollisionObject> >& robot_objects = collision_robot_derivatives->getInternalFCLCollisionObjects();
+        for (unsigned int i = 0; i < robot_objects.size(); ++i)
+        {
+            double depth = VoxelWorld::getInstance()->getPenetrationDepth(*robot_objects[i]);
+            if (depth > 0.01)
+                cost += (depth - 0.01) * (depth - 0.01) * collision_scale;
+        }
+    }
+
 
 
     collision_result.clear();
@@ -170,7 +247,7 @@ bool TrajectoryCostObstacle::evaluate(const NewEvalManager* evaluation_manager,
 
     collision_robot_derivatives->checkSelfCollision(collision_request, collision_result,
             *robot_state,
-            planning_scene->getAllowedCollisionMatrix());
+            planning_scene->getAllowedCollisionMatrix(), point);
     for (collision_detection::CollisionResult::ContactMap::const_iterator it =
                 contact_map.begin(); it != contact_map.end(); ++it)
     {
@@ -219,71 +296,22 @@ bool TrajectoryCostContactInvariant::evaluate(
 		evaluation_manager->contact_variables_[point];
 	int num_contacts = contact_variables.size();
 
-    if (PlanningParameters::getInstance()->getCIEvaluationOnPoints())
-	{
-        for (int i = 0; i < num_contacts; ++i)
-        {
-            for (int j = 0; j < NUM_ENDEFFECTOR_CONTACT_POINTS; ++j)
-            {
-                int rbdl_point_id = planning_group->contact_points_[i].getContactPointRBDLIds(j);
-
-                const RigidBodyDynamics::Math::SpatialTransform& contact_body_transform = model.X_base[rbdl_point_id];
-
-                const Eigen::Vector3d& body_position = contact_body_transform.r;
-                Eigen::Vector3d position_diff = body_position - contact_variables[i].projected_point_positions_[j];
-
-                Eigen::Quaterniond body_orientation(contact_body_transform.E);
-                Eigen::Quaterniond projected_orientation = exponential_map::ExponentialMapToQuaternion(contact_variables[i].projected_orientation_);
-                double angle = body_orientation.angularDistance(projected_orientation);
-
-                /*
-                Eigen::Vector3d orientation(exponential_map::RotationToExponentialMap(contact_body_transform.E));
-                Eigen::Vector3d projected_position, normal;
-                GroundManager::getInstance()->getNearestContactPosition(body_position, orientation, projected_position, orientation, normal);
-                Eigen::Vector3d position_diff = body_position - projected_position;
+    const AugmentedLagrangian* augmented_lagrangian = AugmentedLagrangian::getInstance();
+    bool is_constraint = augmented_lagrangian->isActive();
 
-                Eigen::Quaterniond body_orientation(contact_body_transform.E);
-                Eigen::Quaterniond projected_orientation = exponential_map::ExponentialMapToQuaternion(contact_variables[i].projected_orientation_);
-                double angle = body_orientation.angularDistance(projected_orientation);
-                angle = 0.0;
-                */
-
-                double position_diff_cost = 0.0;// = position_diff.squaredNorm() + angle * angle;
-                position_diff_cost += position_diff(0) * position_diff(0) * 0.0
-                                      + position_diff(1) * position_diff(1) * 0.0
-                                      + position_diff(2) * position_diff(2)
-                                      + angle * angle * 0.01;
-                double contact_body_velocity_cost = model.v[rbdl_point_id].squaredNorm() * 0.01;
-
-                double c = getContactActiveValue(i, j, contact_variables);
-
-                cost += c * (position_diff_cost + contact_body_velocity_cost);
-            }
-        }
-	}
-    else
+    for (int i = 0; i < num_contacts; ++i)
     {
-        for (int i = 0; i < num_contacts; ++i)
+        for (int j = 0; j < NUM_ENDEFFECTOR_CONTACT_POINTS; ++j)
         {
-            int rbdl_body_id = planning_group->contact_points_[i].getRBDLBodyId();
-            const RigidBodyDynamics::Math::SpatialTransform& contact_body_transform = model.X_base[rbdl_body_id];
+            double c = getContactActiveValue(i, j, contact_variables);
 
-            const Eigen::Vector3d& body_position = contact_body_transform.r;
-            Eigen::Vector3d position_diff = body_position - contact_variables[i].projected_position_;
-
-            Eigen::Quaterniond body_orientation(contact_body_transform.E);
-            Eigen::Quaterniond projected_orientation = exponential_map::ExponentialMapToQuaternion(contact_variables[i].projected_orientation_);
-            double angle = body_orientation.angularDistance(projected_orientation);
-
-            double position_diff_cost = position_diff.squaredNorm() + angle * angle * 0.01;
-            double contact_body_velocity_cost = model.v[rbdl_body_id].squaredNorm();
-
-            for (int j = 0; j < NUM_ENDEFFECTOR_CONTACT_POINTS; ++j)
+            double error = c * getContactInvariantError(i, j, model, *planning_group, contact_variables);
+            if (is_constraint)
             {
-                double c = getContactActiveValue(i, j, contact_variables);
-
-                cost += c * (position_diff_cost + contact_body_velocity_cost);
+                double value = std::sqrt(std::max(error, 0.0)) + augmented_lagrangian->getContactShift(point, i, j);
+                error = augmented_lagrangian->getPenaltyScale() * value * value;
             }
+            cost += error;
         }
     }
 
@@ -305,18 +333,49 @@ bool TrajectoryCostPhysicsViolation::evaluate(
 
 	TIME_PROFILER_START_TIMER(PhysicsViolation);
 
+    const AugmentedLagrangian* augmented_lagrangian = AugmentedLagrangian::getInstance();
+    bool is_constraint = augmented_lagrangian->isActive();
+
 	for (int i = 0; i < 6; ++i)
 	{
 		// non-actuated root joints
         double joint_torque = evaluation_manager->joint_torques_[point](i);
+        if (is_constraint)
+            joint_torque += augmented_lagrangian->getPhysicsShift(point, i);
 		cost += joint_torque * joint_torque;
 	}
+    if (is_constraint)
+        cost *= augmented_lagrangian->getPenaltyScale();
 
 	TIME_PROFILER_END_TIMER(PhysicsViolation);
 
 	return is_feasible;
 }
 
+int TrajectoryCostPhysicsViolation::getNumResiduals(const NewEvalManager* evaluation_manager) const
+{
+    return 6;
+}
+
+bool TrajectoryCostPhysicsViolation::evaluateResiduals(const NewEvalManager* evaluation_manager, int point, double* residuals) const
+{
+    const AugmentedLagrangian* augmented_lagrangian = AugmentedLagrangian::getInstance();
+    bool is_constraint = augmented_lagrangian->isActive();
+
+    for (int i = 0; i < 6; ++i)
+    {
+        if (PhaseManager::getInstance()->getPhase() <= 2)
+            residuals[i] = 0.0;
+        else if (is_constraint)
+            residuals[i] = std::sqrt(augmented_lagrangian->getPenaltyScale()) *
+                           (evaluation_manager->joint_torques_[point](i) + augmented_lagrangian->getPhysicsShift(point, i));
+        else
+            residuals[i] = evaluation_manager->joint_torques_[point](i);
+    }
+
+    return true;
+}
+
 ITOMP_TRAJECTORY_COST_EMPTY_INIT_FUNC(GoalPose)
 bool TrajectoryCostGoalPose::evaluate(const NewEvalManager* evaluation_manager,
 									  int point, double& cost) const
@@ -387,6 +446,28 @@ bool TrajectoryCostGoalPose::evaluate(const NewEvalManager* evaluation_manager,
 	return is_feasible;
 }
 
+int TrajectoryCostGoalPose::getNumResiduals(const NewEvalManager* evaluation_manager) const
+{
+    return 3;
+}
+
+bool TrajectoryCostGoalPose::evaluateResiduals(const NewEvalManager* evaluation_manager, int point, double* residuals) const
+{
+    Eigen::Map<Eigen::Vector3d> residual(residuals);
+    residual.setZero();
+
+    if (point == evaluation_manager->getTrajectory()->getNumPoints() - 1)
+    {
+        const robot_state::RobotStatePtr& state = evaluation_manager->getRobotState(point);
+        residual(0) = state->getVariablePosition(0);
+        residual(1) = state->getVariablePosition(1);
+        residual(2) = state->getVariablePosition(5);
+        residual -= PhaseManager::getInstance()->initial_goal_pos;
+    }
+
+    return true;
+}
+
 ITOMP_TRAJECTORY_COST_EMPTY_INIT_FUNC(COM)
 bool TrajectoryCostCOM::evaluate(const NewEvalManager* evaluation_manager,
 								 int point, double& cost) const
@@ -490,14 +571,44 @@ bool TrajectoryCostTorque::evaluate(const NewEvalManager* evaluation_manager, in
 	return is_feasible;
 }
 
+int TrajectoryCostTorque::getNumResiduals(const NewEvalManager* evaluation_manager) const
+{
+    return evaluation_manager->joint_torques_[0].rows();
+}
+
+bool TrajectoryCostTorque::evaluateResiduals(const NewEvalManager* evaluation_manager, int point, double* residuals) const
+{
+    const Eigen::VectorXd& joint_torques = evaluation_manager->joint_torques_[point];
+    for (int i = 0; i < joint_torques.rows(); ++i)
+        residuals[i] = (PhaseManager::getInstance()->getPhase() < 3) ? 0.0 : joint_torques(i);
+
+    return true;
+}
+
+// the planner node keeps the other agents in CrowdManager
 ITOMP_TRAJECTORY_COST_EMPTY_INIT_FUNC(RVO)
+bool TrajectoryCostRVO::isInvariant(const NewEvalManager* evaluation_manager, const ItompTrajectoryIndex& index) const
+{
+    // depends only on the root x, y
+    return (index.sub_component != ItompTrajectory::SUB_COMPONENT_TYPE_JOINT || index.element >= 2);
+}
+
 bool TrajectoryCostRVO::evaluate(const NewEvalManager* evaluation_manager,
 								 int point, double& cost) const
 {
 	bool is_feasible = true;
 	cost = 0;
 
-	// implement
+    const CrowdManager* crowd_manager = CrowdManager::getInstance();
+    if (!crowd_manager->hasNeighbors())
+        return is_feasible;
+
+    const ElementTrajectoryConstPtr& joint_trajectory = evaluation_manager->getTrajectory()->getElementTrajectory(
+                ItompTrajectory::COMPONENT_TYPE_POSITION, ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+
+    cost = crowd_manager->computeNeighborCost(crowd_manager->getCurrentAgent(), point,
+            (*joint_trajectory)(point, 0), (*joint_trajectory)(point, 1));
+    is_feasible = (cost == 0.0);
 
 	return is_feasible;
 }
@@ -582,8 +693,12 @@ namespace
 std::vector<rom::ROM> roms_;
 }
 
-void TrajectoryCostROM::initialize(const NewEvalManager* evaluation_manager)
+void loadROMFiles()
 {
+    // loaded once, by the first request or the pre-warm
+    if (!roms_.empty())
+        return;
+
 	// load rom files
 	// right_arm
 	std::string source(
@@ -598,6 +713,11 @@ void TrajectoryCostROM::initialize(const NewEvalManager* evaluation_manager)
 	roms_.push_back(rom::ROMFromFile(leftLegRom));
 }
 
+void TrajectoryCostROM::initialize(const NewEvalManager* evaluation_manager)
+{
+    loadROMFiles();
+}
+
 bool TrajectoryCostROM::evaluate(const NewEvalManager* evaluation_manager,
 								 int point, double& cost) const
 {
@@ -1,4 +1,5 @@
 #include <itomp_cio_planner/itomp_planning_interface.h>
+#include <itomp_cio_planner/planner/itomp_planner_node.h>
 
 namespace itomp_cio_planner
 {
@@ -25,6 +26,13 @@ bool ItompPlanningContext::solve(planning_interface::MotionPlanResponse &res)
 	group_ = request_.group_name;
 	return itomp_planner_node_->planTrajectory(planning_scene_, request_, res);
 }
+bool ItompPlanningContext::solve(const std::vector<planning_interface::MotionPlanRequest>& reqs,
+								 std::vector<planning_interface::MotionPlanResponse>& res)
+{
+	if (!reqs.empty())
+		group_ = reqs[0].group_name;
+	return itomp_planner_node_->planTrajectories(planning_scene_, reqs, res);
+}
 bool ItompPlanningContext::solve(planning_interface::MotionPlanDetailedResponse &res)
 {
 	// TODO:
@@ -2,6 +2,8 @@
 #include <itomp_cio_planner/model/itomp_robot_model_ik.h>
 #include <itomp_cio_planner/util/planning_parameters.h>
 #include <itomp_cio_planner/model/rbdl_urdf_reader.h>
+#include <itomp_cio_planner/model/rbdl_model_cache.h>
+#include <itomp_cio_planner/model/rbdl_model_util.h>
 #include <ros/ros.h>
 #include <visualization_msgs/MarkerArray.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
@@ -48,23 +50,55 @@ bool ItompRobotModel::init(const robot_model::RobotModelConstPtr& robot_model)
     std::vector<std::vector<unsigned int> > rbdl_affected_body_ids_vector(urdf_joints.size() + 1);
 	////////////////////////////////////////////////////////////////////////////
 	{
-        ReadURDFModel(urdf_string.c_str(), &rbdl_robot_model_);
-
-		// rbdl_robot_model_.mJoints[0] is not used
-		num_rbdl_joints_ = rbdl_robot_model_.mJoints.size() - 1;
-		rbdl_number_to_joint_name_.resize(rbdl_robot_model_.mJoints.size());
+        // use the serialized model if it was built from the same urdf
+        const std::string& model_cache_file = PlanningParameters::getInstance()->getRBDLModelCacheFile();
+        const uint64_t urdf_hash = RBDLModelCache::computeURDFHash(urdf_string);
+        RBDLModelCache model_cache;
+        bool use_model_cache = !model_cache_file.empty() && model_cache.load(model_cache_file, urdf_hash)
+                               && model_cache.rbdl_affected_body_ids_.size() == rbdl_affected_body_ids_vector.size();
+        if (use_model_cache && !model_cache.buildModel(rbdl_robot_model_))
+        {
+            ROS_ERROR("Failed to build RBDL model from cache %s", model_cache_file.c_str());
+            rbdl_robot_model_ = RigidBodyDynamics::Model();
+            use_model_cache = false;
+        }
 
-		// compute rbdl_affected_body_ids for partial FK
-		for (unsigned int i = 1; i < rbdl_robot_model_.mJoints.size(); ++i)
-		{
-			unsigned int current = i;
-			do
-			{
-				rbdl_affected_body_ids_vector[current].push_back(i);
-				current = rbdl_robot_model_.lambda[current];
-			}
-			while (current != 0);
-		}
+        if (use_model_cache)
+        {
+            // rbdl_robot_model_.mJoints[0] is not used
+            num_rbdl_joints_ = rbdl_robot_model_.mJoints.size() - 1;
+
+            rbdl_affected_body_ids_vector = model_cache.rbdl_affected_body_ids_;
+            rbdl_number_to_joint_name_ = model_cache.rbdl_number_to_joint_name_;
+            rbdl_number_to_joint_name_.resize(rbdl_robot_model_.mJoints.size());
+            for (unsigned int i = 0; i < rbdl_number_to_joint_name_.size(); ++i)
+            {
+                if (rbdl_number_to_joint_name_[i] != "")
+                    joint_name_to_rbdl_number_.insert(make_pair(rbdl_number_to_joint_name_[i], (int) i));
+            }
+
+            ROS_INFO("Loaded RBDL model from cache %s", model_cache_file.c_str());
+        }
+        else
+        {
+            ReadURDFModel(urdf_string.c_str(), &rbdl_robot_model_, false, &model_cache.body_records_);
+
+            // rbdl_robot_model_.mJoints[0] is not used
+            num_rbdl_joints_ = rbdl_robot_model_.mJoints.size() - 1;
+            rbdl_number_to_joint_name_.resize(rbdl_robot_model_.mJoints.size());
+
+            // compute rbdl_affected_body_ids for partial FK
+            for (unsigned int i = 1; i < rbdl_robot_model_.mJoints.size(); ++i)
+            {
+                unsigned int current = i;
+                do
+                {
+                    rbdl_affected_body_ids_vector[current].push_back(i);
+                    current = rbdl_robot_model_.lambda[current];
+                }
+                while (current != 0);
+            }
+        }
 
 		// initialize the planning groups
 		const std::vector<const robot_model::JointModelGroup*>& jointModelGroups =
@@ -109,6 +143,7 @@ bool ItompRobotModel::init(const robot_model::RobotModelConstPtr& robot_model)
 				joint.link_name_ = link_name;
 				joint.joint_name_ = joint_name;
                 joint.rbdl_affected_body_ids_ = rbdl_affected_body_ids_vector[body_id];
+                computeSubtreeRange(joint, body_id);
 
 				switch (rbdl_joint.mJointType)
 				{
@@ -165,6 +200,14 @@ bool ItompRobotModel::init(const robot_model::RobotModelConstPtr& robot_model)
 			planning_groups_.insert(make_pair(group->name_, group));
 		}
 
+        if (!model_cache_file.empty() && !use_model_cache)
+        {
+            model_cache.rbdl_affected_body_ids_ = rbdl_affected_body_ids_vector;
+            model_cache.rbdl_number_to_joint_name_ = rbdl_number_to_joint_name_;
+            if (model_cache.save(model_cache_file, urdf_hash))
+                ROS_INFO("Saved RBDL model cache %s", model_cache_file.c_str());
+        }
+
         if (PlanningParameters::getInstance()->getPrintPlanningInfo())
         {
             ROS_INFO("RBDL Model Initialized");
@@ -219,10 +262,112 @@ bool ItompRobotModel::init(const robot_model::RobotModelConstPtr& robot_model)
 		}
 	}
 
+    if (PlanningParameters::getInstance()->getPartialFKBenchmarkNumTrials() > 0)
+    {
+        for (std::map<std::string, ItompPlanningGroupConstPtr>::const_iterator it = planning_groups_.begin(); it != planning_groups_.end(); ++it)
+            benchmarkPartialKinematics(*it->second, PlanningParameters::getInstance()->getPartialFKBenchmarkNumTrials());
+    }
+
     ROS_INFO("Initialized ITOMP robot model in %s reference frame.", reference_frame_.c_str());
 
 	return true;
 }
 
+void ItompRobotModel::computeSubtreeRange(ItompRobotJoint& joint, unsigned int body_id) const
+{
+    // ids of a subtree are contiguous when the bodies were added in depth-first order
+    const std::vector<unsigned int>& subtree = joint.rbdl_affected_body_ids_;
+    if (!subtree.empty() && subtree.back() - subtree.front() + 1 == subtree.size())
+    {
+        joint.rbdl_subtree_begin_ = subtree.front();
+        joint.rbdl_subtree_end_ = subtree.back() + 1;
+    }
+    else
+    {
+        joint.rbdl_subtree_begin_ = joint.rbdl_subtree_end_ = 0;
+    }
+
+    joint.rbdl_ancestor_body_ids_.clear();
+    for (unsigned int i = rbdl_robot_model_.lambda[body_id]; i != 0; i = rbdl_robot_model_.lambda[i])
+        joint.rbdl_ancestor_body_ids_.push_back(i);
+}
+
+void ItompRobotModel::benchmarkPartialKinematics(const ItompPlanningGroup& planning_group, int num_trials) const
+{
+    if (planning_group.group_joints_.empty())
+        return;
+
+    RigidBodyDynamics::Model ref_model = rbdl_robot_model_;
+    RigidBodyDynamics::Model model = rbdl_robot_model_;
+    int q_size = ref_model.q_size;
+    Eigen::VectorXd q = Eigen::VectorXd::Zero(q_size);
+    Eigen::VectorXd q_dot = Eigen::VectorXd::Zero(q_size);
+    Eigen::VectorXd q_ddot = Eigen::VectorXd::Zero(q_size);
+    Eigen::VectorXd tau(q_size);
+    Eigen::VectorXd ref_tau(q_size);
+    updateFullKinematicsAndDynamics(ref_model, q, q_dot, q_ddot, ref_tau, NULL, NULL);
+
+    // 0 : full update, 1 : body id list with a full state restore, 2 : subtree range with a subtree restore
+    double elapsed[3] = { 0.0, 0.0, 0.0 };
+    double max_error = 0.0;
+    const double eps = 1e-4;
+    for (int t = 0; t < num_trials; ++t)
+    {
+        for (int j = 0; j < planning_group.group_joints_.size(); ++j)
+        {
+            const ItompRobotJoint& joint = planning_group.group_joints_[j];
+            q(joint.rbdl_joint_index_) += eps;
+
+            ros::WallTime start_time = ros::WallTime::now();
+            updateFullKinematicsAndDynamics(model, q, q_dot, q_ddot, tau, NULL, NULL);
+            elapsed[0] += (ros::WallTime::now() - start_time).toSec();
+            Eigen::VectorXd full_tau = tau;
+
+            start_time = ros::WallTime::now();
+            model.f = ref_model.f;
+            model.X_lambda = ref_model.X_lambda;
+            model.X_base = ref_model.X_base;
+            model.v = ref_model.v;
+            model.a = ref_model.a;
+            model.c = ref_model.c;
+            tau = ref_tau;
+            updatePartialKinematicsAndDynamics(model, q, q_dot, q_ddot, tau, NULL, NULL, joint.rbdl_affected_body_ids_);
+            elapsed[1] += (ros::WallTime::now() - start_time).toSec();
+            max_error = std::max(max_error, (tau - full_tau).cwiseAbs().maxCoeff());
+
+            if (joint.rbdl_subtree_begin_ != joint.rbdl_subtree_end_)
+            {
+                // the previous update left only this subtree and its ancestors modified
+                start_time = ros::WallTime::now();
+                for (unsigned int i = joint.rbdl_subtree_begin_; i < joint.rbdl_subtree_end_; ++i)
+                {
+                    model.f[i] = ref_model.f[i];
+                    model.X_lambda[i] = ref_model.X_lambda[i];
+                    model.X_base[i] = ref_model.X_base[i];
+                    model.v[i] = ref_model.v[i];
+                    model.a[i] = ref_model.a[i];
+                    model.c[i] = ref_model.c[i];
+                }
+                for (unsigned int k = 0; k < joint.rbdl_ancestor_body_ids_.size(); ++k)
+                    model.f[joint.rbdl_ancestor_body_ids_[k]] = ref_model.f[joint.rbdl_ancestor_body_ids_[k]];
+                tau = ref_tau;
+                updateSubtreeKinematicsAndDynamics(model, q, q_dot, q_ddot, tau, NULL, NULL,
+                                                   joint.rbdl_subtree_begin_, joint.rbdl_subtree_end_, joint.rbdl_ancestor_body_ids_);
+                elapsed[2] += (ros::WallTime::now() - start_time).toSec();
+                max_error = std::max(max_error, (tau - full_tau).cwiseAbs().maxCoeff());
+            }
+
+            q(joint.rbdl_joint_index_) -= eps;
+            model = ref_model;
+        }
+    }
+
+    int num_variables = num_trials * planning_group.group_joints_.size();
+    ROS_INFO("Partial FK benchmark for group %s : %d joints, %d trials", planning_group.name_.c_str(),
+             (int)planning_group.group_joints_.size(), num_trials);
+    ROS_INFO("Full : %f us/variable, body list : %f us/variable, subtree : %f us/variable, max torque error %e",
+             elapsed[0] * 1e6 / num_variables, elapsed[1] * 1e6 / num_variables, elapsed[2] * 1e6 / num_variables, max_error);
+}
+
 
 }
@@ -0,0 +1,223 @@
+#include <itomp_cio_planner/model/rbdl_model_cache.h>
+#include <ros/console.h>
+#include <cstring>
+
+using namespace std;
+
+namespace itomp_cio_planner
+{
+
+const char RBDLModelCache::FILE_MAGIC[8] = { 'I', 'T', 'O', 'M', 'P', 'R', 'B', 'D' };
+const uint32_t RBDLModelCache::FILE_VERSION = 1;
+
+namespace
+{
+
+template<typename T>
+void writeValue(std::ofstream& out, const T& value)
+{
+	out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template<typename T>
+bool readValue(std::ifstream& in, T& value)
+{
+	in.read(reinterpret_cast<char*>(&value), sizeof(T));
+	return in.good();
+}
+
+void writeString(std::ofstream& out, const std::string& str)
+{
+	writeValue(out, (uint32_t) str.size());
+	out.write(str.data(), str.size());
+}
+
+bool readString(std::ifstream& in, std::string& str)
+{
+	uint32_t size;
+	if (!readValue(in, size))
+		return false;
+	str.resize(size);
+	if (size > 0)
+		in.read(&str[0], size);
+	return in.good();
+}
+
+// fixed-size eigen matrices
+template<typename Derived>
+void writeMatrix(std::ofstream& out, const Eigen::MatrixBase<Derived>& m)
+{
+	for (int i = 0; i < m.rows(); ++i)
+		for (int j = 0; j < m.cols(); ++j)
+			writeValue(out, (double) m(i, j));
+}
+
+template<typename Derived>
+bool readMatrix(std::ifstream& in, Eigen::MatrixBase<Derived>& m)
+{
+	for (int i = 0; i < m.rows(); ++i)
+		for (int j = 0; j < m.cols(); ++j)
+			if (!readValue(in, m(i, j)))
+				return false;
+	return true;
+}
+
+}
+
+RBDLModelCache::RBDLModelCache()
+{
+}
+
+RBDLModelCache::~RBDLModelCache()
+{
+}
+
+uint64_t RBDLModelCache::computeURDFHash(const std::string& urdf_string)
+{
+	// 64-bit FNV-1a
+	uint64_t hash = 14695981039346656037ULL;
+	for (unsigned int i = 0; i < urdf_string.size(); ++i)
+	{
+		hash ^= (unsigned char) urdf_string[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+bool RBDLModelCache::load(const std::string& file_name, uint64_t urdf_hash)
+{
+	body_records_.clear();
+	rbdl_affected_body_ids_.clear();
+	rbdl_number_to_joint_name_.clear();
+
+	std::ifstream in(file_name.c_str(), std::ios::in | std::ios::binary);
+	if (!in.is_open())
+		return false;
+
+	char magic[8];
+	in.read(magic, sizeof(magic));
+	uint32_t version;
+	uint64_t file_urdf_hash;
+	if (!in.good() || memcmp(magic, FILE_MAGIC, sizeof(magic)) != 0
+			|| !readValue(in, version) || version != FILE_VERSION
+			|| !readValue(in, file_urdf_hash))
+	{
+		ROS_INFO("RBDL model cache %s has an invalid header", file_name.c_str());
+		return false;
+	}
+	if (file_urdf_hash != urdf_hash)
+	{
+		ROS_INFO("RBDL model cache %s is out of date", file_name.c_str());
+		return false;
+	}
+
+	bool valid = true;
+
+	uint32_t num_bodies;
+	valid = valid && readValue(in, num_bodies);
+	if (valid)
+		body_records_.resize(num_bodies);
+	for (unsigned int i = 0; valid && i < body_records_.size(); ++i)
+	{
+		RBDLBodyRecord& record = body_records_[i];
+		valid = valid && readValue(in, record.parent_id_);
+		valid = valid && readMatrix(in, record.joint_frame_.E);
+		valid = valid && readMatrix(in, record.joint_frame_.r);
+		valid = valid && readValue(in, record.joint_dof_count_) && record.joint_dof_count_ <= 6;
+		for (unsigned int j = 0; valid && j < record.joint_dof_count_; ++j)
+			valid = readMatrix(in, record.joint_axes_[j]);
+		valid = valid && readValue(in, record.mass_);
+		valid = valid && readMatrix(in, record.com_);
+		valid = valid && readMatrix(in, record.inertia_);
+		valid = valid && readString(in, record.name_);
+	}
+
+	uint32_t num_affected_body_ids;
+	valid = valid && readValue(in, num_affected_body_ids);
+	if (valid)
+		rbdl_affected_body_ids_.resize(num_affected_body_ids);
+	for (unsigned int i = 0; valid && i < rbdl_affected_body_ids_.size(); ++i)
+	{
+		uint32_t size;
+		valid = readValue(in, size);
+		if (valid)
+			rbdl_affected_body_ids_[i].resize(size);
+		for (unsigned int j = 0; valid && j < rbdl_affected_body_ids_[i].size(); ++j)
+			valid = readValue(in, rbdl_affected_body_ids_[i][j]);
+	}
+
+	uint32_t num_joint_names;
+	valid = valid && readValue(in, num_joint_names);
+	if (valid)
+		rbdl_number_to_joint_name_.resize(num_joint_names);
+	for (unsigned int i = 0; valid && i < rbdl_number_to_joint_name_.size(); ++i)
+		valid = readString(in, rbdl_number_to_joint_name_[i]);
+
+	if (!valid)
+	{
+		ROS_ERROR("Failed to read RBDL model cache %s", file_name.c_str());
+		body_records_.clear();
+		rbdl_affected_body_ids_.clear();
+		rbdl_number_to_joint_name_.clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool RBDLModelCache::save(const std::string& file_name, uint64_t urdf_hash) const
+{
+	std::ofstream out(file_name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+	{
+		ROS_ERROR("Failed to open RBDL model cache %s for writing", file_name.c_str());
+		return false;
+	}
+
+	out.write(FILE_MAGIC, sizeof(FILE_MAGIC));
+	writeValue(out, FILE_VERSION);
+	writeValue(out, urdf_hash);
+
+	writeValue(out, (uint32_t) body_records_.size());
+	for (unsigned int i = 0; i < body_records_.size(); ++i)
+	{
+		const RBDLBodyRecord& record = body_records_[i];
+		writeValue(out, record.parent_id_);
+		writeMatrix(out, record.joint_frame_.E);
+		writeMatrix(out, record.joint_frame_.r);
+		writeValue(out, record.joint_dof_count_);
+		for (unsigned int j = 0; j < record.joint_dof_count_; ++j)
+			writeMatrix(out, record.joint_axes_[j]);
+		writeValue(out, record.mass_);
+		writeMatrix(out, record.com_);
+		writeMatrix(out, record.inertia_);
+		writeString(out, record.name_);
+	}
+
+	writeValue(out, (uint32_t) rbdl_affected_body_ids_.size());
+	for (unsigned int i = 0; i < rbdl_affected_body_ids_.size(); ++i)
+	{
+		writeValue(out, (uint32_t) rbdl_affected_body_ids_[i].size());
+		for (unsigned int j = 0; j < rbdl_affected_body_ids_[i].size(); ++j)
+			writeValue(out, rbdl_affected_body_ids_[i][j]);
+	}
+
+	writeValue(out, (uint32_t) rbdl_number_to_joint_name_.size());
+	for (unsigned int i = 0; i < rbdl_number_to_joint_name_.size(); ++i)
+		writeString(out, rbdl_number_to_joint_name_[i]);
+
+	if (!out.good())
+	{
+		ROS_ERROR("Failed to write RBDL model cache %s", file_name.c_str());
+		return false;
+	}
+
+	return true;
+}
+
+bool RBDLModelCache::buildModel(RigidBodyDynamics::Model& model) const
+{
+	return ConstructModelFromRecords(body_records_, &model);
+}
+
+}
@@ -1,4 +1,8 @@
 #include <itomp_cio_planner/model/rbdl_model_util.h>
+#include <ros/ros.h>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/uniform_real.hpp>
+#include <boost/random/variate_generator.hpp>
 
 using namespace RigidBodyDynamics;
 using namespace RigidBodyDynamics::Math;
@@ -90,6 +94,88 @@ void updateFullKinematicsAndDynamics(RigidBodyDynamics::Model &model,
 	}
 }
 
+// forward kinematics (transforms and velocity) of body i
+static inline void updateBodyPositionAndVelocity(Model &model, unsigned int i,
+        const VectorNd &Q, const VectorNd &QDot)
+{
+    unsigned int lambda = model.lambda[i];
+
+    jcalc(model, i, Q, QDot);
+
+    // forward kinematics
+    model.X_lambda[i] = model.X_J[i] * model.X_T[i];
+
+    if (lambda != 0)
+    {
+        model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
+        model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
+    }
+    else
+    {
+        model.X_base[i] = model.X_lambda[i];
+        model.v[i] = model.v_J[i];
+    }
+}
+
+// forward kinematics (transforms, velocity and acceleration) of body i
+static inline void updateBodyKinematics(Model &model, unsigned int i,
+        const VectorNd &Q, const VectorNd &QDot, const VectorNd &QDDot)
+{
+    unsigned int q_index = model.mJoints[i].q_index;
+    unsigned int lambda = model.lambda[i];
+
+    updateBodyPositionAndVelocity(model, i, Q, QDot);
+
+    model.c[i] = model.c_J[i] + crossm(model.v[i], model.v_J[i]);
+    model.a[i] = model.X_lambda[i].apply(model.a[lambda]) + model.c[i];
+
+    if (model.mJoints[i].mDoFCount == 3)
+    {
+        Vector3d omegadot_temp (QDDot[q_index], QDDot[q_index + 1], QDDot[q_index + 2]);
+        model.a[i] = model.a[i] + model.multdof3_S[i] * omegadot_temp;
+    }
+    else
+    {
+        model.a[i] = model.a[i] + model.S[i] * QDDot[q_index];
+    }
+}
+
+// forward kinematics and the local inverse dynamics force of body i
+static inline void updateBodyKinematicsAndForce(Model &model, unsigned int i,
+        const VectorNd &Q, const VectorNd &QDot, const VectorNd &QDDot,
+        const std::vector<SpatialVector> *f_ext, const std::vector<double> *joint_forces)
+{
+    updateBodyKinematics(model, i, Q, QDot, QDDot);
+
+    // inverse dynamics
+    if (!model.mBodies[i].mIsVirtual)
+    {
+        model.f[i] = model.I[i] * model.a[i] + crossf(model.v[i],model.I[i] * model.v[i]);
+    }
+    else
+    {
+        model.f[i].setZero();
+    }
+
+    if (joint_forces != NULL && (*joint_forces)[i] != 0.0)
+        model.f[i] += model.S[i] * (*joint_forces)[i];
+
+    if (f_ext != NULL && (*f_ext)[i] != SpatialVectorZero)
+        model.f[i] += model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
+}
+
+static inline void updateJointTorque(Model &model, unsigned int i, VectorNd &Tau)
+{
+    if (model.mJoints[i].mDoFCount == 3)
+    {
+        Tau.block<3,1>(model.mJoints[i].q_index, 0) = model.multdof3_S[i].transpose() * model.f[i];
+    }
+    else
+    {
+        Tau[model.mJoints[i].q_index] = model.S[i].dot(model.f[i]);
+    }
+}
+
 void updatePartialKinematicsAndDynamics(RigidBodyDynamics::Model &model,
 										const RigidBodyDynamics::Math::VectorNd &Q,
 										const RigidBodyDynamics::Math::VectorNd &QDot,
@@ -99,8 +185,6 @@ void updatePartialKinematicsAndDynamics(RigidBodyDynamics::Model &model,
                                         const std::vector<double> *joint_forces,
 										const std::vector<unsigned int>& body_ids)
 {
-    SpatialVector spatial_gravity(0., 0., 0., model.gravity[0], model.gravity[1], model.gravity[2]);
-
 	unsigned int i;
 
 	// subtract the force of body_ids[0] from parents
@@ -117,70 +201,13 @@ void updatePartialKinematicsAndDynamics(RigidBodyDynamics::Model &model,
 	}
 
 	for (unsigned int id = 0; id < body_ids.size(); ++id)
-	{
-		i = body_ids[id];
-
-		unsigned int q_index = model.mJoints[i].q_index;
-		unsigned int lambda = model.lambda[i];
-
-        jcalc(model, i, Q, QDot);
-
-        // forward kinematics
-        model.X_lambda[i] = model.X_J[i] * model.X_T[i];
-
-        if (lambda != 0)
-        {
-            model.X_base[i] = model.X_lambda[i] * model.X_base[lambda];
-            model.v[i] = model.X_lambda[i].apply(model.v[lambda]) + model.v_J[i];
-        }
-        else
-        {
-            model.X_base[i] = model.X_lambda[i];
-            model.v[i] = model.v_J[i];
-        }
-
-        model.c[i] = model.c_J[i] + crossm(model.v[i], model.v_J[i]);
-        model.a[i] = model.X_lambda[i].apply(model.a[lambda]) + model.c[i];
-
-        if (model.mJoints[i].mDoFCount == 3)
-        {
-            Vector3d omegadot_temp (QDDot[q_index], QDDot[q_index + 1], QDDot[q_index + 2]);
-            model.a[i] = model.a[i] + model.multdof3_S[i] * omegadot_temp;
-        }
-        else
-        {
-            model.a[i] = model.a[i] + model.S[i] * QDDot[q_index];
-        }
-
-        // inverse dynamics
-        if (!model.mBodies[i].mIsVirtual)
-        {
-            model.f[i] = model.I[i] * model.a[i] + crossf(model.v[i],model.I[i] * model.v[i]);
-        }
-        else
-        {
-            model.f[i].setZero();
-        }
-
-        if (joint_forces != NULL && (*joint_forces)[i] != 0.0)
-            model.f[i] += model.S[i] * (*joint_forces)[i];
-
-        if (f_ext != NULL && (*f_ext)[i] != SpatialVectorZero)
-            model.f[i] += model.X_base[i].toMatrixAdjoint() * (*f_ext)[i];
-	}
+        updateBodyKinematicsAndForce(model, body_ids[id], Q, QDot, QDDot, f_ext, joint_forces);
 
 	for (int id = body_ids.size() - 1; id > 0; --id)
 	{
 		i = body_ids[id];
 
-        if (model.mJoints[i].mDoFCount == 3)
-        {
-            Tau.block<3,1>(model.mJoints[i].q_index, 0) = model.multdof3_S[i].transpose() * model.f[i];
-        }
-        else
-        {
-            Tau[model.mJoints[i].q_index] = model.S[i].dot(model.f[i]);
-        }
+        updateJointTorque(model, i, Tau);
 
         if (model.lambda[i] != 0)
         {
@@ -194,14 +221,7 @@ void updatePartialKinematicsAndDynamics(RigidBodyDynamics::Model &model,
 
 	while (i != 0)
 	{
-		if (model.mJoints[i].mDoFCount == 3)
-		{
-            Tau.block<3,1>(model.mJoints[i].q_index, 0) = model.multdof3_S[i].transpose() * model.f[i];
-		}
-		else
-		{
-            Tau[model.mJoints[i].q_index] = model.S[i].dot(model.f[i]);
-		}
+        updateJointTorque(model, i, Tau);
 
 		if (lambda != 0)
 		{
@@ -214,6 +234,199 @@ void updatePartialKinematicsAndDynamics(RigidBodyDynamics::Model &model,
 	}
 }
 
+void updateSubtreeKinematicsAndDynamics(RigidBodyDynamics::Model &model,
+                                        const RigidBodyDynamics::Math::VectorNd &Q,
+                                        const RigidBodyDynamics::Math::VectorNd &QDot,
+                                        const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                        RigidBodyDynamics::Math::VectorNd &Tau,
+                                        const std::vector<RigidBodyDynamics::Math::SpatialVector> *f_ext,
+                                        const std::vector<double> *joint_forces,
+                                        unsigned int subtree_begin, unsigned int subtree_end,
+                                        const std::vector<unsigned int>& ancestor_body_ids)
+{
+    // ancestors only receive the change of the force transmitted by the subtree root.
+    // the joint transform of the root changes too, so the old force is transformed before the update
+    unsigned int i = subtree_begin;
+    SpatialVector propagated_force;
+    if (!ancestor_body_ids.empty())
+        propagated_force = -model.X_lambda[i].applyTranspose(model.f[i]);
+
+    // kinematics and local forces of the subtree. parents have smaller ids than their children
+    for (i = subtree_begin; i < subtree_end; ++i)
+        updateBodyKinematicsAndForce(model, i, Q, QDot, QDDot, f_ext, joint_forces);
+
+    for (i = subtree_end - 1; i > subtree_begin; --i)
+    {
+        updateJointTorque(model, i, Tau);
+        model.f[model.lambda[i]] += model.X_lambda[i].applyTranspose(model.f[i]);
+    }
+    updateJointTorque(model, subtree_begin, Tau);
+
+    if (ancestor_body_ids.empty())
+        return;
+
+    // propagate the force difference along the ancestor chain
+    propagated_force += model.X_lambda[subtree_begin].applyTranspose(model.f[subtree_begin]);
+    for (unsigned int k = 0; k < ancestor_body_ids.size(); ++k)
+    {
+        i = ancestor_body_ids[k];
+        model.f[i] += propagated_force;
+        updateJointTorque(model, i, Tau);
+
+        if (k + 1 < ancestor_body_ids.size())
+            propagated_force = model.X_lambda[i].applyTranspose(propagated_force);
+    }
+}
+
+// rate of change of the momentum of body i, in base coordinates
+static inline SpatialVector computeBodyMomentumRate(Model &model, unsigned int i)
+{
+    if (model.mBodies[i].mIsVirtual)
+        return SpatialVectorZero;
+    return model.X_base[i].applyTranspose(model.I[i] * model.a[i] + crossf(model.v[i], model.I[i] * model.v[i]));
+}
+
+void updateFullKinematicsAndMomentumRates(RigidBodyDynamics::Model &model,
+                                          const RigidBodyDynamics::Math::VectorNd &Q,
+                                          const RigidBodyDynamics::Math::VectorNd &QDot,
+                                          const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                          RigidBodyDynamics::Math::SpatialVector &momentum_rate)
+{
+    SpatialVector spatial_gravity(0., 0., 0., model.gravity[0], model.gravity[1], model.gravity[2]);
+
+    // Reset the velocity of the root body
+    model.v[0].setZero();
+    model.a[0] = spatial_gravity;
+
+    momentum_rate.setZero();
+    for (unsigned int i = 1; i < model.mBodies.size(); i++)
+    {
+        updateBodyKinematics(model, i, Q, QDot, QDDot);
+        model.f[i] = computeBodyMomentumRate(model, i);
+        momentum_rate += model.f[i];
+    }
+}
+
+void updatePartialKinematicsAndMomentumRates(RigidBodyDynamics::Model &model,
+                                             const RigidBodyDynamics::Math::VectorNd &Q,
+                                             const RigidBodyDynamics::Math::VectorNd &QDot,
+                                             const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                             RigidBodyDynamics::Math::SpatialVector &momentum_rate,
+                                             const std::vector<unsigned int>& body_ids)
+{
+    for (unsigned int id = 0; id < body_ids.size(); ++id)
+    {
+        unsigned int i = body_ids[id];
+
+        momentum_rate -= model.f[i];
+        updateBodyKinematics(model, i, Q, QDot, QDDot);
+        model.f[i] = computeBodyMomentumRate(model, i);
+        momentum_rate += model.f[i];
+    }
+}
+
+// momentum rate of the whole body in base coordinates, approximated by its composite inertia rigidly
+// attached to the last root body. the composite inertia is accumulated like in CRBA
+static void computeCentroidalMomentumRate(Model &model, const std::vector<unsigned int>& root_body_ids,
+        SpatialVector &momentum_rate)
+{
+    unsigned int root = root_body_ids.back();
+    for (unsigned int i = root; i < model.mBodies.size(); i++)
+        model.Ic[i] = model.I[i];
+    for (unsigned int i = model.mBodies.size() - 1; i > root; i--)
+    {
+        unsigned int lambda = model.lambda[i];
+        if (lambda >= root)
+            model.Ic[lambda] = model.Ic[lambda] + model.X_lambda[i].applyTranspose(model.Ic[i]);
+    }
+
+    SpatialVector h = model.Ic[root] * model.v[root];
+    momentum_rate = model.X_base[root].applyTranspose(model.Ic[root] * model.a[root] + crossf(model.v[root], h));
+
+    // the root bodies are included in the composite inertia
+    for (unsigned int k = 0; k < root_body_ids.size(); ++k)
+        model.f[root_body_ids[k]].setZero();
+}
+
+void updateFullKinematicsAndCentroidalMomentumRate(RigidBodyDynamics::Model &model,
+                                                   const RigidBodyDynamics::Math::VectorNd &Q,
+                                                   const RigidBodyDynamics::Math::VectorNd &QDot,
+                                                   const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                                   RigidBodyDynamics::Math::SpatialVector &momentum_rate,
+                                                   const std::vector<unsigned int>& root_body_ids)
+{
+    SpatialVector spatial_gravity(0., 0., 0., model.gravity[0], model.gravity[1], model.gravity[2]);
+
+    // Reset the velocity of the root body
+    model.v[0].setZero();
+    model.a[0] = spatial_gravity;
+
+    // accelerations are needed only for the root bodies
+    unsigned int root = root_body_ids.back();
+    for (unsigned int i = 1; i < model.mBodies.size(); i++)
+    {
+        if (i <= root)
+            updateBodyKinematics(model, i, Q, QDot, QDDot);
+        else
+            updateBodyPositionAndVelocity(model, i, Q, QDot);
+    }
+
+    computeCentroidalMomentumRate(model, root_body_ids, momentum_rate);
+}
+
+void updatePartialKinematicsAndCentroidalMomentumRate(RigidBodyDynamics::Model &model,
+                                                      const RigidBodyDynamics::Math::VectorNd &Q,
+                                                      const RigidBodyDynamics::Math::VectorNd &QDot,
+                                                      const RigidBodyDynamics::Math::VectorNd &QDDot,
+                                                      RigidBodyDynamics::Math::SpatialVector &momentum_rate,
+                                                      const std::vector<unsigned int>& root_body_ids,
+                                                      const std::vector<unsigned int>& body_ids)
+{
+    unsigned int root = root_body_ids.back();
+    for (unsigned int id = 0; id < body_ids.size(); ++id)
+    {
+        unsigned int i = body_ids[id];
+        if (i <= root)
+            updateBodyKinematics(model, i, Q, QDot, QDDot);
+        else
+            updateBodyPositionAndVelocity(model, i, Q, QDot);
+    }
+
+    computeCentroidalMomentumRate(model, root_body_ids, momentum_rate);
+}
+
+void computeRootJointTorques(RigidBodyDynamics::Model &model,
+                             const RigidBodyDynamics::Math::SpatialVector &momentum_rate,
+                             const std::vector<RigidBodyDynamics::Math::SpatialVector> *f_ext,
+                             const std::vector<double> *joint_forces,
+                             const std::vector<unsigned int>& root_body_ids,
+                             RigidBodyDynamics::Math::VectorNd &Tau)
+{
+    // wrench transmitted by the first root joint, in base coordinates
+    SpatialVector wrench = momentum_rate;
+    for (unsigned int i = 1; i < model.mBodies.size(); i++)
+    {
+        if (joint_forces != NULL && (*joint_forces)[i] != 0.0)
+            wrench += model.X_base[i].applyTranspose(model.S[i] * (*joint_forces)[i]);
+
+        if (f_ext != NULL && (*f_ext)[i] != SpatialVectorZero)
+            wrench += (*f_ext)[i];
+    }
+
+    for (unsigned int k = 0; k < root_body_ids.size(); ++k)
+    {
+        unsigned int i = root_body_ids[k];
+        Tau[model.mJoints[i].q_index] = model.S[i].dot(model.X_base[i].applyAdjoint(wrench));
+
+        // a body of the root chain is not in the subtree of the next root joint
+        wrench -= model.f[i];
+        if (joint_forces != NULL && (*joint_forces)[i] != 0.0)
+            wrench -= model.X_base[i].applyTranspose(model.S[i] * (*joint_forces)[i]);
+        if (f_ext != NULL && (*f_ext)[i] != SpatialVectorZero)
+            wrench -= (*f_ext)[i];
+    }
+}
+
 void updatePartialDynamics(RigidBodyDynamics::Model &model,
 						   const RigidBodyDynamics::Math::VectorNd &Q,
 						   const RigidBodyDynamics::Math::VectorNd &QDot,
@@ -314,16 +527,18 @@ void UpdatePartialKinematics(RigidBodyDynamics::Model & model,
 	}
 }
 
-bool InverseKinematics6D (
+// euler angle based solver which InverseKinematics6D replaced. kept only as the benchmark reference.
+static bool InverseKinematics6DEuler (
         Model &model,
         const VectorNd &Qinit,
         const std::vector<unsigned int>& body_id,
         const std::vector<Vector3d>& target_pos,
         const std::vector<Matrix3d>& target_ori,
         VectorNd &Qres,
-        double step_tol,
-        double lambda,
-        unsigned int max_iter
+        unsigned int &iterations,
+        double step_tol = 1.0e-12,
+        double lambda = 0.01,
+        unsigned int max_iter = 50
         )
 {
 
@@ -336,6 +551,7 @@ bool InverseKinematics6D (
     Qres = Qinit;
 
     for (unsigned int ik_iter = 0; ik_iter < max_iter; ik_iter++) {
+        iterations = ik_iter + 1;
         UpdateKinematicsCustom (model, &Qres, NULL, NULL);
         for (unsigned int k = 0; k < body_id.size(); k++) {
             MatrixNd G (MatrixNd::Zero(6, model.qdot_size));
@@ -422,6 +638,267 @@ bool InverseKinematics6D (
     return false;
 }
 
+// logarithm of a rotation matrix on the shortest geodesic
+static Vector3d RotationLog(const Matrix3d& rotation)
+{
+    Eigen::Quaterniond q(rotation);
+    if (q.w() < 0.0)
+        q.coeffs() = -q.coeffs();
+
+    double sin_half_angle = q.vec().norm();
+    if (sin_half_angle < 1e-12)
+        return 2.0 * q.vec();
+
+    double angle = 2.0 * std::atan2(sin_half_angle, q.w());
+    return (angle / sin_half_angle) * q.vec();
+}
+
+static unsigned int GetMovableBodyId(Model &model, unsigned int body_id)
+{
+    if (model.IsFixedBodyId(body_id))
+        return model.mFixedBodies[body_id - model.fixed_body_discriminator].mMovableParent;
+    return body_id;
+}
+
+// stacks the 6D errors of all bodies. rows are [rotation; translation] as in CalcPointJacobian6D :
+// the rotation error is expressed in the frame of the (movable) body, the translation error in the base frame.
+static double ComputeIKError(
+        Model &model,
+        const VectorNd &Q,
+        const std::vector<unsigned int>& body_id,
+        const std::vector<Vector3d>& target_pos,
+        const std::vector<Matrix3d>& target_ori,
+        VectorNd &e)
+{
+    for (unsigned int k = 0; k < body_id.size(); ++k)
+    {
+        Vector3d point_base = CalcBodyToBaseCoordinates(model, Q, body_id[k], Vector3d::Zero(), false);
+        Matrix3d body_world_ori = CalcBodyWorldOrientation(model, Q, body_id[k], false);
+
+        // orientations are base-to-body rotations, so the base frame rotation error is log(E_target^T E)
+        Vector3d rotation_error = RotationLog(target_ori[k].transpose() * body_world_ori);
+
+        e.segment<3>(k * 6) = model.X_base[GetMovableBodyId(model, body_id[k])].E * rotation_error;
+        e.segment<3>(k * 6 + 3) = target_pos[k] - point_base;
+    }
+    return e.norm();
+}
+
+InverseKinematicsWorkspace::InverseKinematicsWorkspace(double initial_lambda)
+    : lambda_(initial_lambda), iterations_(0)
+{
+}
+
+void InverseKinematicsWorkspace::resize(unsigned int num_bodies, unsigned int qdot_size)
+{
+    unsigned int num_rows = 6 * num_bodies;
+    if (J_.rows() == num_rows && J_.cols() == qdot_size)
+        return;
+
+    J_.resize(num_rows, qdot_size);
+    G_.resize(6, qdot_size);
+    JJT_.resize(num_rows, num_rows);
+    A_.resize(num_rows, num_rows);
+    llt_ = Eigen::LLT<MatrixNd>(num_rows);
+    e_.resize(num_rows);
+    e_trial_.resize(num_rows);
+    z_.resize(num_rows);
+    delta_q_.resize(qdot_size);
+    q_trial_.resize(qdot_size);
+}
+
+bool InverseKinematics6D (
+        Model &model,
+        const VectorNd &Qinit,
+        const std::vector<unsigned int>& body_id,
+        const std::vector<Vector3d>& target_pos,
+        const std::vector<Matrix3d>& target_ori,
+        VectorNd &Qres,
+        double step_tol,
+        double lambda,
+        unsigned int max_iter
+        )
+{
+    InverseKinematicsWorkspace workspace(lambda);
+    return InverseKinematics6D(model, Qinit, body_id, target_pos, target_ori, Qres, workspace, step_tol, max_iter);
+}
+
+bool InverseKinematics6D (
+        Model &model,
+        const VectorNd &Qinit,
+        const std::vector<unsigned int>& body_id,
+        const std::vector<Vector3d>& target_pos,
+        const std::vector<Matrix3d>& target_ori,
+        VectorNd &Qres,
+        InverseKinematicsWorkspace &workspace,
+        double step_tol,
+        unsigned int max_iter
+        )
+{
+    const double lambda_min = 1e-6;
+    const double lambda_max = 1e6;
+
+    assert (Qinit.size() == model.q_size);
+    assert (body_id.size() == target_pos.size());
+
+    workspace.resize(body_id.size(), model.qdot_size);
+    workspace.iterations_ = 0;
+    workspace.lambda_ = std::min(std::max(workspace.lambda_, lambda_min), lambda_max);
+
+    Qres = Qinit;
+    UpdateKinematicsCustom (model, &Qres, NULL, NULL);
+    double error = ComputeIKError(model, Qres, body_id, target_pos, target_ori, workspace.e_);
+
+    bool converged = false;
+    bool kinematics_at_qres = true;
+    bool jacobian_valid = false;
+    while (workspace.iterations_ < max_iter)
+    {
+        if (error < step_tol)
+        {
+            converged = true;
+            break;
+        }
+        ++workspace.iterations_;
+
+        // the jacobian only changes when a step is accepted
+        if (!jacobian_valid)
+        {
+            if (!kinematics_at_qres)
+            {
+                UpdateKinematicsCustom (model, &Qres, NULL, NULL);
+                kinematics_at_qres = true;
+            }
+            for (unsigned int k = 0; k < body_id.size(); ++k)
+            {
+                workspace.G_.setZero();
+                CalcPointJacobian6D(model, Qres, body_id[k], Vector3d::Zero(), workspace.G_, false);
+                workspace.J_.block(k * 6, 0, 6, model.qdot_size) = workspace.G_;
+            }
+            workspace.JJT_.noalias() = workspace.J_ * workspace.J_.transpose();
+            jacobian_valid = true;
+        }
+
+        // damped least squares step
+        workspace.A_ = workspace.JJT_;
+        workspace.A_.diagonal().array() += workspace.lambda_ * workspace.lambda_;
+        workspace.llt_.compute(workspace.A_);
+        workspace.z_ = workspace.llt_.solve(workspace.e_);
+        workspace.delta_q_.noalias() = workspace.J_.transpose() * workspace.z_;
+
+        workspace.q_trial_ = Qres + workspace.delta_q_;
+        UpdateKinematicsCustom (model, &workspace.q_trial_, NULL, NULL);
+        kinematics_at_qres = false;
+        double trial_error = ComputeIKError(model, workspace.q_trial_, body_id, target_pos, target_ori, workspace.e_trial_);
+
+        if (trial_error < error)
+        {
+            // accept : trust the linearization more
+            Qres = workspace.q_trial_;
+            workspace.e_.swap(workspace.e_trial_);
+            error = trial_error;
+            kinematics_at_qres = true;
+            jacobian_valid = false;
+            workspace.lambda_ = std::max(0.5 * workspace.lambda_, lambda_min);
+
+            if (workspace.delta_q_.norm() < step_tol)
+            {
+                converged = true;
+                break;
+            }
+        }
+        else
+        {
+            // reject : increase the damping and retry from the same configuration
+            workspace.lambda_ *= 4.0;
+            if (workspace.lambda_ > lambda_max)
+            {
+                // no descent direction left. Qres is a local minimum of the error or the target is unreachable
+                workspace.lambda_ = lambda_max;
+                break;
+            }
+        }
+    }
+
+    if (!kinematics_at_qres)
+        UpdateKinematicsCustom (model, &Qres, NULL, NULL);
+
+    return converged;
+}
+
+void BenchmarkInverseKinematics6D (
+        const Model &model,
+        const VectorNd &Q,
+        const std::vector<unsigned int>& body_id,
+        unsigned int num_solves,
+        double perturbation
+        )
+{
+    Model bench_model = model;
+
+    boost::mt19937 rng(0);
+    boost::uniform_real<> uniform(-perturbation, perturbation);
+    boost::variate_generator<boost::mt19937&, boost::uniform_real<> > random(rng, uniform);
+
+    std::vector<Vector3d> target_pos(body_id.size());
+    std::vector<Matrix3d> target_ori(body_id.size());
+    VectorNd q_target(Q.rows());
+    VectorNd q_res(Q.rows());
+    VectorNd e(6 * body_id.size());
+
+    InverseKinematicsWorkspace workspace;
+    unsigned int num_success[2] = { 0, 0 };
+    unsigned int num_iterations[2] = { 0, 0 };
+    double solve_time[2] = { 0.0, 0.0 };
+    double residual[2] = { 0.0, 0.0 };
+
+    for (unsigned int s = 0; s < num_solves; ++s)
+    {
+        // reachable targets from a perturbed configuration
+        for (int i = 0; i < Q.rows(); ++i)
+            q_target(i) = Q(i) + random();
+        UpdateKinematicsCustom (bench_model, &q_target, NULL, NULL);
+        for (unsigned int k = 0; k < body_id.size(); ++k)
+        {
+            target_pos[k] = CalcBodyToBaseCoordinates(bench_model, q_target, body_id[k], Vector3d::Zero(), false);
+            target_ori[k] = CalcBodyWorldOrientation(bench_model, q_target, body_id[k], false);
+        }
+
+        for (int solver = 0; solver < 2; ++solver)
+        {
+            unsigned int iterations = 0;
+            bool result;
+            ros::WallTime start_time = ros::WallTime::now();
+            if (solver == 0)
+                result = InverseKinematics6DEuler(bench_model, Q, body_id, target_pos, target_ori, q_res, iterations);
+            else
+            {
+                result = InverseKinematics6D(bench_model, Q, body_id, target_pos, target_ori, q_res, workspace);
+                iterations = workspace.iterations_;
+            }
+            solve_time[solver] += (ros::WallTime::now() - start_time).toSec();
+
+            UpdateKinematicsCustom (bench_model, &q_res, NULL, NULL);
+            residual[solver] += ComputeIKError(bench_model, q_res, body_id, target_pos, target_ori, e);
+            num_iterations[solver] += iterations;
+            num_success[solver] += result ? 1 : 0;
+        }
+    }
+
+    if (num_solves == 0)
+        return;
+
+    const char* solver_names[2] = { "Euler", "SO(3) LM" };
+    ROS_INFO("IK benchmark : %d solves, %d bodies, perturbation %f", num_solves, (int)body_id.size(), perturbation);
+    for (int solver = 0; solver < 2; ++solver)
+    {
+        ROS_INFO("%s : %f iterations/solve, %f ms/solve, mean residual %e, success %d/%d", solver_names[solver],
+                 (double)num_iterations[solver] / num_solves, solve_time[solver] * 1000.0 / num_solves,
+                 residual[solver] / num_solves, num_success[solver], num_solves);
+    }
+}
+
+
 void CalcPointJacobian6D (
         Model &model,
         const VectorNd &Q,
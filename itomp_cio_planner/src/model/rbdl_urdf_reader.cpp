@@ -19,7 +19,27 @@ typedef vector<JointPtr> URDFJointVector;
 typedef map<string, LinkPtr > URDFLinkMap;
 typedef map<string, JointPtr > URDFJointMap;
 
-bool ConstructModel (RigidBodyDynamics::Model* rbdl_model, ModelPtr urdf_model, bool verbose)
+void RecordBody (RBDLBodyRecordVector* body_records, unsigned int parent_id,
+                 const SpatialTransform& joint_frame, const RigidBodyDynamics::Joint& joint,
+                 double mass, const Vector3d& com, const Matrix3d& inertia, const std::string& name)
+{
+    if (body_records == NULL)
+        return;
+
+    RBDLBodyRecord record;
+    record.parent_id_ = parent_id;
+    record.joint_frame_ = joint_frame;
+    record.joint_dof_count_ = (joint.mJointType == RigidBodyDynamics::JointTypeFixed) ? 0 : joint.mDoFCount;
+    for (unsigned int i = 0; i < record.joint_dof_count_; ++i)
+        record.joint_axes_[i] = joint.mJointAxes[i];
+    record.mass_ = mass;
+    record.com_ = com;
+    record.inertia_ = inertia;
+    record.name_ = name;
+    body_records->push_back(record);
+}
+
+bool ConstructModel (RigidBodyDynamics::Model* rbdl_model, ModelPtr urdf_model, bool verbose, RBDLBodyRecordVector* body_records)
 {
     boost::shared_ptr<urdf::Link> urdf_root_link;
 
@@ -92,6 +112,8 @@ bool ConstructModel (RigidBodyDynamics::Model* rbdl_model, ModelPtr urdf_model,
                            root_joint,
                            root_link,
                            root->name);
+    RecordBody(body_records, 0, root_joint_frame, root_joint,
+               root_inertial_mass, root_inertial_position, root_inertial_inertia, root->name);
 
     if (link_stack.top()->child_joints.size() > 0)
     {
@@ -257,12 +279,15 @@ bool ConstructModel (RigidBodyDynamics::Model* rbdl_model, ModelPtr urdf_model,
         }
 
         rbdl_model->AddBody (rbdl_parent_id, rbdl_joint_frame, rbdl_joint, rbdl_body, urdf_child->name);
+        RecordBody(body_records, rbdl_parent_id, rbdl_joint_frame, rbdl_joint,
+                   link_inertial_mass, link_inertial_position, link_inertial_inertia, urdf_child->name);
     }
 
     return true;
 }
 
-bool ReadURDFModel (const std::string& xml_string, RigidBodyDynamics::Model* model, bool verbose)
+bool ReadURDFModel (const std::string& xml_string, RigidBodyDynamics::Model* model, bool verbose,
+                    RBDLBodyRecordVector* body_records)
 {
     assert (model);
 
@@ -274,7 +299,10 @@ bool ReadURDFModel (const std::string& xml_string, RigidBodyDynamics::Model* mod
         cerr << "Error opening urdf file" << endl;
     }
 
-    if (!ConstructModel (model, urdf_model, verbose))
+    if (body_records != NULL)
+        body_records->clear();
+
+    if (!ConstructModel (model, urdf_model, verbose, body_records))
     {
         cerr << "Error constructing model from urdf file." << endl;
         return false;
@@ -285,4 +313,46 @@ bool ReadURDFModel (const std::string& xml_string, RigidBodyDynamics::Model* mod
     return true;
 }
 
+bool ConstructModelFromRecords (const RBDLBodyRecordVector& body_records, RigidBodyDynamics::Model* model)
+{
+    assert (model);
+
+    for (unsigned int i = 0; i < body_records.size(); ++i)
+    {
+        const RBDLBodyRecord& record = body_records[i];
+
+        RigidBodyDynamics::Joint rbdl_joint;
+        switch (record.joint_dof_count_)
+        {
+        case 0:
+            rbdl_joint = RigidBodyDynamics::Joint (RigidBodyDynamics::JointTypeFixed);
+            break;
+        case 1:
+            rbdl_joint = RigidBodyDynamics::Joint (record.joint_axes_[0]);
+            break;
+        case 6:
+            rbdl_joint = RigidBodyDynamics::Joint (
+                             record.joint_axes_[0], record.joint_axes_[1], record.joint_axes_[2],
+                             record.joint_axes_[3], record.joint_axes_[4], record.joint_axes_[5]);
+            break;
+        default:
+            cerr << "Error while constructing body '" << record.name_ << "': unsupported joint dof count " << record.joint_dof_count_ << endl;
+            return false;
+        }
+
+        if (record.parent_id_ != 0 && record.parent_id_ >= model->mBodies.size() && !model->IsFixedBodyId(record.parent_id_))
+        {
+            cerr << "Error while constructing body '" << record.name_ << "': invalid parent id " << record.parent_id_ << endl;
+            return false;
+        }
+
+        RigidBodyDynamics::Body rbdl_body = RigidBodyDynamics::Body (record.mass_, record.com_, record.inertia_);
+        model->AddBody (record.parent_id_, record.joint_frame_, rbdl_joint, rbdl_body, record.name_);
+    }
+
+    model->gravity.set (0., 0., -9.81);
+
+    return true;
+}
+
 }
@@ -0,0 +1,118 @@
+#include <itomp_cio_planner/optimization/augmented_lagrangian.h>
+#include <itomp_cio_planner/optimization/phase_manager.h>
+#include <itomp_cio_planner/contact/contact_util.h>
+#include <itomp_cio_planner/util/planning_parameters.h>
+
+namespace itomp_cio_planner
+{
+
+namespace
+{
+
+// the penalty is increased unless the violation decreases by this factor in an outer iteration
+const double VIOLATION_DECREASE = 0.25;
+
+double getViolation(const Eigen::MatrixXd& physics_values, const Eigen::MatrixXd& contact_values)
+{
+    double violation = 0.0;
+    if (physics_values.size() > 0)
+        violation = std::max(violation, physics_values.cwiseAbs().maxCoeff());
+    if (contact_values.size() > 0)
+        violation = std::max(violation, contact_values.cwiseAbs().maxCoeff());
+    return violation;
+}
+
+}
+
+AugmentedLagrangian::AugmentedLagrangian()
+    : penalty_scale_(1.0), last_violation_(std::numeric_limits<double>::max())
+{
+
+}
+
+AugmentedLagrangian::~AugmentedLagrangian()
+{
+
+}
+
+void AugmentedLagrangian::reset(int num_points, int num_contacts)
+{
+    physics_shifts_ = Eigen::MatrixXd::Zero(num_points, 6);
+    contact_shifts_ = Eigen::MatrixXd::Zero(num_points, num_contacts * NUM_ENDEFFECTOR_CONTACT_POINTS);
+    penalty_scale_ = 1.0;
+    last_violation_ = std::numeric_limits<double>::max();
+}
+
+bool AugmentedLagrangian::isActive() const
+{
+    return PlanningParameters::getInstance()->getAugmentedLagrangian() && PhaseManager::getInstance()->getPhase() > 2 &&
+           physics_shifts_.rows() > 0;
+}
+
+double AugmentedLagrangian::computeViolation(const NewEvalManager* evaluation_manager) const
+{
+    Eigen::MatrixXd physics_values, contact_values;
+    computeConstraintValues(evaluation_manager, physics_values, contact_values);
+
+    return getViolation(physics_values, contact_values);
+}
+
+double AugmentedLagrangian::update(const NewEvalManager* evaluation_manager)
+{
+    Eigen::MatrixXd physics_values, contact_values;
+    computeConstraintValues(evaluation_manager, physics_values, contact_values);
+
+    double violation = getViolation(physics_values, contact_values);
+
+    physics_shifts_ += physics_values;
+    contact_shifts_ += contact_values;
+
+    // same multipliers with the larger penalty
+    if (violation > VIOLATION_DECREASE * last_violation_)
+    {
+        double penalty_increase = PlanningParameters::getInstance()->getAugmentedLagrangianPenaltyIncrease();
+        penalty_scale_ *= penalty_increase;
+        physics_shifts_ /= penalty_increase;
+        contact_shifts_ /= penalty_increase;
+    }
+    last_violation_ = violation;
+
+    return violation;
+}
+
+void AugmentedLagrangian::computeConstraintValues(const NewEvalManager* evaluation_manager,
+        Eigen::MatrixXd& physics_values, Eigen::MatrixXd& contact_values) const
+{
+    const ItompPlanningGroupConstPtr& planning_group = evaluation_manager->getPlanningGroup();
+    int num_points = physics_shifts_.rows();
+
+    physics_values.resize(num_points, 6);
+    contact_values = Eigen::MatrixXd::Zero(num_points, contact_shifts_.cols());
+    for (int point = 0; point < num_points; ++point)
+    {
+        // the points skipped by the adaptive discretization are not constrained
+        if (!evaluation_manager->isPointEvaluated(point))
+        {
+            physics_values.row(point).setZero();
+            continue;
+        }
+
+        // non-actuated root joints
+        for (int i = 0; i < 6; ++i)
+            physics_values(point, i) = evaluation_manager->joint_torques_[point](i);
+
+        const RigidBodyDynamics::Model& model = evaluation_manager->getRBDLModel(point);
+        const std::vector<ContactVariables>& contact_variables = evaluation_manager->contact_variables_[point];
+        for (int i = 0; i < contact_variables.size(); ++i)
+        {
+            for (int j = 0; j < NUM_ENDEFFECTOR_CONTACT_POINTS; ++j)
+            {
+                double c = getContactActiveValue(i, j, contact_variables);
+                double error = c * getContactInvariantError(i, j, model, *planning_group, contact_variables);
+                contact_values(point, i * NUM_ENDEFFECTOR_CONTACT_POINTS + j) = std::sqrt(std::max(error, 0.0));
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,200 @@
+#include <itomp_cio_planner/optimization/crowd_manager.h>
+#include <ros/ros.h>
+#include <algorithm>
+#include <limits>
+
+namespace itomp_cio_planner
+{
+
+CrowdManager::CrowdManager()
+    : num_agents_(0), num_points_(0), batch_mode_(false), current_agent_(0), cell_size_(1.0)
+{
+}
+
+CrowdManager::~CrowdManager()
+{
+}
+
+void CrowdManager::initialize(int num_agents, int num_points, bool batch_mode)
+{
+    num_agents_ = num_agents;
+    num_points_ = num_points;
+    batch_mode_ = batch_mode;
+    current_agent_ = 0;
+    cell_size_ = 1.0;
+
+    positions_x_ = Eigen::MatrixXd::Zero(num_points, num_agents);
+    positions_y_ = Eigen::MatrixXd::Zero(num_points, num_agents);
+    radii_ = Eigen::MatrixXd::Constant(num_points, num_agents, -1.0);
+
+    cells_.resize(num_points);
+    for (int i = 0; i < num_points; ++i)
+    {
+        cells_[i].clear();
+        cells_[i].reserve(num_agents);
+    }
+}
+
+void CrowdManager::initializeFromConstraints(const std::vector<moveit_msgs::Constraints>& neighbors, int num_points)
+{
+    initialize(neighbors.size(), num_points, false);
+
+    for (int j = 0; j < num_agents_; ++j)
+    {
+        const std::vector<moveit_msgs::PositionConstraint>& position_constraints = neighbors[j].position_constraints;
+        int num_constraint_points = std::min((int) position_constraints.size(), num_points_);
+        for (int i = 0; i < num_constraint_points; ++i)
+        {
+            if (position_constraints[i].weight < 0)
+                continue;
+
+            positions_x_(i, j) = position_constraints[i].target_point_offset.x;
+            positions_y_(i, j) = position_constraints[i].target_point_offset.y;
+            radii_(i, j) = position_constraints[i].target_point_offset.z;
+        }
+    }
+
+    buildSpatialHash();
+}
+
+void CrowdManager::setAgentRadius(int agent, double radius)
+{
+    radii_.col(agent).setConstant(radius);
+}
+
+void CrowdManager::setAgentPosition(int agent, int point, double x, double y)
+{
+    positions_x_(point, agent) = x;
+    positions_y_(point, agent) = y;
+}
+
+void CrowdManager::setAgentTrajectory(int agent, const ElementTrajectoryConstPtr& joint_trajectory)
+{
+    // root x, y are the first two joints
+    int num_points = std::min((int) joint_trajectory->getNumPoints(), num_points_);
+    for (int i = 0; i < num_points; ++i)
+    {
+        positions_x_(i, agent) = (*joint_trajectory)(i, 0);
+        positions_y_(i, agent) = (*joint_trajectory)(i, 1);
+    }
+}
+
+void CrowdManager::buildSpatialHash()
+{
+    double max_radius = (num_agents_ > 0) ? radii_.maxCoeff() : 0.0;
+    cell_size_ = std::max(2.0 * max_radius, ITOMP_EPS);
+
+    for (int i = 0; i < num_points_; ++i)
+    {
+        std::vector<std::pair<uint64_t, int> >& cells = cells_[i];
+        cells.clear();
+        for (int j = 0; j < num_agents_; ++j)
+        {
+            if (radii_(i, j) < 0.0)
+                continue;
+            cells.push_back(std::make_pair(getCellKey(getCellCoordinate(positions_x_(i, j)),
+                                           getCellCoordinate(positions_y_(i, j))), j));
+        }
+        std::sort(cells.begin(), cells.end());
+    }
+}
+
+double CrowdManager::computePairCost(int agent, int point, double x, double y, int neighbor) const
+{
+    double radius_sum = radii_(point, agent) + radii_(point, neighbor);
+    double dx = x - positions_x_(point, neighbor);
+    double dy = y - positions_y_(point, neighbor);
+    double sq_dist = dx * dx + dy * dy;
+    if (sq_dist >= radius_sum * radius_sum)
+        return 0.0;
+
+    double penetration = radius_sum - std::sqrt(sq_dist);
+    return penetration * penetration;
+}
+
+double CrowdManager::computeNeighborCost(int agent, int point, double x, double y) const
+{
+    if (radii_(point, agent) < 0.0)
+        return 0.0;
+
+    const std::vector<std::pair<uint64_t, int> >& cells = cells_[point];
+
+    double cost = 0.0;
+    int ix = getCellCoordinate(x);
+    int iy = getCellCoordinate(y);
+    for (int dx = -1; dx <= 1; ++dx)
+    {
+        // cells (ix + dx, iy - 1) ~ (ix + dx, iy + 1) are contiguous in the sorted list
+        std::vector<std::pair<uint64_t, int> >::const_iterator it =
+            std::lower_bound(cells.begin(), cells.end(), std::make_pair(getCellKey(ix + dx, iy - 1), -1));
+        uint64_t last_key = getCellKey(ix + dx, iy + 1);
+        for (; it != cells.end() && it->first <= last_key; ++it)
+        {
+            if (it->second != agent)
+                cost += computePairCost(agent, point, x, y, it->second);
+        }
+    }
+    return cost;
+}
+
+double CrowdManager::computeNeighborCostBruteForce(int agent, int point, double x, double y) const
+{
+    if (radii_(point, agent) < 0.0)
+        return 0.0;
+
+    double cost = 0.0;
+    for (int j = 0; j < num_agents_; ++j)
+    {
+        if (j != agent && radii_(point, j) >= 0.0)
+            cost += computePairCost(agent, point, x, y, j);
+    }
+    return cost;
+}
+
+void CrowdManager::runSyntheticBenchmark(int num_agents, int num_points)
+{
+    const double agent_radius = 0.3;
+    // agents on a circle walk to the antipodal positions
+    const double circle_radius = std::max(2.0, num_agents * 2.0 * agent_radius / M_PI);
+
+    CrowdManager crowd;
+    crowd.initialize(num_agents, num_points, true);
+    for (int j = 0; j < num_agents; ++j)
+    {
+        double angle = 2.0 * M_PI * j / num_agents;
+        double start_x = circle_radius * cos(angle);
+        double start_y = circle_radius * sin(angle);
+        crowd.setAgentRadius(j, agent_radius);
+        for (int i = 0; i < num_points; ++i)
+        {
+            double t = (num_points > 1) ? (double) i / (num_points - 1) : 0.0;
+            crowd.setAgentPosition(j, i, (1.0 - 2.0 * t) * start_x, (1.0 - 2.0 * t) * start_y);
+        }
+    }
+
+    ros::WallTime start_time = ros::WallTime::now();
+    crowd.buildSpatialHash();
+    double build_time = (ros::WallTime::now() - start_time).toSec();
+
+    start_time = ros::WallTime::now();
+    double hash_cost = 0.0;
+    for (int i = 0; i < num_points; ++i)
+        for (int j = 0; j < num_agents; ++j)
+            hash_cost += crowd.computeNeighborCost(j, i, crowd.positions_x_(i, j), crowd.positions_y_(i, j));
+    double hash_time = (ros::WallTime::now() - start_time).toSec();
+
+    start_time = ros::WallTime::now();
+    double brute_force_cost = 0.0;
+    for (int i = 0; i < num_points; ++i)
+        for (int j = 0; j < num_agents; ++j)
+            brute_force_cost += crowd.computeNeighborCostBruteForce(j, i, crowd.positions_x_(i, j), crowd.positions_y_(i, j));
+    double brute_force_time = (ros::WallTime::now() - start_time).toSec();
+
+    ROS_INFO("Crowd benchmark : %d agents, %d points", num_agents, num_points);
+    ROS_INFO("Spatial hash : build %f sec, evaluation %f sec, cost %f", build_time, hash_time, hash_cost);
+    ROS_INFO("Brute force : evaluation %f sec, cost %f", brute_force_time, brute_force_cost);
+    if (std::abs(hash_cost - brute_force_cost) > ITOMP_EPS * std::max(1.0, brute_force_cost))
+        ROS_ERROR("Crowd benchmark : spatial hash cost does not match brute force cost");
+}
+
+}
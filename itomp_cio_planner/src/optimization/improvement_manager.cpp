@@ -1,5 +1,7 @@
 #include <itomp_cio_planner/optimization/improvement_manager.h>
+#include <itomp_cio_planner/optimization/phase_manager.h>
 #include <itomp_cio_planner/util/planning_parameters.h>
+#include <fstream>
 
 namespace itomp_cio_planner
 {
@@ -32,4 +34,140 @@ bool ImprovementManager::updatePlanningParameters()
 	return true;
 }
 
+void ImprovementManager::computeParameterBounds(ItompTrajectory::ParameterVector& x_lower,
+                                                ItompTrajectory::ParameterVector& x_upper) const
+{
+    std::vector<double> group_joint_min(planning_group_->group_joints_.size());
+    std::vector<double> group_joint_max(planning_group_->group_joints_.size());
+    for (int j = 0; j < planning_group_->group_joints_.size(); ++j)
+    {
+        const ItompRobotJoint& joint = planning_group_->group_joints_[j];
+        int group_index = joint.group_joint_index_;
+        group_joint_min[group_index] = joint.joint_limit_min_;
+        group_joint_max[group_index] = joint.joint_limit_max_;
+    }
+
+    int num_variables = evaluation_manager_->getTrajectory()->getNumParameters();
+    x_lower.set_size(num_variables);
+    x_upper.set_size(num_variables);
+    for (int i = 0; i < num_variables; ++i)
+    {
+        ItompTrajectoryIndex index = evaluation_manager_->getTrajectory()->getTrajectoryIndex(i);
+
+        x_lower(i) = -30.0;
+        x_upper(i) = 30.0;
+
+
+        if (index.component == ItompTrajectory::COMPONENT_TYPE_POSITION)
+        {
+            switch (index.sub_component)
+            {
+            case ItompTrajectory::SUB_COMPONENT_TYPE_JOINT:
+            {
+                int parameter_joint_index = evaluation_manager_->getTrajectory()->getParameterJointIndex(index.element);
+                if (parameter_joint_index != -1)
+                {
+                    x_lower(i) = group_joint_min[parameter_joint_index];
+                    x_upper(i) = group_joint_max[parameter_joint_index];
+                }
+
+
+                // for walking
+                if (parameter_joint_index == 3 || parameter_joint_index == 4)
+                        //|| parameter_joint_index == 8 || parameter_joint_index == 11)
+                {
+                    //x_lower(i) = -0.001;
+                    //x_upper(i) = 0.001;
+                }
+
+                if (parameter_joint_index < 2)
+                {
+                    x_lower(i) = PlanningParameters::getInstance()->getWorkspaceMin()[parameter_joint_index];
+                    x_upper(i) = PlanningParameters::getInstance()->getWorkspaceMax()[parameter_joint_index];
+                }
+
+
+            }
+            break;
+
+            case ItompTrajectory::SUB_COMPONENT_TYPE_CONTACT_POSITION:
+                switch(index.element % 7)
+                {
+                case 0:
+                    break;
+
+                case 1:
+                    x_lower(i) = group_joint_min[0];
+                    x_upper(i) = group_joint_max[0];
+                    break;
+
+                case 2:
+                    x_lower(i) = group_joint_min[1];
+                    x_upper(i) = group_joint_max[1];
+                    break;
+
+                case 3:
+                    x_lower(i) = group_joint_min[2];
+                    x_upper(i) = group_joint_max[2];
+                    break;
+
+                case 4:
+                case 5:
+                case 6:
+                    x_lower(i) = -2.0 * M_PI;
+                    x_upper(i) = 2.0 * M_PI;
+                    break;
+                }
+                break;
+
+            case ItompTrajectory::SUB_COMPONENT_TYPE_CONTACT_FORCE:
+                x_lower(i) = -1.0;
+                x_upper(i) = 1.0;
+
+                break;
+
+            }
+        }
+        else // VELOCITY
+        {
+        }
+    }
+}
+
+void ImprovementManager::writeTrajectory(int iteration) const
+{
+    if (!PlanningParameters::getInstance()->getExportPhaseTrajectories())
+        return;
+
+    // write to file
+    std::stringstream ss;
+    ss << "trajectory_out_phase_" << iteration;
+    evaluation_manager_->getTrajectory()->writeTrajectoryFile(ss.str() + ".itraj");
+
+    if (PlanningParameters::getInstance()->getExportTrajectoryText())
+    {
+        std::ofstream trajectory_file;
+        trajectory_file.open((ss.str() + ".txt").c_str());
+        evaluation_manager_->getTrajectory()->printTrajectory(trajectory_file);
+        trajectory_file.close();
+    }
+}
+
+void ImprovementManager::printGroundProjectionCacheStatistics(const std::vector<NewEvalManagerPtr>& derivatives_evaluation_managers)
+{
+    unsigned long num_hits = evaluation_manager_->getGroundProjectionCache().getNumHits();
+    unsigned long num_misses = evaluation_manager_->getGroundProjectionCache().getNumMisses();
+    evaluation_manager_->resetGroundProjectionCacheStatistics();
+    for (int i = 0; i < derivatives_evaluation_managers.size(); ++i)
+    {
+        num_hits += derivatives_evaluation_managers[i]->getGroundProjectionCache().getNumHits();
+        num_misses += derivatives_evaluation_managers[i]->getGroundProjectionCache().getNumMisses();
+        derivatives_evaluation_managers[i]->resetGroundProjectionCacheStatistics();
+    }
+
+    unsigned long num_queries = num_hits + num_misses;
+    ROS_INFO("Phase %d ground projection cache : %lu hits / %lu queries (%f%%)", PhaseManager::getInstance()->getPhase(),
+             num_hits, num_queries, num_queries == 0 ? 0.0 : 100.0 * num_hits / num_queries);
+}
+
 }
@@ -0,0 +1,350 @@
+#include <itomp_cio_planner/optimization/improvement_manager_gauss_newton.h>
+#include <itomp_cio_planner/optimization/improvement_manager_nlp.h>
+#include <itomp_cio_planner/optimization/phase_manager.h>
+#include <itomp_cio_planner/optimization/augmented_lagrangian.h>
+#include <itomp_cio_planner/cost/trajectory_cost_manager.h>
+#include <itomp_cio_planner/util/planning_parameters.h>
+#include <omp.h>
+#include <algorithm>
+
+// improvement_manager_nlp.cpp
+double getROSWallTime();
+
+namespace itomp_cio_planner
+{
+
+namespace
+{
+
+const double MIN_DAMPING = 1e-9;
+const double MAX_DAMPING = 1e9;
+// damping of the parameters which do not change the residuals
+const double MIN_DAMPED_DIAGONAL = 1e-6;
+
+struct KeyframeOrder
+{
+    KeyframeOrder(const ItompTrajectory& trajectory) : trajectory_(trajectory) {}
+
+    bool operator()(int parameter_index1, int parameter_index2) const
+    {
+        return trajectory_.getTrajectoryIndex(parameter_index1).point < trajectory_.getTrajectoryIndex(parameter_index2).point;
+    }
+
+    const ItompTrajectory& trajectory_;
+};
+
+}
+
+ImprovementManagerGaussNewton::ImprovementManagerGaussNewton()
+{
+    evaluation_count_ = 0;
+    derivative_count_ = 0;
+    eps_ = ITOMP_EPS;
+    damping_ = 0.0;
+}
+
+ImprovementManagerGaussNewton::~ImprovementManagerGaussNewton()
+{
+    lbfgs_benchmark_manager_.reset();
+
+    TrajectoryCostManager::getInstance()->destroy();
+    PerformanceProfiler::getInstance()->destroy();
+
+    for (int i = 0; i < derivatives_evaluation_manager_.size(); ++i)
+        derivatives_evaluation_manager_[i].reset();
+}
+
+void ImprovementManagerGaussNewton::initialize(const NewEvalManagerPtr& evaluation_manager,
+                                               const ItompPlanningGroupConstPtr& planning_group)
+{
+    start_time_ = ros::Time::now();
+
+    ImprovementManager::initialize(evaluation_manager, planning_group);
+
+    num_threads_ = omp_get_max_threads();
+
+    omp_set_num_threads(num_threads_);
+    if (PlanningParameters::getInstance()->getPrintPlanningInfo())
+        ROS_INFO("Use %d threads on %d processors", num_threads_, omp_get_num_procs());
+
+    if (num_threads_ < 1)
+        ROS_ERROR("0 threads!!!");
+
+    TIME_PROFILER_INIT(getROSWallTime, num_threads_);
+    TIME_PROFILER_ADD_ENTRY(FK);
+
+    derivatives_evaluation_manager_.resize(num_threads_);
+    for (int i = 0; i < num_threads_; ++i)
+        derivatives_evaluation_manager_[i].reset(new NewEvalManager(*evaluation_manager));
+
+    if (PlanningParameters::getInstance()->getGaussNewtonBenchmarkNumTrials() > 0)
+    {
+        lbfgs_benchmark_manager_ = boost::make_shared<ImprovementManagerNLP>();
+        lbfgs_benchmark_manager_->initialize(evaluation_manager, planning_group);
+    }
+}
+
+bool ImprovementManagerGaussNewton::updatePlanningParameters()
+{
+    if (!ImprovementManager::updatePlanningParameters())
+        return false;
+
+    TrajectoryCostManager::getInstance()->buildActiveCostFunctions(evaluation_manager_.get());
+
+    return true;
+}
+
+void ImprovementManagerGaussNewton::runSingleIteration(int iteration)
+{
+    int num_variables = evaluation_manager_->getTrajectory()->getNumParameters();
+
+    ItompTrajectory::ParameterVector variables(num_variables);
+
+    evaluation_manager_->getParameters(variables);
+
+    if (lbfgs_benchmark_manager_)
+        benchmarkLBFGS(iteration, variables, PlanningParameters::getInstance()->getGaussNewtonBenchmarkNumTrials());
+
+    optimize(iteration, variables);
+
+    evaluation_manager_->printTrajectoryCost(iteration);
+
+    ROS_DEBUG("Phase %d elapsed : %f sec", PhaseManager::getInstance()->getPhase(), (ros::Time::now() - start_time_).toSec());
+
+    writeTrajectory(iteration);
+}
+
+double ImprovementManagerGaussNewton::evaluate(const ItompTrajectory::ParameterVector& variables)
+{
+    evaluation_manager_->setParameters(variables);
+
+    double cost = evaluation_manager_->evaluateResiduals(residual_matrix_);
+
+    evaluation_manager_->render();
+
+    evaluation_manager_->printTrajectoryCost(++evaluation_count_, true);
+
+    return cost;
+}
+
+void ImprovementManagerGaussNewton::computeParameterOrder()
+{
+    const ItompTrajectoryConstPtr& trajectory = evaluation_manager_->getTrajectory();
+
+    // the solved contact forces are not optimized
+    parameter_order_.clear();
+    for (int i = 0; i < trajectory->getNumParameters(); ++i)
+    {
+        if (PhaseManager::getInstance()->updateParameter(trajectory->getTrajectoryIndex(i)))
+            parameter_order_.push_back(i);
+    }
+    std::stable_sort(parameter_order_.begin(), parameter_order_.end(), KeyframeOrder(*trajectory));
+}
+
+void ImprovementManagerGaussNewton::computeJacobian(const ItompTrajectory::ParameterVector& variables)
+{
+    // assume evaluate was called before
+
+    ++derivative_count_;
+
+    #pragma omp parallel for
+    for (int i = 0; i < num_threads_; ++i)
+    {
+        derivatives_evaluation_manager_[i]->setParameters(variables);
+    }
+
+    int num_parameters = parameter_order_.size();
+    jacobian_blocks_.resize(num_parameters);
+    jacobian_point_begin_.resize(num_parameters);
+    jacobian_point_end_.resize(num_parameters);
+
+    #pragma omp parallel for
+    for (int i = 0; i < num_parameters; ++i)
+    {
+        int thread_index = omp_get_thread_num();
+
+        derivatives_evaluation_manager_[thread_index]->computeResidualDerivatives(parameter_order_[i], variables,
+                jacobian_blocks_[i], jacobian_point_begin_[i], jacobian_point_end_[i], eps_);
+    }
+}
+
+void ImprovementManagerGaussNewton::computeNormalEquations()
+{
+    int num_parameters = parameter_order_.size();
+
+    // two parameters are coupled if their columns share a point
+    int bandwidth = 0;
+    for (int i = 0; i < num_parameters; ++i)
+    {
+        for (int j = i + 1; j < num_parameters; ++j)
+        {
+            if (jacobian_point_begin_[j] < jacobian_point_end_[i] && jacobian_point_begin_[i] < jacobian_point_end_[j])
+                bandwidth = std::max(bandwidth, j - i);
+        }
+    }
+
+    normal_matrix_.resize(num_parameters, bandwidth);
+    gradient_.resize(num_parameters);
+
+    #pragma omp parallel for
+    for (int j = 0; j < num_parameters; ++j)
+    {
+        const Eigen::MatrixXd& block_j = jacobian_blocks_[j];
+        unsigned int begin_j = jacobian_point_begin_[j];
+
+        gradient_(j) = block_j.cwiseProduct(residual_matrix_.middleRows(begin_j, block_j.rows())).sum();
+
+        int i_end = std::min(num_parameters, j + bandwidth + 1);
+        for (int i = j; i < i_end; ++i)
+        {
+            const Eigen::MatrixXd& block_i = jacobian_blocks_[i];
+            unsigned int begin_i = jacobian_point_begin_[i];
+
+            unsigned int point_begin = std::max(begin_i, begin_j);
+            unsigned int point_end = std::min(jacobian_point_end_[i], jacobian_point_end_[j]);
+            if (point_begin >= point_end)
+                continue;
+
+            normal_matrix_.coeffRef(i, j) = block_i.middleRows(point_begin - begin_i, point_end - point_begin).cwiseProduct(
+                                                block_j.middleRows(point_begin - begin_j, point_end - point_begin)).sum();
+        }
+    }
+}
+
+void ImprovementManagerGaussNewton::optimize(int iteration, ItompTrajectory::ParameterVector& variables)
+{
+    computeParameterOrder();
+
+    ItompTrajectory::ParameterVector x_lower, x_upper;
+    computeParameterBounds(x_lower, x_upper);
+
+    int num_parameters = parameter_order_.size();
+    int evaluation_count_begin = evaluation_count_;
+    int derivative_count_begin = derivative_count_;
+    ros::WallTime optimization_start_time = ros::WallTime::now();
+
+    damping_ = PlanningParameters::getInstance()->getGaussNewtonDamping();
+
+    int max_iterations = PlanningParameters::getInstance()->getMaxIterations();
+    // the augmented Lagrangian outer loop repeats the inner optimization instead
+    if (PhaseManager::getInstance()->getPhase() > 2 && !AugmentedLagrangian::getInstance()->isActive())
+        max_iterations *= 10;
+
+    bool monitor_convergence = PlanningParameters::getInstance()->getPhaseConvergence();
+    if (monitor_convergence)
+    {
+        convergence_monitor_.begin(max_iterations, evaluation_manager_.get(), x_lower, x_upper);
+        max_iterations = convergence_monitor_.getMaxIterations();
+    }
+
+    double cost = evaluate(variables);
+    ItompTrajectory::ParameterVector new_variables;
+    for (int i = 0; i < max_iterations && num_parameters > 0; ++i)
+    {
+        computeJacobian(variables);
+        computeNormalEquations();
+
+        if (monitor_convergence)
+        {
+            // gradient of the cost |r|^2
+            ItompTrajectory::ParameterVector gradient = dlib::zeros_matrix<double>(variables.size(), 1);
+            for (int j = 0; j < num_parameters; ++j)
+                gradient(parameter_order_[j]) = 2.0 * gradient_(j);
+            if (!convergence_monitor_.update(variables, cost, gradient))
+                break;
+        }
+
+        // increase the damping until the step decreases the cost
+        bool improved = false;
+        double new_cost = cost;
+        while (!improved && damping_ < MAX_DAMPING)
+        {
+            BandedCholesky damped_matrix = normal_matrix_;
+            for (int j = 0; j < num_parameters; ++j)
+                damped_matrix.coeffRef(j, j) += damping_ * std::max(normal_matrix_.coeff(j, j), MIN_DAMPED_DIAGONAL);
+            if (!damped_matrix.factorize())
+            {
+                damping_ *= 10.0;
+                continue;
+            }
+
+            Eigen::VectorXd step = -gradient_;
+            damped_matrix.solve(step);
+
+            new_variables = variables;
+            for (int j = 0; j < num_parameters; ++j)
+            {
+                int parameter_index = parameter_order_[j];
+                new_variables(parameter_index) = std::min(std::max(variables(parameter_index) + step(j),
+                                                          x_lower(parameter_index)), x_upper(parameter_index));
+            }
+
+            new_cost = evaluate(new_variables);
+            if (new_cost < cost)
+            {
+                improved = true;
+                damping_ = std::max(damping_ / 3.0, MIN_DAMPING);
+            }
+            else
+                damping_ *= 4.0;
+        }
+
+        if (!improved)
+            break;
+
+        double cost_decrease = cost - new_cost;
+        variables = new_variables;
+        cost = new_cost;
+
+        if (!monitor_convergence && cost_decrease < eps_)
+            break;
+    }
+    if (monitor_convergence)
+        convergence_monitor_.end();
+
+    int num_jacobians = derivative_count_ - derivative_count_begin;
+    ROS_INFO("Phase %d optimization : %d evaluations, %d Jacobians x %d perturbed parameters (%d partial evaluations), bandwidth %d, %f sec%s",
+             PhaseManager::getInstance()->getPhase(), evaluation_count_ - evaluation_count_begin, num_jacobians,
+             num_parameters, 2 * num_jacobians * num_parameters, normal_matrix_.getBandwidth(),
+             (ros::WallTime::now() - optimization_start_time).toSec(),
+             PhaseManager::getInstance()->getContactForcesSolved() ? " (contact forces solved)" : "");
+    printGroundProjectionCacheStatistics(derivatives_evaluation_manager_);
+
+    evaluation_manager_->setParameters(variables);
+    evaluation_manager_->evaluate();
+    evaluation_manager_->printTrajectoryCost(0, true);
+    evaluation_manager_->render();
+}
+
+void ImprovementManagerGaussNewton::benchmarkLBFGS(int iteration, ItompTrajectory::ParameterVector& variables, int num_trials)
+{
+    const ItompTrajectory::ParameterVector initial_variables = variables;
+
+    double lbfgs_time = 0.0, gauss_newton_time = 0.0;
+    double lbfgs_cost = 0.0, gauss_newton_cost = 0.0;
+    for (int i = 0; i < num_trials; ++i)
+    {
+        evaluation_manager_->setParameters(initial_variables);
+        ros::WallTime start_time = ros::WallTime::now();
+        lbfgs_benchmark_manager_->runSingleIteration(iteration);
+        lbfgs_time += (ros::WallTime::now() - start_time).toSec();
+        lbfgs_cost += evaluation_manager_->getTrajectoryCost();
+
+        variables = initial_variables;
+        evaluation_manager_->setParameters(variables);
+        start_time = ros::WallTime::now();
+        optimize(iteration, variables);
+        gauss_newton_time += (ros::WallTime::now() - start_time).toSec();
+        gauss_newton_cost += evaluation_manager_->getTrajectoryCost();
+    }
+
+    ROS_INFO("Phase %d Gauss-Newton vs L-BFGS (%d trials) : cost %f vs %f, %f sec vs %f sec",
+             PhaseManager::getInstance()->getPhase(), num_trials,
+             gauss_newton_cost / num_trials, lbfgs_cost / num_trials,
+             gauss_newton_time / num_trials, lbfgs_time / num_trials);
+
+    variables = initial_variables;
+    evaluation_manager_->setParameters(variables);
+}
+
+}
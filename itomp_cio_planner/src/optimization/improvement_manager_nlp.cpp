@@ -1,5 +1,6 @@
 #include <itomp_cio_planner/optimization/improvement_manager_nlp.h>
 #include <itomp_cio_planner/optimization/phase_manager.h>
+#include <itomp_cio_planner/optimization/augmented_lagrangian.h>
 #include <itomp_cio_planner/cost/trajectory_cost_manager.h>
 #include <itomp_cio_planner/util/multivariate_gaussian.h>
 #include <itomp_cio_planner/util/planning_parameters.h>
@@ -21,20 +22,65 @@ namespace itomp_cio_planner
 {
 
 const bool READ_TRAJECTORY_FILE = false;
-const bool WRITE_TRAJECTORY_FILE = false;
+
+// diagonal preconditioning
+const double MAX_VARIABLE_RANGE = 10.0;
+const double MIN_VARIABLE_SCALE = 1e-3;
+const double MAX_VARIABLE_SCALE = 1e3;
+
+namespace
+{
+
+// dlib stop strategy of the phase convergence monitor, in the unscaled variables
+class PhaseConvergenceStopStrategy
+{
+public:
+    PhaseConvergenceStopStrategy(PhaseConvergenceMonitor* monitor, const column_vector* variable_scales)
+        : monitor_(monitor), variable_scales_(variable_scales)
+    {
+    }
+
+    template <typename T>
+    bool should_continue_search(const T& x, const double funct_value, const T& funct_derivative)
+    {
+        if (variable_scales_->size() == 0)
+            return monitor_->update(x, funct_value, funct_derivative);
+
+        column_vector variables(x.size()), derivative(x.size());
+        for (long i = 0; i < x.size(); ++i)
+        {
+            variables(i) = x(i) * (*variable_scales_)(i);
+            derivative(i) = funct_derivative(i) / (*variable_scales_)(i);
+        }
+        return monitor_->update(variables, funct_value, derivative);
+    }
+
+private:
+    PhaseConvergenceMonitor* monitor_;
+    const column_vector* variable_scales_;
+};
+
+}
 
 ImprovementManagerNLP::ImprovementManagerNLP()
+    : time_window_point_begin_(0), time_window_point_end_(0)
 {
     evaluation_count_ = 0;
+    derivative_count_ = 0;
     eps_ = ITOMP_EPS;
     best_cost_ = std::numeric_limits<double>::max();
 }
 
 ImprovementManagerNLP::~ImprovementManagerNLP()
 {
-    TrajectoryCostManager::getInstance()->destroy();
-    PerformanceProfiler::getInstance()->destroy();
+    // the window managers share the singletons of the optimizer
+    if (time_window_point_end_ == 0)
+    {
+        TrajectoryCostManager::getInstance()->destroy();
+        PerformanceProfiler::getInstance()->destroy();
+    }
 
+    time_window_managers_.clear();
     for (int i = 0; i < derivatives_evaluation_manager_.size(); ++i)
         derivatives_evaluation_manager_[i].reset();
 }
@@ -94,15 +140,13 @@ void ImprovementManagerNLP::runSingleIteration(int iteration)
     // read from file
     if (READ_TRAJECTORY_FILE)
     {
-        std::ifstream trajectory_file;
         std::stringstream ss;
-        ss << "trajectory_" << iteration << ".txt";
-        trajectory_file.open(ss.str().c_str());
-        if (trajectory_file.is_open())
+        ss << "trajectory_out_phase_" << iteration << ".itraj";
+        column_vector file_variables;
+        if (evaluation_manager_->getTrajectory()->readTrajectoryFileParameters(ss.str(), file_variables)
+                && file_variables.size() == num_variables)
         {
-            trajectory_file >> variables;
-            trajectory_file.close();
-
+            variables = file_variables;
             evaluation_manager_->setParameters(variables);
         }
     }
@@ -110,32 +154,16 @@ void ImprovementManagerNLP::runSingleIteration(int iteration)
     //if (iteration != 0)
     //addNoiseToVariables(variables);
 
-    optimize(iteration, variables);
+    if (useTimeWindows())
+        optimizeTimeWindows(iteration, variables);
+    else
+        optimize(iteration, variables);
 
     evaluation_manager_->printTrajectoryCost(iteration);
 
     printf("Elapsed : %f\n", (ros::Time::now() - start_time_).toSec());
 
-    evaluation_manager_->getParameters(variables);
-
-    // write to file
-    if (WRITE_TRAJECTORY_FILE)
-    {
-        std::ofstream trajectory_file;
-        std::stringstream ss;
-        ss << "trajectory_" << iteration << ".txt";
-        trajectory_file.open(ss.str().c_str());
-        trajectory_file.precision(std::numeric_limits<double>::digits10);
-        trajectory_file << variables;
-        trajectory_file.close();
-    }
-
-    std::ofstream trajectory_file;
-    std::stringstream ss;
-    ss << "trajectory_out_phase_" << iteration << ".txt";
-    trajectory_file.open(ss.str().c_str());
-    evaluation_manager_->getTrajectory()->printTrajectory(trajectory_file);
-    trajectory_file.close();
+    writeTrajectory(iteration);
 }
 
 double ImprovementManagerNLP::evaluate(const column_vector& variables)
@@ -144,9 +172,14 @@ double ImprovementManagerNLP::evaluate(const column_vector& variables)
 
     double cost = evaluation_manager_->evaluate();
 
+    ++evaluation_count_;
+    // the window managers run concurrently
+    if (time_window_point_end_ != 0)
+        return cost;
+
     evaluation_manager_->render();
 
-    evaluation_manager_->printTrajectoryCost(++evaluation_count_, true);
+    evaluation_manager_->printTrajectoryCost(evaluation_count_, true);
     if (evaluation_count_ % 1000 == 0)
     {
         double elapsed_time = (ros::Time::now() - start_time_).toSec();
@@ -204,9 +237,12 @@ column_vector ImprovementManagerNLP::derivative(const column_vector& variables)
     // assume evaluate was called before
 
     TIME_PROFILER_START_ITERATION;
+    ++derivative_count_;
 
     column_vector der;
     der.set_size(variables.size());
+    // a window manager computes only the derivatives of its parameters
+    der = 0.0;
 
     // for cost debug
 #ifdef COMPUTE_COST_DERIVATIVE
@@ -224,8 +260,9 @@ column_vector ImprovementManagerNLP::derivative(const column_vector& variables)
         derivatives_evaluation_manager_[i]->setParameters(variables);
     }
 
+    int num_evaluated_variables = evaluation_order_.size();
     #pragma omp parallel for
-    for (int i = 0; i < variables.size(); ++i)
+    for (int i = 0; i < num_evaluated_variables; ++i)
     {
         int thread_index = omp_get_thread_num();
 
@@ -343,18 +380,22 @@ column_vector ImprovementManagerNLP::derivative(const column_vector& variables)
             der(i) = -1e10;
     }
 
-    double scale = (PhaseManager::getInstance()->getPhase() <= 0) ? 1.0 : 1000.0;
-    double norm = 0.0;
-    for (int i = 0; i < der.size(); ++i)
-        norm += der(i) * der(i);
-    norm = std::sqrt(norm);
-    //std::cout << "norm : " << norm << std::endl;
-    if (norm > scale)
+    // the preconditioned problem is solved with the exact gradient
+    if (variable_scales_.size() == 0)
     {
-        norm /= scale;
+        double scale = (PhaseManager::getInstance()->getPhase() <= 0) ? 1.0 : 1000.0;
+        double norm = 0.0;
         for (int i = 0; i < der.size(); ++i)
+            norm += der(i) * der(i);
+        norm = std::sqrt(norm);
+        //std::cout << "norm : " << norm << std::endl;
+        if (norm > scale)
         {
-            der(i) /= norm;
+            norm /= scale;
+            for (int i = 0; i < der.size(); ++i)
+            {
+                der(i) /= norm;
+            }
         }
     }
 
@@ -363,109 +404,53 @@ column_vector ImprovementManagerNLP::derivative(const column_vector& variables)
     return der;
 }
 
-void ImprovementManagerNLP::optimize(int iteration, column_vector& variables)
+template <typename StopStrategy>
+void ImprovementManagerNLP::findMin(StopStrategy stop_strategy, column_vector& variables,
+                                    const column_vector& x_lower, const column_vector& x_upper)
 {
-    computeEvaluationOrder(variables.size());
-    //addNoiseToVariables(variables);
-
-    Jacobian::evaluation_manager_ = evaluation_manager_.get();
-
-    std::vector<double> group_joint_min(planning_group_->group_joints_.size());
-    std::vector<double> group_joint_max(planning_group_->group_joints_.size());
-    for (int j = 0; j < planning_group_->group_joints_.size(); ++j)
-    {
-        const ItompRobotJoint& joint = planning_group_->group_joints_[j];
-        int group_index = joint.group_joint_index_;
-        group_joint_min[group_index] = joint.joint_limit_min_;
-        group_joint_max[group_index] = joint.joint_limit_max_;
-    }
-
-    column_vector x_lower, x_upper;
-    x_lower.set_size(variables.size());
-    x_upper.set_size(variables.size());
-    for (int i = 0; i < variables.size(); ++i)
+    if (PlanningParameters::getInstance()->getDiagonalPreconditioning())
     {
-        ItompTrajectoryIndex index = evaluation_manager_->getTrajectory()->getTrajectoryIndex(i);
+        computeVariableScales(variables, x_lower, x_upper);
 
-        x_lower(i) = -30.0;
-        x_upper(i) = 30.0;
-
-
-        if (index.component == ItompTrajectory::COMPONENT_TYPE_POSITION)
+        // L-BFGS in the scaled variables x / scale
+        column_vector scaled_variables(variables.size()), scaled_lower(variables.size()), scaled_upper(variables.size());
+        for (int i = 0; i < variables.size(); ++i)
         {
-            switch (index.sub_component)
-            {
-            case ItompTrajectory::SUB_COMPONENT_TYPE_JOINT:
-            {
-                int parameter_joint_index = evaluation_manager_->getTrajectory()->getParameterJointIndex(index.element);
-                if (parameter_joint_index != -1)
-                {
-                    x_lower(i) = group_joint_min[parameter_joint_index];
-                    x_upper(i) = group_joint_max[parameter_joint_index];
-                }
-
-
-                // for walking
-                if (parameter_joint_index == 3 || parameter_joint_index == 4)
-                        //|| parameter_joint_index == 8 || parameter_joint_index == 11)
-                {
-                    //x_lower(i) = -0.001;
-                    //x_upper(i) = 0.001;
-                }
-
-                if (parameter_joint_index < 2)
-                {
-                    x_lower(i) = PlanningParameters::getInstance()->getWorkspaceMin()[parameter_joint_index];
-                    x_upper(i) = PlanningParameters::getInstance()->getWorkspaceMax()[parameter_joint_index];
-                }
+            scaled_variables(i) = variables(i) / variable_scales_(i);
+            scaled_lower(i) = x_lower(i) / variable_scales_(i);
+            scaled_upper(i) = x_upper(i) / variable_scales_(i);
+        }
 
+        Jacobian::setVariableScales(&variable_scales_);
+        dlib::find_min_box_constrained(dlib::lbfgs_search_strategy(10),
+                                       stop_strategy,
+                                       boost::bind(&ImprovementManagerNLP::evaluateScaled, this, _1),
+                                       boost::bind(&ImprovementManagerNLP::derivativeScaled, this, _1),
+                                       scaled_variables, scaled_lower, scaled_upper);
+        Jacobian::setVariableScales(NULL);
 
-            }
-            break;
+        variables = dlib::pointwise_multiply(scaled_variables, variable_scales_);
+        variable_scales_.set_size(0);
+    }
+    else
+    {
+        dlib::find_min_box_constrained(dlib::lbfgs_search_strategy(10),
+                                       stop_strategy,
+                                       boost::bind(&ImprovementManagerNLP::evaluate, this, _1),
+                                       boost::bind(&ImprovementManagerNLP::derivative, this, _1),
+                                       variables, x_lower, x_upper);
+    }
+}
 
-            case ItompTrajectory::SUB_COMPONENT_TYPE_CONTACT_POSITION:
-                switch(index.element % 7)
-                {
-                case 0:
-                    break;
-
-                case 1:
-                    x_lower(i) = group_joint_min[0];
-                    x_upper(i) = group_joint_max[0];
-                    break;
-
-                case 2:
-                    x_lower(i) = group_joint_min[1];
-                    x_upper(i) = group_joint_max[1];
-                    break;
-
-                case 3:
-                    x_lower(i) = group_joint_min[2];
-                    x_upper(i) = group_joint_max[2];
-                    break;
-
-                case 4:
-                case 5:
-                case 6:
-                    x_lower(i) = -2.0 * M_PI;
-                    x_upper(i) = 2.0 * M_PI;
-                    break;
-                }
-                break;
-
-            case ItompTrajectory::SUB_COMPONENT_TYPE_CONTACT_FORCE:
-                x_lower(i) = -1.0;
-                x_upper(i) = 1.0;
-
-                break;
+void ImprovementManagerNLP::optimize(int iteration, column_vector& variables)
+{
+    computeEvaluationOrder(variables.size());
+    //addNoiseToVariables(variables);
 
-            }
-        }
-        else // VELOCITY
-        {
-        }
-    }
+    Jacobian::evaluation_manager_ = evaluation_manager_.get();
 
+    column_vector x_lower, x_upper;
+    computeParameterBounds(x_lower, x_upper);
 
     /*
     if (iteration == 2)
@@ -486,14 +471,35 @@ void ImprovementManagerNLP::optimize(int iteration, column_vector& variables)
 
     evaluation_manager_->render();
 
-    int max_iterations = PlanningParameters::getInstance()->getMaxIterations();
-    if (PhaseManager::getInstance()->getPhase() > 2)
-        max_iterations *= 10;
-    dlib::find_min_box_constrained(dlib::lbfgs_search_strategy(10),
-                                   dlib::objective_delta_stop_strategy(eps_, max_iterations).be_verbose(),
-                                   boost::bind(&ImprovementManagerNLP::evaluate, this, _1),
-                                   boost::bind(&ImprovementManagerNLP::derivative, this, _1),
-                                   variables, x_lower, x_upper);
+    // parameters perturbed by each derivative. the solved contact forces are not
+    int num_perturbed_parameters = 0;
+    for (int i = 0; i < variables.size(); ++i)
+    {
+        if (PhaseManager::getInstance()->updateParameter(evaluation_manager_->getTrajectory()->getTrajectoryIndex(i)))
+            ++num_perturbed_parameters;
+    }
+    int evaluation_count_begin = evaluation_count_;
+    int derivative_count_begin = derivative_count_;
+    ros::WallTime optimization_start_time = ros::WallTime::now();
+
+    int max_iterations = getMaxIterations();
+    if (PlanningParameters::getInstance()->getPhaseConvergence())
+    {
+        convergence_monitor_.begin(max_iterations, evaluation_manager_.get(), x_lower, x_upper);
+        findMin(PhaseConvergenceStopStrategy(&convergence_monitor_, &variable_scales_), variables, x_lower, x_upper);
+        convergence_monitor_.end();
+    }
+    else
+        findMin(dlib::objective_delta_stop_strategy(eps_, max_iterations).be_verbose(), variables, x_lower, x_upper);
+
+    int num_derivatives = derivative_count_ - derivative_count_begin;
+    ROS_INFO("Phase %d optimization : %d evaluations, %d derivatives x %d perturbed parameters (%d partial evaluations), %f sec%s",
+             PhaseManager::getInstance()->getPhase(), evaluation_count_ - evaluation_count_begin, num_derivatives,
+             num_perturbed_parameters, 2 * num_derivatives * num_perturbed_parameters,
+             (ros::WallTime::now() - optimization_start_time).toSec(),
+             PhaseManager::getInstance()->getContactForcesSolved() ? " (contact forces solved)" : "");
+
+    printGroundProjectionCacheStatistics(derivatives_evaluation_manager_);
 
     evaluation_manager_->setParameters(variables);
     evaluation_manager_->evaluate();
@@ -501,6 +507,90 @@ void ImprovementManagerNLP::optimize(int iteration, column_vector& variables)
     evaluation_manager_->render();
 }
 
+double ImprovementManagerNLP::evaluateScaled(const column_vector& scaled_variables)
+{
+    return evaluate(dlib::pointwise_multiply(scaled_variables, variable_scales_));
+}
+
+column_vector ImprovementManagerNLP::derivativeScaled(const column_vector& scaled_variables)
+{
+    return dlib::pointwise_multiply(derivative(dlib::pointwise_multiply(scaled_variables, variable_scales_)), variable_scales_);
+}
+
+void ImprovementManagerNLP::computeVariableScales(const column_vector& variables, const column_vector& x_lower,
+                                                  const column_vector& x_upper)
+{
+    // gradient at the initial variables, before the preconditioning
+    variable_scales_.set_size(0);
+    evaluate(variables);
+    column_vector der = derivative(variables);
+
+    // one scale for each element (joint, contact position or force coordinate) over all points:
+    // for a cost with the curvature h ~ |gradient| / range over the bounds, scale = 1 / sqrt(h)
+    std::map<std::pair<std::pair<int, int>, int>, int> group_ids;
+    std::vector<int> parameter_groups(variables.size());
+    std::vector<double> group_ranges, group_squared_gradients;
+    std::vector<int> group_num_parameters, group_num_gradients;
+    for (int i = 0; i < variables.size(); ++i)
+    {
+        const ItompTrajectoryIndex& index = evaluation_manager_->getTrajectory()->getTrajectoryIndex(i);
+        std::pair<std::pair<int, int>, int> key(std::make_pair(index.component, index.sub_component), index.element);
+        std::map<std::pair<std::pair<int, int>, int>, int>::iterator it = group_ids.find(key);
+        if (it == group_ids.end())
+        {
+            it = group_ids.insert(std::make_pair(key, (int)group_ranges.size())).first;
+            group_ranges.push_back(0.0);
+            group_squared_gradients.push_back(0.0);
+            group_num_parameters.push_back(0);
+            group_num_gradients.push_back(0);
+        }
+        int group = it->second;
+        parameter_groups[i] = group;
+
+        group_ranges[group] += std::min(x_upper(i) - x_lower(i), MAX_VARIABLE_RANGE);
+        ++group_num_parameters[group];
+        if (PhaseManager::getInstance()->updateParameter(index))
+        {
+            group_squared_gradients[group] += der(i) * der(i);
+            ++group_num_gradients[group];
+        }
+    }
+
+    int num_groups = group_ranges.size();
+    std::vector<double> group_scales(num_groups, 1.0);
+    double log_scale_sum = 0.0;
+    int num_scaled_groups = 0;
+    for (int g = 0; g < num_groups; ++g)
+    {
+        if (group_num_gradients[g] == 0)
+            continue;
+        double range = group_ranges[g] / group_num_parameters[g];
+        double gradient = std::sqrt(group_squared_gradients[g] / group_num_gradients[g]);
+        if (range <= 0.0 || gradient <= 0.0)
+            continue;
+        group_scales[g] = std::sqrt(range / gradient);
+        log_scale_sum += std::log(group_scales[g]);
+        ++num_scaled_groups;
+    }
+
+    // the geometric mean of the scales is 1, which leaves eps_ and the line search steps as they are
+    double mean_scale = (num_scaled_groups == 0) ? 1.0 : std::exp(log_scale_sum / num_scaled_groups);
+    double min_scale = std::numeric_limits<double>::max(), max_scale = 0.0;
+    for (int g = 0; g < num_groups; ++g)
+    {
+        group_scales[g] = std::min(std::max(group_scales[g] / mean_scale, MIN_VARIABLE_SCALE), MAX_VARIABLE_SCALE);
+        min_scale = std::min(min_scale, group_scales[g]);
+        max_scale = std::max(max_scale, group_scales[g]);
+    }
+
+    variable_scales_.set_size(variables.size());
+    for (int i = 0; i < variables.size(); ++i)
+        variable_scales_(i) = group_scales[parameter_groups[i]];
+
+    ROS_INFO("Phase %d diagonal preconditioning : %d groups (%d with gradients), scales %f to %f",
+             PhaseManager::getInstance()->getPhase(), num_groups, num_scaled_groups, min_scale, max_scale);
+}
+
 void ImprovementManagerNLP::addNoiseToVariables(column_vector& variables)
 {
     int num_variables = variables.size();
@@ -518,20 +608,23 @@ void ImprovementManagerNLP::addNoiseToVariables(column_vector& variables)
 
 void ImprovementManagerNLP::computeEvaluationOrder(long variable_size)
 {
-    evaluation_order_.resize(variable_size);
-
     std::vector<long> indices_of_joint_param; // slow due to collision checking
     std::vector<long> indices_of_non_joint_param;
     indices_of_joint_param.reserve(variable_size);
     indices_of_non_joint_param.reserve(variable_size);
     for (long i = 0; i < variable_size; ++i)
     {
+        if (!isTimeWindowParameter(i))
+            continue;
+
         const ItompTrajectoryIndex& index = evaluation_manager_->getTrajectory()->getTrajectoryIndex(i);
         if (index.sub_component == ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)
             indices_of_joint_param.push_back(i);
         else
             indices_of_non_joint_param.push_back(i);
     }
+    evaluation_order_.resize(indices_of_joint_param.size() + indices_of_non_joint_param.size());
+
     // maximize chunk size
     long write_index = 0;
     for (int i = 0; i < num_threads_; ++i)
@@ -546,7 +639,204 @@ void ImprovementManagerNLP::computeEvaluationOrder(long variable_size)
                   evaluation_order_.begin() + write_index);
         write_index += (i + 1) * indices_of_non_joint_param.size() / num_threads_ - i * indices_of_non_joint_param.size() / num_threads_;
     }
-    ROS_ASSERT(write_index == variable_size);
+    ROS_ASSERT(write_index == evaluation_order_.size());
+}
+
+bool ImprovementManagerNLP::useTimeWindows() const
+{
+    int window_size = PlanningParameters::getInstance()->getTimeWindowSize();
+    return time_window_point_end_ == 0 && window_size > 0 &&
+           window_size < evaluation_manager_->getTrajectory()->getNumPoints();
+}
+
+void ImprovementManagerNLP::optimizeTimeWindows(int iteration, column_vector& variables)
+{
+    const PlanningParameters* parameters = PlanningParameters::getInstance();
+    int num_points = evaluation_manager_->getTrajectory()->getNumPoints();
+    int window_size = parameters->getTimeWindowSize();
+    int overlap = std::min(std::max(parameters->getTimeWindowOverlap(), 0), window_size - 1);
+    int stride = window_size - overlap;
+
+    ros::WallTime optimization_start_time = ros::WallTime::now();
+
+    // the line searches of all windows project the contact constraints with the (unchanged) optimizer manager
+    Jacobian::evaluation_manager_ = evaluation_manager_.get();
+
+    evaluation_manager_->setParameters(variables);
+    evaluation_manager_->evaluate();
+
+    bool monitor_convergence = parameters->getPhaseConvergence();
+    if (monitor_convergence)
+        convergence_monitor_.beginTimeWindows(getMaxIterations(), evaluation_manager_->getTrajectoryCost());
+
+    // window managers copied from the evaluated trajectory.
+    // the copies are made before the concurrent optimization, since they read the planning scene
+    time_window_managers_.clear();
+    for (int point_begin = 0; ; point_begin += stride)
+    {
+        int point_end = std::min(point_begin + window_size, num_points);
+
+        ImprovementManagerNLPPtr window_manager(new ImprovementManagerNLP());
+        window_manager->initializeTimeWindow(evaluation_manager_, planning_group_, point_begin, point_end);
+        time_window_managers_.push_back(window_manager);
+
+        if (point_end == num_points)
+            break;
+    }
+    int num_windows = time_window_managers_.size();
+
+    std::vector<int> num_parameter_windows(variables.size(), 0);
+    for (int w = 0; w < num_windows; ++w)
+    {
+        for (long i = 0; i < variables.size(); ++i)
+        {
+            if (time_window_managers_[w]->isTimeWindowParameter(i))
+                ++num_parameter_windows[i];
+        }
+    }
+
+    std::vector<column_vector> window_variables(num_windows);
+    int num_consensus_iterations = std::max(parameters->getTimeWindowConsensusIterations(), 1);
+    int consensus_iteration = 0;
+    for (; consensus_iteration < num_consensus_iterations; ++consensus_iteration)
+    {
+        ros::WallTime iteration_start_time = ros::WallTime::now();
+
+        // each window from the current consensus. the derivative loops of the windows run in their threads
+        #pragma omp parallel for schedule(dynamic)
+        for (int w = 0; w < num_windows; ++w)
+        {
+            window_variables[w] = variables;
+            time_window_managers_[w]->optimizeTimeWindow(window_variables[w]);
+        }
+
+        // consensus of the overlaps
+        double disagreement = 0.0;
+        for (long i = 0; i < variables.size(); ++i)
+        {
+            if (num_parameter_windows[i] == 0)
+                continue;
+
+            double sum = 0.0;
+            double min_value = std::numeric_limits<double>::max();
+            double max_value = -std::numeric_limits<double>::max();
+            for (int w = 0; w < num_windows; ++w)
+            {
+                if (!time_window_managers_[w]->isTimeWindowParameter(i))
+                    continue;
+                double value = window_variables[w](i);
+                sum += value;
+                min_value = std::min(min_value, value);
+                max_value = std::max(max_value, value);
+            }
+            variables(i) = sum / num_parameter_windows[i];
+            disagreement = std::max(disagreement, max_value - min_value);
+        }
+
+        double cost = evaluate(variables);
+
+        if (monitor_convergence)
+        {
+            std::vector<const PhaseConvergenceMonitor*> window_monitors(num_windows);
+            for (int w = 0; w < num_windows; ++w)
+                window_monitors[w] = &time_window_managers_[w]->getConvergenceMonitor();
+            convergence_monitor_.updateTimeWindows(window_monitors, cost);
+        }
+
+        ROS_INFO("Phase %d time window consensus iteration %d : cost %f, largest overlap disagreement %f, %f sec",
+                 PhaseManager::getInstance()->getPhase(), consensus_iteration, cost, disagreement,
+                 (ros::WallTime::now() - iteration_start_time).toSec());
+
+        if (disagreement < eps_)
+        {
+            ++consensus_iteration;
+            break;
+        }
+    }
+
+    int num_evaluations = 0, num_derivatives = 0;
+    for (int w = 0; w < num_windows; ++w)
+    {
+        num_evaluations += time_window_managers_[w]->evaluation_count_;
+        num_derivatives += time_window_managers_[w]->derivative_count_;
+    }
+    ROS_INFO("Phase %d time windows : %d windows of %d points (overlap %d) on %d threads, %d consensus iterations, "
+             "%d evaluations, %d derivatives, %f sec",
+             PhaseManager::getInstance()->getPhase(), num_windows, window_size, overlap, num_threads_, consensus_iteration,
+             num_evaluations, num_derivatives, (ros::WallTime::now() - optimization_start_time).toSec());
+    if (monitor_convergence)
+        convergence_monitor_.end();
+
+    evaluation_manager_->printTrajectoryCost(0, true);
+    evaluation_manager_->render();
+}
+
+void ImprovementManagerNLP::initializeTimeWindow(const NewEvalManagerPtr& evaluation_manager,
+        const ItompPlanningGroupConstPtr& planning_group, int point_begin, int point_end)
+{
+    start_time_ = ros::Time::now();
+
+    time_window_point_begin_ = point_begin;
+    time_window_point_end_ = point_end;
+
+    // a parameter changes the points within a keyframe interval.
+    // the costs of the other points do not change in the window optimization
+    const ItompTrajectoryConstPtr& trajectory = evaluation_manager->getTrajectory();
+    int keyframe_interval = trajectory->getKeyframeInterval();
+    NewEvalManagerPtr window_evaluation_manager(new NewEvalManager(*evaluation_manager));
+    window_evaluation_manager->setAsReference();
+    window_evaluation_manager->setEvaluationRange(std::max(point_begin - keyframe_interval, 0),
+                                                  std::min(point_end + keyframe_interval, (int)trajectory->getNumPoints()));
+
+    ImprovementManager::initialize(window_evaluation_manager, planning_group);
+
+    // the thread optimizing the window computes its derivatives
+    num_threads_ = 1;
+    derivatives_evaluation_manager_.resize(num_threads_);
+    derivatives_evaluation_manager_[0].reset(new NewEvalManager(*window_evaluation_manager));
+}
+
+void ImprovementManagerNLP::optimizeTimeWindow(column_vector& variables)
+{
+    best_cost_ = std::numeric_limits<double>::max();
+
+    computeEvaluationOrder(variables.size());
+
+    // the parameters of the other windows are fixed
+    column_vector x_lower, x_upper;
+    computeParameterBounds(x_lower, x_upper);
+    for (long i = 0; i < variables.size(); ++i)
+    {
+        if (!isTimeWindowParameter(i))
+            x_lower(i) = x_upper(i) = variables(i);
+    }
+
+    // the monitor of the window is read by the consensus loop, so it is not ended
+    if (PlanningParameters::getInstance()->getPhaseConvergence())
+    {
+        convergence_monitor_.begin(getMaxIterations(), evaluation_manager_.get(), x_lower, x_upper);
+        findMin(PhaseConvergenceStopStrategy(&convergence_monitor_, &variable_scales_), variables, x_lower, x_upper);
+    }
+    else
+        findMin(dlib::objective_delta_stop_strategy(eps_, getMaxIterations()), variables, x_lower, x_upper);
+}
+
+int ImprovementManagerNLP::getMaxIterations() const
+{
+    int max_iterations = PlanningParameters::getInstance()->getMaxIterations();
+    // the augmented Lagrangian outer loop repeats the inner optimization instead
+    if (PhaseManager::getInstance()->getPhase() > 2 && !AugmentedLagrangian::getInstance()->isActive())
+        max_iterations *= 10;
+    return max_iterations;
+}
+
+bool ImprovementManagerNLP::isTimeWindowParameter(long parameter_index) const
+{
+    if (time_window_point_end_ == 0)
+        return true;
+
+    int point = evaluation_manager_->getTrajectory()->getTrajectoryIndex(parameter_index).point;
+    return point >= time_window_point_begin_ && point < time_window_point_end_;
 }
 
 }
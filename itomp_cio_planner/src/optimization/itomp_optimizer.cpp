@@ -1,10 +1,12 @@
 #include <ros/ros.h>
 #include <itomp_cio_planner/optimization/itomp_optimizer.h>
 #include <itomp_cio_planner/optimization/phase_manager.h>
+#include <itomp_cio_planner/optimization/augmented_lagrangian.h>
 #include <itomp_cio_planner/contact/ground_manager.h>
 #include <itomp_cio_planner/visualization/new_viz_manager.h>
 #include <itomp_cio_planner/util/planning_parameters.h>
 #include <itomp_cio_planner/optimization/improvement_manager_nlp.h>
+#include <itomp_cio_planner/optimization/improvement_manager_gauss_newton.h>
 //#include <itomp_cio_planner/optimization/improvement_manager_chomp.h>
 
 using namespace std;
@@ -33,7 +35,10 @@ void ItompOptimizer::initialize(const ItompTrajectoryPtr& itomp_trajectory,
 								double trajectory_start_time,
                                 const std::vector<moveit_msgs::Constraints>& trajectory_constraints)
 {
-	improvement_manager_ = boost::make_shared<ImprovementManagerNLP>();
+	if (PlanningParameters::getInstance()->getGaussNewton())
+		improvement_manager_ = boost::make_shared<ImprovementManagerGaussNewton>();
+	else
+		improvement_manager_ = boost::make_shared<ImprovementManagerNLP>();
 	//improvement_manager_ = boost::make_shared<ImprovementManagerChomp>();
 
 	NewVizManager::getInstance()->setPlanningGroup(planning_group);
@@ -56,7 +61,7 @@ ItompOptimizer::~ItompOptimizer()
     evaluation_manager_.reset();
 }
 
-bool ItompOptimizer::optimize()
+bool ItompOptimizer::optimize(int num_phases, int first_phase)
 {
 	ros::WallTime start_time = ros::WallTime::now();
 	iteration_ = -1;
@@ -66,14 +71,18 @@ bool ItompOptimizer::optimize()
 
 	improvement_manager_->updatePlanningParameters();
 
+    improvement_manager_->getConvergenceMonitor().resetStatistics();
+    AugmentedLagrangian::getInstance()->reset(evaluation_manager_->getTrajectory()->getNumPoints(),
+                                              evaluation_manager_->getPlanningGroup()->getNumContacts());
+
 	evaluation_manager_->evaluate();
 
 	evaluation_manager_->render();
 	updateBestTrajectory();
-	++iteration_;
+	iteration_ = first_phase;
 
 	int iteration_after_feasible_solution = 0;
-    int num_max_iterations = 5;
+    int num_max_iterations = num_phases;
 
 	if (!evaluation_manager_->isLastTrajectoryFeasible())
 	{
@@ -93,7 +102,19 @@ bool ItompOptimizer::optimize()
 
             ROS_INFO("Planning Phase %d...", iteration_);
 
-			improvement_manager_->runSingleIteration(iteration_);
+            if (PlanningParameters::getInstance()->getAdaptiveDiscretization())
+                evaluation_manager_->adaptDiscretization();
+
+            int num_evaluations_begin = evaluation_manager_->getNumEvaluations();
+            if (AugmentedLagrangian::getInstance()->isActive())
+                runAugmentedLagrangian();
+            else
+                improvement_manager_->runSingleIteration(iteration_);
+            // constraint violation of the contact and dynamics phases, for the comparison with the augmented Lagrangian
+            if (iteration_ > 2)
+                ROS_INFO("Phase %d constraint violation %f after %d evaluations", iteration_,
+                         AugmentedLagrangian::getInstance()->computeViolation(evaluation_manager_.get()),
+                         evaluation_manager_->getNumEvaluations() - num_evaluations_begin);
 			evaluation_manager_->printTrajectoryCost(iteration_);
 
 			//bool is_cost_reduced = (evaluation_manager_->getTrajectoryCost() < best_parameter_cost_);
@@ -103,11 +124,28 @@ bool ItompOptimizer::optimize()
 			if (!is_updated)
 				evaluation_manager_->setParameters(best_parameter_trajectory_);
 
+            // the phases > 2 optimize the same costs. the remaining phases would restart
+            // from the stationary point of a phase which converged without decreasing the cost
+            bool is_stationary = false;
+            if (PlanningParameters::getInstance()->getPhaseConvergence() && iteration_ > 2 &&
+                    !AugmentedLagrangian::getInstance()->isActive())
+            {
+                const PhaseConvergenceMonitor& monitor = improvement_manager_->getConvergenceMonitor();
+                is_stationary = monitor.isConverged() &&
+                                monitor.getPhaseRelativeDecrease() < PlanningParameters::getInstance()->getPhaseConvergenceRelativeDecrease();
+            }
+
 			++iteration_;
 
             if (iteration_after_feasible_solution > PlanningParameters::getInstance()->getMaxIterationsAfterCollisionFree())
 				break;
 
+            if (is_stationary)
+            {
+                ROS_INFO("Optimization ended after phase %d : the phase converged without decreasing the cost", iteration_ - 1);
+                break;
+            }
+
             if (iteration_ == 1)
             {
                 evaluation_manager_->getTrajectoryNonConst()->interpolateStartEnd(ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
@@ -122,11 +160,22 @@ bool ItompOptimizer::optimize()
 
 	evaluation_manager_->setParameters(best_parameter_trajectory_);
     evaluation_manager_->correctContacts();
+    // the result is evaluated at all points
+    evaluation_manager_->resetDiscretization();
 	evaluation_manager_->evaluate();
 	evaluation_manager_->printTrajectoryCost(iteration_);
 
 	evaluation_manager_->render();
 
+    if (PlanningParameters::getInstance()->getPhaseConvergence())
+    {
+        const PhaseConvergenceMonitor& monitor = improvement_manager_->getConvergenceMonitor();
+        int num_fixed_iterations = monitor.getTotalFixedIterations();
+        ROS_INFO("Phase convergence : %d iterations instead of the fixed %d (%f%% saved)",
+                 monitor.getTotalIterations(), num_fixed_iterations,
+                 num_fixed_iterations == 0 ? 0.0 : 100.0 * (num_fixed_iterations - monitor.getTotalIterations()) / num_fixed_iterations);
+    }
+
 	double elpsed_time = (ros::WallTime::now() - start_time).toSec();
 
     //ROS_INFO("Terminated after %d iterations, using path from iteration %d", iteration_, best_parameter_iteration_);
@@ -143,6 +192,28 @@ bool ItompOptimizer::optimize()
 	return is_best_parameter_feasible_;
 }
 
+void ItompOptimizer::runAugmentedLagrangian()
+{
+    AugmentedLagrangian* augmented_lagrangian = AugmentedLagrangian::getInstance();
+    double tolerance = PlanningParameters::getInstance()->getAugmentedLagrangianTolerance();
+    int num_evaluations_begin = evaluation_manager_->getNumEvaluations();
+
+    for (int i = 0; i < PlanningParameters::getInstance()->getAugmentedLagrangianMaxIterations(); ++i)
+    {
+        improvement_manager_->runSingleIteration(iteration_);
+
+        double violation = augmented_lagrangian->update(evaluation_manager_.get());
+        ROS_INFO("Phase %d augmented Lagrangian iteration %d : constraint violation %f (tolerance %f) after %d evaluations, penalty scale %f",
+                 iteration_, i, violation, tolerance, evaluation_manager_->getNumEvaluations() - num_evaluations_begin,
+                 augmented_lagrangian->getPenaltyScale());
+        if (violation < tolerance)
+            break;
+    }
+
+    // the cost of the last multipliers
+    evaluation_manager_->evaluate();
+}
+
 bool ItompOptimizer::updateBestTrajectory()
 {
 	double cost = evaluation_manager_->getTrajectoryCost();
@@ -9,6 +9,7 @@
 #include <itomp_cio_planner/model/rbdl_model_util.h>
 #include <itomp_cio_planner/contact/ground_manager.h>
 #include <itomp_cio_planner/contact/contact_util.h>
+#include <itomp_cio_planner/collision/collision_world_manager.h>
 #include <itomp_cio_planner/visualization/new_viz_manager.h>
 #include <itomp_cio_planner/util/min_jerk_trajectory.h>
 #include <itomp_cio_planner/util/planning_parameters.h>
@@ -18,6 +19,7 @@
 #include <visualization_msgs/MarkerArray.h>
 #include <ecl/geometry/polynomial.hpp>
 #include <ecl/geometry.hpp>
+#include <algorithm>
 
 using namespace std;
 using namespace Eigen;
@@ -29,10 +31,14 @@ const NewEvalManager* NewEvalManager::ref_evaluation_manager_ = NULL;
 
 NewEvalManager::NewEvalManager() :
     last_trajectory_feasible_(false),
-    best_cost_(std::numeric_limits<double>::max())
+    best_cost_(std::numeric_limits<double>::max()),
+    num_evaluations_(0),
+    evaluation_point_begin_(0),
+    evaluation_point_end_(0)
 {
     if (ref_evaluation_manager_ == NULL)
         ref_evaluation_manager_ = this;
+    reference_manager_ = ref_evaluation_manager_;
 }
 
 NewEvalManager::NewEvalManager(const NewEvalManager& manager)
@@ -43,12 +49,28 @@ NewEvalManager::NewEvalManager(const NewEvalManager& manager)
       trajectory_start_time_(manager.trajectory_start_time_),
       last_trajectory_feasible_(manager.last_trajectory_feasible_),
       best_cost_(manager.best_cost_),
+      num_evaluations_(manager.num_evaluations_),
+      evaluation_point_begin_(manager.evaluation_point_begin_),
+      evaluation_point_end_(manager.evaluation_point_end_),
+      point_weights_(manager.point_weights_),
       rbdl_models_(manager.rbdl_models_),
       joint_torques_(manager.joint_torques_),
       external_forces_(manager.external_forces_),
       contact_variables_(manager.contact_variables_),
+      passive_forces_(manager.passive_forces_),
+      external_wrench_body_ids_(manager.external_wrench_body_ids_),
+      external_wrench_values_(manager.external_wrench_values_),
+      ground_projection_cache_(manager.ground_projection_cache_),
+      rbdl_model_states_(manager.rbdl_model_states_.size(), RBDL_MODEL_STATE_STALE),
+      rbdl_model_modified_joints_(manager.rbdl_model_modified_joints_.size(), NULL),
+      root_body_ids_(manager.root_body_ids_),
+      root_momentum_rates_(manager.root_momentum_rates_),
+      convex_decompositions_(manager.convex_decompositions_),
+      batched_obstacle_results_(manager.batched_obstacle_results_.size()),
+      batched_obstacle_result_valid_(manager.batched_obstacle_result_valid_.size(), 0),
       evaluation_cost_matrix_(manager.evaluation_cost_matrix_),
-      trajectory_constraints_(manager.trajectory_constraints_)
+      trajectory_constraints_(manager.trajectory_constraints_),
+      reference_manager_(manager.reference_manager_)
 {
     itomp_trajectory_.reset(new ItompTrajectory(*manager.getTrajectory()));
     itomp_trajectory_const_ = itomp_trajectory_;
@@ -57,12 +79,16 @@ NewEvalManager::NewEvalManager(const NewEvalManager& manager)
     for (int i = 0; i < itomp_trajectory_->getNumPoints(); ++i)
         robot_state_[i].reset(new robot_state::RobotState(*manager.robot_state_[i]));
 
-    const collision_detection::WorldPtr world(new collision_detection::World(*planning_scene_->getWorld()));
-    collision_world_derivatives_.reset(new CollisionWorldFCLDerivatives(
-                                           dynamic_cast<const collision_detection::CollisionWorldFCL&>(*planning_scene_->getCollisionWorld()), world));
+    collision_world_derivatives_ = CollisionWorldManager::getInstance()->createCollisionWorld();
     collision_robot_derivatives_.reset(new CollisionRobotFCLDerivatives(
                                            dynamic_cast<const collision_detection::CollisionRobotFCL&>(*planning_scene_->getCollisionRobotUnpadded())));
     collision_robot_derivatives_->constructInternalFCLObject(planning_scene_->getCurrentState());
+    collision_world_derivatives_->initializeSweptBroadphase(itomp_trajectory_->getNumPoints());
+    if (PlanningParameters::getInstance()->getGJKWarmStart())
+    {
+        collision_world_derivatives_->initializeGJKWarmStart(itomp_trajectory_->getNumPoints());
+        collision_robot_derivatives_->initializeGJKWarmStart(itomp_trajectory_->getNumPoints());
+    }
 }
 
 NewEvalManager::~NewEvalManager()
@@ -78,12 +104,30 @@ NewEvalManager& NewEvalManager::operator=(const NewEvalManager& manager)
     trajectory_start_time_ = manager.trajectory_start_time_;
     last_trajectory_feasible_ = manager.last_trajectory_feasible_;
     best_cost_ = manager.best_cost_;
+    num_evaluations_ = manager.num_evaluations_;
+    evaluation_point_begin_ = manager.evaluation_point_begin_;
+    evaluation_point_end_ = manager.evaluation_point_end_;
+    point_weights_ = manager.point_weights_;
     rbdl_models_ = manager.rbdl_models_;
     joint_torques_ = manager.joint_torques_;
     external_forces_ = manager.external_forces_;
     contact_variables_ = manager.contact_variables_;
+    passive_forces_ = manager.passive_forces_;
+    external_wrench_body_ids_ = manager.external_wrench_body_ids_;
+    external_wrench_values_ = manager.external_wrench_values_;
+    ground_projection_cache_ = manager.ground_projection_cache_;
+    rbdl_model_states_.resize(manager.rbdl_model_states_.size());
+    rbdl_model_modified_joints_.resize(manager.rbdl_model_modified_joints_.size());
+    invalidateRBDLModelStates();
+    root_body_ids_ = manager.root_body_ids_;
+    root_momentum_rates_ = manager.root_momentum_rates_;
+    convex_decompositions_ = manager.convex_decompositions_;
+    batched_obstacle_results_.resize(manager.batched_obstacle_results_.size());
+    batched_obstacle_result_valid_.resize(manager.batched_obstacle_result_valid_.size());
+    invalidateBatchedObstacleQueries(0, batched_obstacle_result_valid_.size());
     evaluation_cost_matrix_ = manager.evaluation_cost_matrix_;
     trajectory_constraints_ = manager.trajectory_constraints_;
+    reference_manager_ = manager.reference_manager_;
 
     // allocate
     itomp_trajectory_.reset(new ItompTrajectory(*manager.getTrajectory()));
@@ -93,12 +137,16 @@ NewEvalManager& NewEvalManager::operator=(const NewEvalManager& manager)
     for (int i = 0; i < itomp_trajectory_->getNumPoints(); ++i)
         robot_state_[i].reset(new robot_state::RobotState(*manager.robot_state_[i]));
 
-    const collision_detection::WorldPtr world(new collision_detection::World(*planning_scene_->getWorld()));
-    collision_world_derivatives_.reset(new CollisionWorldFCLDerivatives(
-                                           dynamic_cast<const collision_detection::CollisionWorldFCL&>(*planning_scene_->getCollisionWorld()), world));
+    collision_world_derivatives_ = CollisionWorldManager::getInstance()->createCollisionWorld();
     collision_robot_derivatives_.reset(new CollisionRobotFCLDerivatives(
                                            dynamic_cast<const collision_detection::CollisionRobotFCL&>(*planning_scene_->getCollisionRobotUnpadded())));
     collision_robot_derivatives_->constructInternalFCLObject(planning_scene_->getCurrentState());
+    collision_world_derivatives_->initializeSweptBroadphase(itomp_trajectory_->getNumPoints());
+    if (PlanningParameters::getInstance()->getGJKWarmStart())
+    {
+        collision_world_derivatives_->initializeGJKWarmStart(itomp_trajectory_->getNumPoints());
+        collision_robot_derivatives_->initializeGJKWarmStart(itomp_trajectory_->getNumPoints());
+    }
 
     return *this;
 }
@@ -121,15 +169,39 @@ void NewEvalManager::initialize(const ItompTrajectoryPtr& itomp_trajectory,
 
     int num_points = itomp_trajectory_->getNumPoints();
     int num_joints = itomp_trajectory_->getNumJoints();
+    evaluation_point_begin_ = 0;
+    evaluation_point_end_ = num_points;
+    point_weights_.assign(num_points, 1.0);
 
 	TrajectoryCostManager::getInstance()->buildActiveCostFunctions(this);
     evaluation_cost_matrix_.setZero(num_points, TrajectoryCostManager::getInstance()->getNumActiveCostFunctions());
 
 
     rbdl_models_.resize(num_points, robot_model_->getRBDLRobotModel());
+    rbdl_model_states_.resize(num_points);
+    rbdl_model_modified_joints_.resize(num_points);
+    invalidateRBDLModelStates();
+    initializeRootBodyIds();
+    bool solve_contact_forces = PlanningParameters::getInstance()->getContactForceSolve();
+    if (solve_contact_forces && root_body_ids_.empty())
+    {
+        ROS_ERROR("contact_force_solve needs a floating root joint. The contact forces are optimized.");
+        solve_contact_forces = false;
+    }
+    PhaseManager::getInstance()->setContactForcesSolved(solve_contact_forces);
+    root_momentum_rates_.resize(num_points, RigidBodyDynamics::Math::SpatialVectorZero);
     joint_torques_.resize(num_points, Eigen::VectorXd(num_joints));
     external_forces_.resize(num_points,
                             std::vector<RigidBodyDynamics::Math::SpatialVector>(robot_model_->getRBDLRobotModel().mBodies.size(), RigidBodyDynamics::Math::SpatialVectorZero));
+    passive_forces_.resize(num_joints + 1, 0.0);
+    initializeExternalWrenches();
+
+    batched_obstacle_results_.resize(num_points);
+    batched_obstacle_result_valid_.resize(num_points);
+    invalidateBatchedObstacleQueries(0, num_points);
+
+    ground_projection_cache_.initialize(num_points, planning_group_->getNumContacts(),
+                                        PlanningParameters::getInstance()->getCIEvaluationOnPoints() ? NUM_ENDEFFECTOR_CONTACT_POINTS : 1);
 
     robot_state_.resize(num_points);
     for (int i = 0; i < num_points; ++i)
@@ -140,21 +212,64 @@ void NewEvalManager::initialize(const ItompTrajectoryPtr& itomp_trajectory,
     itomp_trajectory_->computeParameterToTrajectoryIndexMap(robot_model, planning_group);
     itomp_trajectory_->interpolateKeyframes(planning_group);
 
-    const collision_detection::WorldPtr world(new collision_detection::World(*planning_scene_->getWorld()));
-    collision_world_derivatives_.reset(new CollisionWorldFCLDerivatives(
-                                           dynamic_cast<const collision_detection::CollisionWorldFCL&>(*planning_scene_->getCollisionWorld()), world));
+    CollisionWorldManager::getInstance()->update(planning_scene_);
+    convex_decompositions_ = CollisionWorldManager::getInstance()->getConvexDecompositions();
+    collision_world_derivatives_ = CollisionWorldManager::getInstance()->createCollisionWorld();
     collision_robot_derivatives_.reset(new CollisionRobotFCLDerivatives(
                                            dynamic_cast<const collision_detection::CollisionRobotFCL&>(*planning_scene_->getCollisionRobotUnpadded())));
     collision_robot_derivatives_->constructInternalFCLObject(planning_scene_->getCurrentState());
+    collision_world_derivatives_->initializeSweptBroadphase(num_points);
+    if (PlanningParameters::getInstance()->getGJKWarmStart())
+    {
+        collision_world_derivatives_->initializeGJKWarmStart(num_points);
+        collision_robot_derivatives_->initializeGJKWarmStart(num_points);
+    }
 
     trajectory_constraints_ = trajectory_constraints;
 }
 
+void NewEvalManager::runBenchmarks()
+{
+    const PlanningParameters* parameters = PlanningParameters::getInstance();
+
+    if (parameters->getDynamicsFidelityBenchmarkNumTrials() > 0)
+        compareDynamicsFidelities(parameters->getDynamicsFidelityBenchmarkNumTrials());
+
+    if (parameters->getBroadphaseBenchmarkNumTrials() > 0)
+        benchmarkSweptBroadphase(parameters->getBroadphaseBenchmarkNumTrials());
+
+    if (!convex_decompositions_.empty() && parameters->getConvexDecompositionBenchmarkNumTrials() > 0)
+        benchmarkConvexDecompositions(parameters->getConvexDecompositionBenchmarkNumTrials());
+
+    if (parameters->getGJKWarmStartBenchmarkNumTrials() > 0)
+        benchmarkGJKWarmStart(parameters->getGJKWarmStartBenchmarkNumTrials());
+
+    if (parameters->getBatchedObstacleQueriesBenchmarkNumTrials() > 0)
+        benchmarkBatchedObstacleQueries(parameters->getBatchedObstacleQueriesBenchmarkNumTrials());
+}
+
 double NewEvalManager::evaluate()
 {
-    int num_points = itomp_trajectory_->getNumPoints();
+    int point_begin = evaluation_point_begin_;
+    int point_end = evaluation_point_end_;
+    ++num_evaluations_;
 
-    performFullForwardKinematicsAndDynamics(0, num_points);
+    performFullForwardKinematicsAndDynamics(point_begin, point_end);
+    // the trajectory keeps the solved contact forces
+    if (isContactForceSolveActive())
+    {
+        for (int i = point_begin; i < point_end; ++i)
+        {
+            if (isPointEvaluated(i))
+                itomp_trajectory_->setContactVariables(i, contact_variables_[i]);
+        }
+    }
+    // the batched queries answer the obstacle cost of every point, and keep answering it
+    // for the partial evaluations which do not move the joints
+    if (updateBatchedObstacleQueries(point_begin, point_end))
+        collision_world_derivatives_->clearSweptBroadphase();
+    else
+        updateSweptBroadphase(point_begin, point_end);
 
     std::vector<TrajectoryCostPtr>& cost_functions = TrajectoryCostManager::getInstance()->getCostFunctionVector();
     // cost weight changed
@@ -165,11 +280,12 @@ double NewEvalManager::evaluate()
     for (int c = 0; c < cost_functions.size(); ++c)
     {
         cost_functions[c]->preEvaluate(this);
-        for (int i = 0; i < num_points; ++i)
+        for (int i = point_begin; i < point_end; ++i)
         {
             double cost = 0.0;
-            last_trajectory_feasible_ &= cost_functions[c]->evaluate(this, i, cost);
-            evaluation_cost_matrix_(i, c) = cost_functions[c]->getWeight() * cost;
+            if (isPointEvaluated(i))
+                last_trajectory_feasible_ &= cost_functions[c]->evaluate(this, i, cost);
+            evaluation_cost_matrix_(i, c) = getPointWeight(i) * cost_functions[c]->getWeight() * cost;
         }
         cost_functions[c]->postEvaluate(this);
     }
@@ -241,23 +357,72 @@ void NewEvalManager::computeCostDerivatives(int parameter_index, const ItompTraj
 
 }
 
+int NewEvalManager::getNumPointResiduals() const
+{
+    const std::vector<TrajectoryCostPtr>& cost_functions = TrajectoryCostManager::getInstance()->getCostFunctionVector();
+
+    int num_residuals = 0;
+    for (int c = 0; c < cost_functions.size(); ++c)
+        num_residuals += cost_functions[c]->getNumResiduals(this);
+    return num_residuals;
+}
+
+double NewEvalManager::evaluateResiduals(Eigen::MatrixXd& residual_matrix)
+{
+    double cost = evaluate();
+
+    evaluatePointRangeResiduals(0, itomp_trajectory_->getNumPoints(), residual_matrix, NULL);
+
+    return cost;
+}
+
+void NewEvalManager::computeResidualDerivatives(int parameter_index, const ItompTrajectory::ParameterVector& parameters,
+        Eigen::MatrixXd& derivatives, unsigned int& point_begin, unsigned int& point_end, double eps)
+{
+    const double value = parameters(parameter_index, 0);
+    const ItompTrajectoryIndex& index = itomp_trajectory_->getTrajectoryIndex(parameter_index);
+
+    changeParameterPoint(value + eps, parameter_index, point_begin, point_end, true);
+    evaluatePointRangeResiduals(point_begin, point_end, residual_matrix_plus_, &index);
+
+    changeParameterPoint(value - eps, parameter_index, point_begin, point_end, false);
+    evaluatePointRangeResiduals(point_begin, point_end, residual_matrix_minus_, &index);
+
+    derivatives = (residual_matrix_plus_.middleRows(point_begin, point_end - point_begin) -
+                   residual_matrix_minus_.middleRows(point_begin, point_end - point_begin)) / (2 * eps);
+
+    itomp_trajectory_->restoreTrajectory();
+}
+
 void NewEvalManager::evaluateParameterPoint(double value, int parameter_index,
         unsigned int& point_begin, unsigned int& point_end, bool first)
 {
-    itomp_trajectory_->directChangeForDerivativeComputation(parameter_index, value, point_begin, point_end, first);
+    changeParameterPoint(value, parameter_index, point_begin, point_end, first);
 
     const ItompTrajectoryIndex& index = itomp_trajectory_->getTrajectoryIndex(parameter_index);
+    evaluatePointRange(point_begin, point_end, evaluation_cost_matrix_, index);
+}
 
-    if (index.component == ItompTrajectory::COMPONENT_TYPE_POSITION && index.sub_component == ItompTrajectory::SUB_COMPONENT_TYPE_JOINT &&
-            index.element < 2)
-        itomp_trajectory_->avoidNeighbors(trajectory_constraints_);
+void NewEvalManager::changeParameterPoint(double value, int parameter_index,
+        unsigned int& point_begin, unsigned int& point_end, bool first)
+{
+    itomp_trajectory_->directChangeForDerivativeComputation(parameter_index, value, point_begin, point_end, first);
+
+    const ItompTrajectoryIndex& index = itomp_trajectory_->getTrajectoryIndex(parameter_index);
 
     if (index.point == point_end)
         ++point_end;
 
     performPartialForwardKinematicsAndDynamics(point_begin, point_end, index);
+}
 
-    evaluatePointRange(point_begin, point_end, evaluation_cost_matrix_, index);
+void NewEvalManager::updateCollisionQueries(int point_begin, int point_end, const ItompTrajectoryIndex& index)
+{
+    if (index.sub_component == ItompTrajectory::SUB_COMPONENT_TYPE_JOINT || index.sub_component == ItompTrajectory::SUB_COMPONENT_TYPE_ALL)
+    {
+        invalidateBatchedObstacleQueries(point_begin, point_end);
+        updateSweptBroadphase(point_begin, point_end);
+    }
 }
 
 bool NewEvalManager::evaluatePointRange(int point_begin, int point_end, Eigen::MatrixXd& cost_matrix, const ItompTrajectoryIndex& index)
@@ -270,6 +435,8 @@ bool NewEvalManager::evaluatePointRange(int point_begin, int point_end, Eigen::M
     if (cost_functions.size() != cost_matrix.cols())
         cost_matrix = Eigen::MatrixXd::Zero(cost_matrix.rows(),	cost_functions.size());
 
+    updateCollisionQueries(point_begin, point_end, index);
+
     for (int c = 0; c < cost_functions.size(); ++c)
     {
         if (cost_functions[c]->isInvariant(this, index))
@@ -283,9 +450,10 @@ bool NewEvalManager::evaluatePointRange(int point_begin, int point_end, Eigen::M
             {
                 double cost = 0.0;
 
-                is_feasible &= cost_functions[c]->evaluate(this, i, cost);
+                if (isPointEvaluated(i))
+                    is_feasible &= cost_functions[c]->evaluate(this, i, cost);
 
-                cost_matrix(i, c) = cost_functions[c]->getWeight() * cost;
+                cost_matrix(i, c) = getPointWeight(i) * cost_functions[c]->getWeight() * cost;
             }
         }
     }
@@ -293,6 +461,51 @@ bool NewEvalManager::evaluatePointRange(int point_begin, int point_end, Eigen::M
     return is_feasible;
 }
 
+void NewEvalManager::evaluatePointRangeResiduals(int point_begin, int point_end, Eigen::MatrixXd& residual_matrix, const ItompTrajectoryIndex* index)
+{
+    const std::vector<TrajectoryCostPtr>& cost_functions = TrajectoryCostManager::getInstance()->getCostFunctionVector();
+
+    int num_residuals = getNumPointResiduals();
+    if (residual_matrix.rows() != itomp_trajectory_->getNumPoints() || residual_matrix.cols() != num_residuals)
+        residual_matrix = Eigen::MatrixXd::Zero(itomp_trajectory_->getNumPoints(), num_residuals);
+
+    if (index != NULL)
+        updateCollisionQueries(point_begin, point_end, *index);
+
+    std::vector<double> residuals;
+    int residual_begin = 0;
+    for (int c = 0; c < cost_functions.size(); ++c)
+    {
+        int num_cost_residuals = cost_functions[c]->getNumResiduals(this);
+        double scale = std::sqrt(cost_functions[c]->getWeight());
+
+        // an invariant cost does not change the derivatives
+        if (index != NULL && cost_functions[c]->isInvariant(this, *index))
+        {
+            residual_matrix.block(point_begin, residual_begin, point_end - point_begin, num_cost_residuals).setZero();
+        }
+        else
+        {
+            residuals.resize(num_cost_residuals);
+            for (int i = point_begin; i < point_end; ++i)
+            {
+                if (!isPointEvaluated(i))
+                {
+                    residual_matrix.block(i, residual_begin, 1, num_cost_residuals).setZero();
+                    continue;
+                }
+
+                cost_functions[c]->evaluateResiduals(this, i, &residuals[0]);
+                double point_scale = scale * std::sqrt(getPointWeight(i));
+                for (int r = 0; r < num_cost_residuals; ++r)
+                    residual_matrix(i, residual_begin + r) = point_scale * residuals[r];
+            }
+        }
+
+        residual_begin += num_cost_residuals;
+    }
+}
+
 void NewEvalManager::render()
 {
 	bool is_best = (getTrajectoryCost() <= best_cost_);
@@ -312,7 +525,9 @@ void NewEvalManager::render()
 
     if (is_best)
     {
-        NewVizManager::getInstance()->animateInternalForces(itomp_trajectory_, rbdl_models_, true, true);
+        // the reduced fidelities leave momentum rates instead of the joint forces in the models
+        if (getDynamicsFidelity() == DYNAMICS_FIDELITY_FULL)
+            NewVizManager::getInstance()->animateInternalForces(itomp_trajectory_, rbdl_models_, true, true);
         NewVizManager::getInstance()->animateCenterOfMass(itomp_trajectory_, rbdl_models_);
     }
 }
@@ -321,12 +536,20 @@ void NewEvalManager::performFullForwardKinematicsAndDynamics(int point_begin, in
 {
 	TIME_PROFILER_START_TIMER(FK);
 
+    for (int point = point_begin; point < point_end; ++point)
+        rbdl_model_states_[point] = RBDL_MODEL_STATE_STALE;
+
+    int dynamics_fidelity = getDynamicsFidelity();
+
 	int num_contacts = planning_group_->getNumContacts();
     int num_joints = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
                      ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getNumElements();
 
 	for (int point = point_begin; point < point_end; ++point)
 	{
+        if (!isPointEvaluated(point))
+            continue;
+
         const Eigen::VectorXd& q = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
                                    ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getTrajectoryPoint(point);
 
@@ -359,7 +582,7 @@ void NewEvalManager::performFullForwardKinematicsAndDynamics(int point_begin, in
                 {
                     Eigen::Vector3d& point_position = contact_variables_[point][i].projected_point_positions_[c];
                     Eigen::Vector3d point_orientation;
-                    GroundManager::getInstance()->getNearestContactPosition(point_position, proj_orientation,
+                    ground_projection_cache_.getNearestContactPosition(point, i, c, point_position, proj_orientation,
                             point_position, point_orientation, contact_normal, i < 2);
 
                     int rbdl_point_id = planning_group_->contact_points_[i].getContactPointRBDLIds(c);
@@ -387,7 +610,7 @@ void NewEvalManager::performFullForwardKinematicsAndDynamics(int point_begin, in
                 const Eigen::Vector3d contact_orientation = contact_variables_[point][i].getOrientation();
 
                 Eigen::Vector3d contact_normal, proj_position, proj_orientation;
-                GroundManager::getInstance()->getNearestContactPosition(contact_position, contact_orientation,
+                ground_projection_cache_.getNearestContactPosition(point, i, 0, contact_position, contact_orientation,
                         proj_position, proj_orientation, contact_normal, i < 2);
 
                 contact_variables_[point][i].ComputeProjectedPointPositions(proj_position, proj_orientation,
@@ -417,34 +640,34 @@ void NewEvalManager::performFullForwardKinematicsAndDynamics(int point_begin, in
             }
         }
 
-        // compute forces pushing box
-        //const RigidBodyDynamics::Model& rbdl_model = getRBDLModel(point);
-        //rbdl_model
-        const double box_mass = 50.0;
-        const double mu_kinetic = 0.4;
-        const double gravity = 9.8;
-        const double force_on_hand = box_mass * mu_kinetic * gravity / 2.0;
-        const int hands_ids[2] = {55, 76};
-        for (int i=0; i<2; i++)
-        {
-            const int rbdl_id = hands_ids[i];
+        // external wrenches
+        if (!external_wrench_body_ids_.empty())
+            applyExternalWrenches(point);
 
-            RigidBodyDynamics::Math::SpatialVector& ext_force = external_forces_[point][rbdl_id];
-            for (int j = 0; j < 3; ++j)
-            {
-                ext_force(j) = 0.0;
-                ext_force(j + 3) = 0.0;
-            }
+        // passive forces
+        computePassiveForces(point, q, q_dot, passive_forces_);
 
-            // force to X-axis direction
-            ext_force(3) = force_on_hand;
+        switch (dynamics_fidelity)
+        {
+        case DYNAMICS_FIDELITY_ROOT_WRENCH:
+            updateFullKinematicsAndMomentumRates(rbdl_models_[point], q, q_dot, q_ddot, root_momentum_rates_[point]);
+            computeRootJointTorques(rbdl_models_[point], root_momentum_rates_[point], &external_forces_[point], &passive_forces_,
+                                    root_body_ids_, joint_torques_[point]);
+            break;
+
+        case DYNAMICS_FIDELITY_CENTROIDAL:
+            updateFullKinematicsAndCentroidalMomentumRate(rbdl_models_[point], q, q_dot, q_ddot, root_momentum_rates_[point], root_body_ids_);
+            computeRootJointTorques(rbdl_models_[point], root_momentum_rates_[point], &external_forces_[point], &passive_forces_,
+                                    root_body_ids_, joint_torques_[point]);
+            break;
+
+        default:
+            updateFullKinematicsAndDynamics(rbdl_models_[point], q, q_dot, q_ddot, joint_torques_[point], &external_forces_[point], &passive_forces_);
+            break;
         }
 
-        // passive forces
-        std::vector<double> passive_forces(num_joints + 1, 0.0);
-        computePassiveForces(point, q, q_dot, passive_forces);
-
-        updateFullKinematicsAndDynamics(rbdl_models_[point], q, q_dot, q_ddot, joint_torques_[point], &external_forces_[point], &passive_forces);
+        if (isContactForceSolveActive())
+            solveContactForces(point, q, q_dot, q_ddot);
 	}
 
 	TIME_PROFILER_END_TIMER(FK);
@@ -455,18 +678,15 @@ void NewEvalManager::performPartialForwardKinematicsAndDynamics(int point_begin,
     TIME_PROFILER_START_TIMER(FK);
 
     bool dynamics_only = (index.sub_component != ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+    int dynamics_fidelity = getDynamicsFidelity();
     int num_contacts = planning_group_->getNumContacts();
     int num_joints = itomp_trajectory_->getNumJoints();
 
     // copy only variables will be updated
     for (int point = point_begin; point < point_end; ++point)
     {
-        rbdl_models_[point].f = ref_evaluation_manager_->rbdl_models_[point].f;
-        rbdl_models_[point].X_lambda = ref_evaluation_manager_->rbdl_models_[point].X_lambda;
-        rbdl_models_[point].X_base = ref_evaluation_manager_->rbdl_models_[point].X_base;
-        rbdl_models_[point].v = ref_evaluation_manager_->rbdl_models_[point].v;
-        rbdl_models_[point].a = ref_evaluation_manager_->rbdl_models_[point].a;
-        rbdl_models_[point].c = ref_evaluation_manager_->rbdl_models_[point].c;
+        if (isPointEvaluated(point))
+            restoreRBDLModel(point);
     }
 
     const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
@@ -478,6 +698,9 @@ void NewEvalManager::performPartialForwardKinematicsAndDynamics(int point_begin,
 
     for (int point = point_begin; point < point_end; ++point)
     {
+        if (!isPointEvaluated(point))
+            continue;
+
         const Eigen::VectorXd& q = pos_trajectory->getTrajectoryPoint(point);
         const Eigen::VectorXd& q_dot = vel_trajectory->getTrajectoryPoint(point);
         const Eigen::VectorXd& q_ddot = acc_trajectory->getTrajectoryPoint(point);
@@ -507,7 +730,7 @@ void NewEvalManager::performPartialForwardKinematicsAndDynamics(int point_begin,
                     {
                         Eigen::Vector3d& point_position = contact_variables_[point][i].projected_point_positions_[c];
                         Eigen::Vector3d point_orientation;
-                        GroundManager::getInstance()->getNearestContactPosition(point_position, proj_orientation,
+                        ground_projection_cache_.getNearestContactPosition(point, i, c, point_position, proj_orientation,
                                 point_position, point_orientation, contact_normal, i < 2);
 
                         int rbdl_point_id = planning_group_->contact_points_[i].getContactPointRBDLIds(c);
@@ -535,7 +758,7 @@ void NewEvalManager::performPartialForwardKinematicsAndDynamics(int point_begin,
                     const Eigen::Vector3d contact_orientation = contact_variables_[point][i].getOrientation();
 
                     Eigen::Vector3d contact_normal, proj_position, proj_orientation;
-                    GroundManager::getInstance()->getNearestContactPosition(contact_position, contact_orientation,
+                    ground_projection_cache_.getNearestContactPosition(point, i, 0, contact_position, contact_orientation,
                             proj_position, proj_orientation, contact_normal, i < 2);
 
                     contact_variables_[point][i].ComputeProjectedPointPositions(proj_position, proj_orientation,
@@ -565,53 +788,752 @@ void NewEvalManager::performPartialForwardKinematicsAndDynamics(int point_begin,
                 }
             }
 
-            // compute forces pushing box
-            //const RigidBodyDynamics::Model& rbdl_model = getRBDLModel(point);
-            //rbdl_model
-            const double box_mass = 50.0;
-            const double mu_kinetic = 0.4;
-            const double gravity = 9.8;
-            const double force_on_hand = box_mass * mu_kinetic * gravity / 2.0;
-            const int hands_ids[2] = {55, 76};
-            for (int i=0; i<2; i++)
+            // external wrenches
+            if (!external_wrench_body_ids_.empty())
+                applyExternalWrenches(point);
+
+            // passive forces
+            computePassiveForces(point, q, q_dot, passive_forces_);
+
+            if (dynamics_fidelity != DYNAMICS_FIDELITY_FULL)
             {
-                const int rbdl_id = hands_ids[i];
+                // kinematics is not changed, only the external forces
+                root_momentum_rates_[point] = reference_manager_->root_momentum_rates_[point];
+                computeRootJointTorques(rbdl_models_[point], root_momentum_rates_[point], &external_forces_[point], &passive_forces_,
+                                        root_body_ids_, joint_torques_[point]);
+            }
+            else
+                updatePartialDynamics(rbdl_models_[point], q, q_dot, q_ddot, joint_torques_[point], &external_forces_[point], &passive_forces_);
+
+            if (isContactForceSolveActive())
+                solveContactForces(point, q, q_dot, q_ddot);
+            rbdl_model_states_[point] = RBDL_MODEL_STATE_FORCES_MODIFIED;
+        }
+        else
+        {
+            contact_variables_[point] = reference_manager_->contact_variables_[point];
+            joint_torques_[point] = reference_manager_->joint_torques_[point];
+            external_forces_[point] = reference_manager_->external_forces_[point];
+
+            // passive forces
+            computePassiveForces(point, q, q_dot, passive_forces_);
+
+            const ItompRobotJoint& joint = planning_group_->group_joints_[itomp_trajectory_->getParameterJointIndex(index.element)];
+            if (dynamics_fidelity == DYNAMICS_FIDELITY_CENTROIDAL)
+            {
+                updatePartialKinematicsAndCentroidalMomentumRate(rbdl_models_[point], q, q_dot, q_ddot, root_momentum_rates_[point],
+                        root_body_ids_, joint.rbdl_affected_body_ids_);
+                computeRootJointTorques(rbdl_models_[point], root_momentum_rates_[point], &external_forces_[point], &passive_forces_,
+                                        root_body_ids_, joint_torques_[point]);
+            }
+            else if (dynamics_fidelity == DYNAMICS_FIDELITY_ROOT_WRENCH)
+            {
+                root_momentum_rates_[point] = reference_manager_->root_momentum_rates_[point];
+                updatePartialKinematicsAndMomentumRates(rbdl_models_[point], q, q_dot, q_ddot, root_momentum_rates_[point],
+                                                        joint.rbdl_affected_body_ids_);
+                computeRootJointTorques(rbdl_models_[point], root_momentum_rates_[point], &external_forces_[point], &passive_forces_,
+                                        root_body_ids_, joint_torques_[point]);
+            }
+            else if (joint.rbdl_subtree_begin_ != joint.rbdl_subtree_end_)
+                updateSubtreeKinematicsAndDynamics(rbdl_models_[point], q, q_dot,
+                                                   q_ddot, joint_torques_[point], &external_forces_[point], &passive_forces_,
+                                                   joint.rbdl_subtree_begin_, joint.rbdl_subtree_end_, joint.rbdl_ancestor_body_ids_);
+            else
+                updatePartialKinematicsAndDynamics(rbdl_models_[point], q, q_dot,
+                                                   q_ddot, joint_torques_[point], &external_forces_[point], &passive_forces_,
+                                                   joint.rbdl_affected_body_ids_);
+            rbdl_model_states_[point] = RBDL_MODEL_STATE_SUBTREE_MODIFIED;
+            rbdl_model_modified_joints_[point] = &joint;
+
+            if (isContactForceSolveActive())
+            {
+                solveContactForces(point, q, q_dot, q_ddot);
+                // the full dynamics pass of the new forces modified the forces of all bodies
+                if (dynamics_fidelity == DYNAMICS_FIDELITY_FULL)
+                    rbdl_model_states_[point] = RBDL_MODEL_STATE_STALE;
+            }
+
+        }
+    }
+
+    TIME_PROFILER_END_TIMER(FK);
+}
+
+bool NewEvalManager::isContactForceSolveActive() const
+{
+    if (!PhaseManager::getInstance()->getContactForcesSolved())
+        return false;
+
+    // the solved forces only matter to the physics violation, contact invariant and torque costs,
+    // which are evaluated from phase 3 with a positive weight
+    if (PhaseManager::getInstance()->getPhase() < 3)
+        return false;
+    const PlanningParameters* parameters = PlanningParameters::getInstance();
+    return parameters->getPhysicsViolationCostWeight() > 0.0 || parameters->getContactInvariantCostWeight() > 0.0
+           || parameters->getTorqueCostWeight() > 0.0;
+}
 
-                RigidBodyDynamics::Math::SpatialVector& ext_force = external_forces_[point][rbdl_id];
-                for (int j = 0; j < 3; ++j)
+void NewEvalManager::solveContactForces(int point, const Eigen::VectorXd& q, const Eigen::VectorXd& q_dot, const Eigen::VectorXd& q_ddot)
+{
+    RigidBodyDynamics::Model& model = rbdl_models_[point];
+    std::vector<ContactVariables>& contact_variables = contact_variables_[point];
+    int num_contacts = planning_group_->getNumContacts();
+    int num_contact_points = num_contacts * NUM_ENDEFFECTOR_CONTACT_POINTS;
+    int num_root_joints = root_body_ids_.size();
+
+    const Eigen::Vector3d axes[3] = { Eigen::Vector3d::UnitX(), Eigen::Vector3d::UnitY(), Eigen::Vector3d::UnitZ() };
+    double contact_invariant_weight = PlanningParameters::getInstance()->getContactInvariantCostWeight();
+    double regularization = PlanningParameters::getInstance()->getContactForceSolveRegularization();
+
+    // the root joint torques are linear in the contact point forces : tau_root = tau + A f
+    Eigen::MatrixXd A(num_root_joints, 3 * num_contact_points);
+    Eigen::VectorXd forces(3 * num_contact_points);
+    Eigen::VectorXd point_weights(num_contact_points);
+    std::vector<Eigen::Vector3d> normals(num_contact_points);
+    for (int i = 0; i < num_contacts; ++i)
+    {
+        const Eigen::Matrix3d orientation = exponential_map::ExponentialMapToRotation(contact_variables[i].projected_orientation_);
+        for (int c = 0; c < NUM_ENDEFFECTOR_CONTACT_POINTS; ++c)
+        {
+            int k = i * NUM_ENDEFFECTOR_CONTACT_POINTS + c;
+            const Eigen::Vector3d& point_position = contact_variables[i].projected_point_positions_[c];
+            for (int j = 0; j < 3; ++j)
+            {
+                Eigen::Vector3d contact_torque = point_position.cross(axes[j]);
+                RigidBodyDynamics::Math::SpatialVector unit_force(contact_torque(0), contact_torque(1), contact_torque(2),
+                        axes[j](0), axes[j](1), axes[j](2));
+                for (int r = 0; r < num_root_joints; ++r)
                 {
-                    ext_force(j) = 0.0;
-                    ext_force(j + 3) = 0.0;
+                    unsigned int body_id = root_body_ids_[r];
+                    A(r, 3 * k + j) = model.S[body_id].dot(model.X_base[body_id].applyAdjoint(unit_force));
                 }
+            }
+            forces.segment<3>(3 * k) = contact_variables[i].getPointForce(c);
+            normals[k] = orientation.col(2);
+            point_weights(k) = contact_invariant_weight * getContactInvariantError(i, c, model, *planning_group_, contact_variables)
+                               + regularization;
+        }
+    }
 
-                // force to X-axis direction
-                ext_force(3) = force_on_hand;
+    Eigen::VectorXd tau(num_root_joints);
+    for (int r = 0; r < num_root_joints; ++r)
+        tau(r) = joint_torques_[point](model.mJoints[root_body_ids_[r]].q_index);
+    tau -= A * forces;
+
+    contact_force_solver_.solve(A, tau, PlanningParameters::getInstance()->getPhysicsViolationCostWeight(), point_weights, normals,
+                                PlanningParameters::getInstance()->getFrictionCoefficient(),
+                                PlanningParameters::getInstance()->getContactForceSolveMaxIterations(), forces);
+
+    for (int i = 0; i < num_contacts; ++i)
+    {
+        for (int c = 0; c < NUM_ENDEFFECTOR_CONTACT_POINTS; ++c)
+        {
+            int k = i * NUM_ENDEFFECTOR_CONTACT_POINTS + c;
+            int rbdl_point_id = planning_group_->contact_points_[i].getContactPointRBDLIds(c);
+
+            Eigen::Vector3d contact_force = forces.segment<3>(3 * k);
+            contact_variables[i].setPointForce(c, contact_force);
+
+            Eigen::Vector3d contact_torque = contact_variables[i].projected_point_positions_[c].cross(contact_force);
+
+            RigidBodyDynamics::Math::SpatialVector& ext_force = external_forces_[point][rbdl_point_id];
+            for (int j = 0; j < 3; ++j)
+            {
+                ext_force(j) = contact_torque(j);
+                ext_force(j + 3) = contact_force(j);
             }
+        }
+    }
 
-            // passive forces
-            std::vector<double> passive_forces(num_joints + 1, 0.0);
-            computePassiveForces(point, q, q_dot, passive_forces);
+    // torques with the solved forces. the kinematics is not changed
+    if (getDynamicsFidelity() != DYNAMICS_FIDELITY_FULL)
+        computeRootJointTorques(model, root_momentum_rates_[point], &external_forces_[point], &passive_forces_,
+                                root_body_ids_, joint_torques_[point]);
+    else
+        updatePartialDynamics(model, q, q_dot, q_ddot, joint_torques_[point], &external_forces_[point], &passive_forces_);
+}
 
-            updatePartialDynamics(rbdl_models_[point], q, q_dot, q_ddot, joint_torques_[point], &external_forces_[point], &passive_forces);
+void NewEvalManager::restoreRBDLModel(int point)
+{
+    RigidBodyDynamics::Model& model = rbdl_models_[point];
+    const RigidBodyDynamics::Model& ref_model = reference_manager_->rbdl_models_[point];
+
+    switch (rbdl_model_states_[point])
+    {
+    case RBDL_MODEL_STATE_FORCES_MODIFIED:
+        model.f = ref_model.f;
+        break;
+
+    case RBDL_MODEL_STATE_SUBTREE_MODIFIED:
+    {
+        // kinematics changed in the subtree, forces also along the ancestor chain
+        const ItompRobotJoint& joint = *rbdl_model_modified_joints_[point];
+        const std::vector<unsigned int>& body_ids = joint.rbdl_affected_body_ids_;
+        for (unsigned int k = 0; k < body_ids.size(); ++k)
+        {
+            unsigned int i = body_ids[k];
+            model.f[i] = ref_model.f[i];
+            model.X_lambda[i] = ref_model.X_lambda[i];
+            model.X_base[i] = ref_model.X_base[i];
+            model.v[i] = ref_model.v[i];
+            model.a[i] = ref_model.a[i];
+            model.c[i] = ref_model.c[i];
         }
-        else
+        for (unsigned int k = 0; k < joint.rbdl_ancestor_body_ids_.size(); ++k)
+            model.f[joint.rbdl_ancestor_body_ids_[k]] = ref_model.f[joint.rbdl_ancestor_body_ids_[k]];
+    }
+    break;
+
+    default:
+        model.f = ref_model.f;
+        model.X_lambda = ref_model.X_lambda;
+        model.X_base = ref_model.X_base;
+        model.v = ref_model.v;
+        model.a = ref_model.a;
+        model.c = ref_model.c;
+        break;
+    }
+}
+
+void NewEvalManager::invalidateRBDLModelStates()
+{
+    for (int i = 0; i < rbdl_model_states_.size(); ++i)
+    {
+        rbdl_model_states_[i] = RBDL_MODEL_STATE_STALE;
+        rbdl_model_modified_joints_[i] = NULL;
+    }
+}
+
+void NewEvalManager::initializeRootBodyIds()
+{
+    // the unactuated root is a floating joint, which rbdl splits into 6 1-dof joints between massless virtual bodies,
+    // or a chain of 6 1-dof virtual joints between massless dummy links (base_prismatic_joint_x, ...).
+    // either way it hangs from the rbdl root, and only the last body of the chain has a mass
+    const RigidBodyDynamics::Model& model = robot_model_->getRBDLRobotModel();
+
+    root_body_ids_.clear();
+    unsigned int body = 0;
+    while (root_body_ids_.size() < 6)
+    {
+        if (model.mu[body].size() != 1 || (body != 0 && model.mBodies[body].mMass != 0.0))
+            break;
+        body = model.mu[body][0];
+        if (model.mJoints[body].mDoFCount != 1)
+            break;
+        root_body_ids_.push_back(body);
+    }
+
+    if (root_body_ids_.size() != 6)
+    {
+        ROS_INFO("The model has no floating root joint. Root wrench evaluation is disabled.");
+        root_body_ids_.clear();
+    }
+}
+
+int NewEvalManager::getDynamicsFidelity() const
+{
+    if (root_body_ids_.empty())
+        return DYNAMICS_FIDELITY_FULL;
+
+    // the torque cost needs the torques of all joints. it is active from phase 3 with a positive weight
+    unsigned int phase = PhaseManager::getInstance()->getPhase();
+    if (phase >= 3 && PlanningParameters::getInstance()->getTorqueCostWeight() > 0.0)
+        return DYNAMICS_FIDELITY_FULL;
+
+    // otherwise only the root torques are used, which the root wrench gives exactly
+    return PlanningParameters::getInstance()->getDynamicsFidelity(phase, DYNAMICS_FIDELITY_ROOT_WRENCH);
+}
+
+void NewEvalManager::compareDynamicsFidelities(int num_trials)
+{
+    if (root_body_ids_.empty())
+        return;
+
+    int num_points = itomp_trajectory_->getNumPoints();
+    int num_joints = itomp_trajectory_->getNumJoints();
+
+    // external forces of the current trajectory
+    performFullForwardKinematicsAndDynamics(0, num_points);
+
+    const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+    const ElementTrajectoryPtr& vel_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_VELOCITY,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+    const ElementTrajectoryPtr& acc_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_ACCELERATION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+
+    const char* fidelity_names[DYNAMICS_FIDELITY_NUM] = { "full", "root_wrench", "centroidal" };
+
+    RigidBodyDynamics::Model model = robot_model_->getRBDLRobotModel();
+    std::vector<Eigen::VectorXd> rnea_torques(num_points, Eigen::VectorXd(num_joints));
+    Eigen::VectorXd torques(num_joints);
+    RigidBodyDynamics::Math::SpatialVector momentum_rate;
+    for (int fidelity = 0; fidelity < DYNAMICS_FIDELITY_NUM; ++fidelity)
+    {
+        double max_error = 0.0;
+        int max_error_point = 0;
+
+        ros::WallTime start_time = ros::WallTime::now();
+        for (int trial = 0; trial < num_trials; ++trial)
         {
-            contact_variables_[point] = ref_evaluation_manager_->contact_variables_[point];
-            joint_torques_[point] = ref_evaluation_manager_->joint_torques_[point];
-            external_forces_[point] = ref_evaluation_manager_->external_forces_[point];
+            for (int point = 0; point < num_points; ++point)
+            {
+                const Eigen::VectorXd& q = pos_trajectory->getTrajectoryPoint(point);
+                const Eigen::VectorXd& q_dot = vel_trajectory->getTrajectoryPoint(point);
+                const Eigen::VectorXd& q_ddot = acc_trajectory->getTrajectoryPoint(point);
 
-            // passive forces
-            std::vector<double> passive_forces(num_joints + 1, 0.0);
-            computePassiveForces(point, q, q_dot, passive_forces);
+                computePassiveForces(point, q, q_dot, passive_forces_);
 
-            updatePartialKinematicsAndDynamics(rbdl_models_[point], q, q_dot,
-                                               q_ddot, joint_torques_[point], &external_forces_[point], &passive_forces,
-                                               planning_group_->group_joints_[itomp_trajectory_->getParameterJointIndex(index.element)].rbdl_affected_body_ids_);
+                switch (fidelity)
+                {
+                case DYNAMICS_FIDELITY_FULL:
+                    updateFullKinematicsAndDynamics(model, q, q_dot, q_ddot, rnea_torques[point], &external_forces_[point], &passive_forces_);
+                    torques = rnea_torques[point];
+                    break;
+
+                case DYNAMICS_FIDELITY_ROOT_WRENCH:
+                    updateFullKinematicsAndMomentumRates(model, q, q_dot, q_ddot, momentum_rate);
+                    computeRootJointTorques(model, momentum_rate, &external_forces_[point], &passive_forces_, root_body_ids_, torques);
+                    break;
+
+                case DYNAMICS_FIDELITY_CENTROIDAL:
+                    updateFullKinematicsAndCentroidalMomentumRate(model, q, q_dot, q_ddot, momentum_rate, root_body_ids_);
+                    computeRootJointTorques(model, momentum_rate, &external_forces_[point], &passive_forces_, root_body_ids_, torques);
+                    break;
+                }
 
+                double error = (rnea_torques[point].head(6) - torques.head(6)).cwiseAbs().maxCoeff();
+                if (error > max_error)
+                {
+                    max_error = error;
+                    max_error_point = point;
+                }
+            }
         }
+        double elapsed = (ros::WallTime::now() - start_time).toSec();
+
+        ROS_INFO("Dynamics fidelity %s : %f points/sec, max root torque difference to RNEA %e (point %d)",
+                 fidelity_names[fidelity], num_trials * num_points / std::max(elapsed, 1e-9), max_error, max_error_point);
     }
+}
 
-    TIME_PROFILER_END_TIMER(FK);
+void NewEvalManager::updateSweptBroadphase(int point_begin, int point_end, bool force)
+{
+    int window_size = PlanningParameters::getInstance()->getBroadphaseWindowSize();
+
+    // the obstacle cost checks only the end points in phase 0
+    if (window_size <= 1 || (!force && (PlanningParameters::getInstance()->getObstacleCostWeight() <= 0.0
+                                        || PhaseManager::getInstance()->getPhase() == 0)))
+    {
+        collision_world_derivatives_->clearSweptBroadphase();
+        return;
+    }
+
+    const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+
+    std::vector<fcl::AABB> swept_aabbs, aabbs;
+    for (int window_begin = point_begin; window_begin < point_end; window_begin += window_size)
+    {
+        int window_end = std::min(window_begin + window_size, point_end);
+
+        swept_aabbs.clear();
+        for (int point = window_begin; point < window_end; ++point)
+        {
+            const Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+            robot_state_[point]->setVariablePositions(q.data());
+            robot_state_[point]->updateCollisionBodyTransforms();
+
+            collision_robot_derivatives_->computeInternalFCLObjectAABBs(*robot_state_[point], aabbs);
+            if (swept_aabbs.empty())
+                swept_aabbs = aabbs;
+            else
+            {
+                for (int i = 0; i < aabbs.size(); ++i)
+                    swept_aabbs[i] += aabbs[i];
+            }
+        }
+
+        collision_world_derivatives_->updateSweptBroadphase(window_begin, window_end, swept_aabbs);
+    }
+}
+
+void NewEvalManager::benchmarkSweptBroadphase(int num_trials)
+{
+    if (PlanningParameters::getInstance()->getBroadphaseWindowSize() <= 1)
+    {
+        ROS_INFO("Swept broadphase benchmark skipped : broadphase_window_size should be larger than 1");
+        return;
+    }
+
+    int num_points = itomp_trajectory_->getNumPoints();
+    const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+
+    const collision_detection::CollisionRequest collision_request = TrajectoryCostObstacle::getCollisionRequest();
+    collision_detection::CollisionResult collision_result;
+
+    double elapsed[2];
+    unsigned int num_contacts[2];
+    for (int swept = 0; swept < 2; ++swept)
+    {
+        num_contacts[swept] = 0;
+        ros::WallTime start_time = ros::WallTime::now();
+        for (int trial = 0; trial < num_trials; ++trial)
+        {
+            if (swept)
+                updateSweptBroadphase(0, num_points, true);
+            else
+                collision_world_derivatives_->clearSweptBroadphase();
+
+            for (int point = 0; point < num_points; ++point)
+            {
+                const Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+                robot_state_[point]->setVariablePositions(q.data());
+                robot_state_[point]->updateCollisionBodyTransforms();
+                collision_robot_derivatives_->updateInternalFCLObjectTransforms(*robot_state_[point]);
+
+                collision_result.clear();
+                collision_world_derivatives_->checkRobotCollision(collision_request, collision_result,
+                        *collision_robot_derivatives_, *robot_state_[point], planning_scene_->getAllowedCollisionMatrix(), point);
+                num_contacts[swept] += collision_result.contact_count;
+            }
+        }
+        elapsed[swept] = (ros::WallTime::now() - start_time).toSec();
+    }
+    collision_world_derivatives_->clearSweptBroadphase();
+
+    ROS_INFO("Obstacle queries of %d points x %d trials : per-point broadphase %f sec (%u contacts), swept broadphase (window %d) %f sec (%u contacts)",
+             num_points, num_trials, elapsed[0], num_contacts[0], PlanningParameters::getInstance()->getBroadphaseWindowSize(),
+             elapsed[1], num_contacts[1]);
+}
+
+void NewEvalManager::benchmarkConvexDecompositions(int num_trials)
+{
+    int num_points = itomp_trajectory_->getNumPoints();
+    const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+
+    CollisionRobotFCLDerivatives collision_robot(dynamic_cast<const collision_detection::CollisionRobotFCL&>(*planning_scene_->getCollisionRobotUnpadded()));
+    collision_robot.constructInternalFCLObject(planning_scene_->getCurrentState());
+
+    const collision_detection::CollisionRequest collision_request = TrajectoryCostObstacle::getCollisionRequest();
+    collision_detection::CollisionResult collision_result;
+
+    double elapsed[2];
+    double roughness[2];
+    for (int convex = 0; convex < 2; ++convex)
+    {
+        const collision_detection::WorldPtr world(new collision_detection::World(*planning_scene_->getWorld()));
+        CollisionWorldFCLDerivatives collision_world(dynamic_cast<const collision_detection::CollisionWorldFCL&>(*planning_scene_->getCollisionWorld()), world);
+        if (convex)
+            collision_world.applyConvexDecompositions(convex_decompositions_);
+
+        // penetration depth sum of each point
+        std::vector<double> depths(num_points, 0.0);
+        ros::WallTime start_time = ros::WallTime::now();
+        for (int trial = 0; trial < num_trials; ++trial)
+        {
+            for (int point = 0; point < num_points; ++point)
+            {
+                const Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+                robot_state_[point]->setVariablePositions(q.data());
+                robot_state_[point]->updateCollisionBodyTransforms();
+                collision_robot.updateInternalFCLObjectTransforms(*robot_state_[point]);
+
+                collision_result.clear();
+                collision_world.checkRobotCollision(collision_request, collision_result,
+                                                    collision_robot, *robot_state_[point], planning_scene_->getAllowedCollisionMatrix());
+
+                depths[point] = 0.0;
+                for (collision_detection::CollisionResult::ContactMap::const_iterator it = collision_result.contacts.begin(); it != collision_result.contacts.end(); ++it)
+                    for (unsigned int k = 0; k < it->second.size(); ++k)
+                        depths[point] += it->second[k].depth;
+            }
+        }
+        elapsed[convex] = (ros::WallTime::now() - start_time).toSec();
+
+        // smoothness of the depths along the trajectory : sum of squared second differences
+        roughness[convex] = 0.0;
+        for (int point = 1; point < num_points - 1; ++point)
+        {
+            double d = depths[point + 1] - 2.0 * depths[point] + depths[point - 1];
+            roughness[convex] += d * d;
+        }
+    }
+
+    ROS_INFO("Obstacle queries of %d points x %d trials : meshes %f sec (depth roughness %f), convex pieces %f sec (depth roughness %f)",
+             num_points, num_trials, elapsed[0], roughness[0], elapsed[1], roughness[1]);
+}
+
+void NewEvalManager::benchmarkGJKWarmStart(int num_trials)
+{
+    int num_points = itomp_trajectory_->getNumPoints();
+    const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+
+    const collision_detection::CollisionRequest collision_request = TrajectoryCostObstacle::getCollisionRequest();
+    collision_detection::CollisionResult collision_result;
+
+    double elapsed[2];
+    unsigned int num_queries = 0, num_hits = 0;
+    for (int warm_start = 0; warm_start < 2; ++warm_start)
+    {
+        collision_world_derivatives_->initializeGJKWarmStart(warm_start ? num_points : 0);
+        collision_robot_derivatives_->initializeGJKWarmStart(warm_start ? num_points : 0);
+        collision_world_derivatives_->resetGJKWarmStartStatistics();
+        collision_world_derivatives_->clearSweptBroadphase();
+
+        ros::WallTime start_time = ros::WallTime::now();
+        for (int trial = 0; trial < num_trials; ++trial)
+        {
+            for (int point = 0; point < num_points; ++point)
+            {
+                const Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+                robot_state_[point]->setVariablePositions(q.data());
+                robot_state_[point]->updateCollisionBodyTransforms();
+                collision_robot_derivatives_->updateInternalFCLObjectTransforms(*robot_state_[point]);
+
+                collision_result.clear();
+                collision_world_derivatives_->checkRobotCollision(collision_request, collision_result,
+                        *collision_robot_derivatives_, *robot_state_[point], planning_scene_->getAllowedCollisionMatrix(), point);
+                collision_result.clear();
+                collision_robot_derivatives_->checkSelfCollision(collision_request, collision_result,
+                        *robot_state_[point], planning_scene_->getAllowedCollisionMatrix(), point);
+            }
+        }
+        elapsed[warm_start] = (ros::WallTime::now() - start_time).toSec();
+    }
+    collision_world_derivatives_->getGJKWarmStartStatistics(num_queries, num_hits);
+
+    int num_caches = PlanningParameters::getInstance()->getGJKWarmStart() ? num_points : 0;
+    collision_world_derivatives_->initializeGJKWarmStart(num_caches);
+    collision_robot_derivatives_->initializeGJKWarmStart(num_caches);
+    collision_world_derivatives_->resetGJKWarmStartStatistics();
+
+    ROS_INFO("Collision queries of %d points x %d trials : cold GJK %f sec, warm-started GJK %f sec (%u world GJK queries, %.1f%% warm-started)",
+             num_points, num_trials, elapsed[0], elapsed[1], num_queries, num_queries == 0 ? 0.0 : 100.0 * num_hits / num_queries);
+}
+
+bool NewEvalManager::updateBatchedObstacleQueries(int point_begin, int point_end, bool force)
+{
+    invalidateBatchedObstacleQueries(point_begin, point_end);
+
+    // the obstacle cost checks only the end points in phase 0
+    if (!force && (!PlanningParameters::getInstance()->getBatchedObstacleQueries()
+                   || PlanningParameters::getInstance()->getObstacleCostWeight() <= 0.0
+                   || PhaseManager::getInstance()->getPhase() == 0))
+        return false;
+
+    const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+
+    const collision_detection::CollisionRequest collision_request = TrajectoryCostObstacle::getCollisionRequest();
+
+    // transforms of each robot collision object over the points
+    int num_poses = point_end - point_begin;
+    int num_objects = collision_robot_derivatives_->getInternalFCLCollisionObjects().size();
+    std::vector<std::vector<fcl::Transform3f> > object_transforms(num_objects, std::vector<fcl::Transform3f>(num_poses));
+    std::vector<fcl::Transform3f> transforms;
+    for (int point = point_begin; point < point_end; ++point)
+    {
+        const Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+        robot_state_[point]->setVariablePositions(q.data());
+        robot_state_[point]->updateCollisionBodyTransforms();
+
+        collision_robot_derivatives_->computeInternalFCLObjectTransforms(*robot_state_[point], transforms);
+        for (int i = 0; i < num_objects; ++i)
+            object_transforms[i][point - point_begin] = transforms[i];
+    }
+
+    std::vector<collision_detection::CollisionResult> results(num_poses);
+    for (int i = 0; i < num_objects; ++i)
+        collision_world_derivatives_->checkRobotCollisionBatch(collision_request, results, *collision_robot_derivatives_, i,
+                object_transforms[i], planning_scene_->getAllowedCollisionMatrix());
+
+    for (int point = point_begin; point < point_end; ++point)
+    {
+        collision_detection::CollisionResult& result = batched_obstacle_results_[point];
+        result.clear();
+        result.collision = results[point - point_begin].collision;
+        result.contact_count = results[point - point_begin].contact_count;
+        result.contacts.swap(results[point - point_begin].contacts);
+        batched_obstacle_result_valid_[point] = 1;
+    }
+
+    return true;
+}
+
+void NewEvalManager::invalidateBatchedObstacleQueries(int point_begin, int point_end)
+{
+    std::fill(batched_obstacle_result_valid_.begin() + point_begin, batched_obstacle_result_valid_.begin() + point_end, 0);
+}
+
+void NewEvalManager::benchmarkBatchedObstacleQueries(int num_trials)
+{
+    int num_points = itomp_trajectory_->getNumPoints();
+    const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+
+    const collision_detection::CollisionRequest collision_request = TrajectoryCostObstacle::getCollisionRequest();
+    collision_detection::CollisionResult collision_result;
+
+    collision_world_derivatives_->clearSweptBroadphase();
+
+    double elapsed[2];
+    unsigned int num_contacts[2];
+    for (int batched = 0; batched < 2; ++batched)
+    {
+        num_contacts[batched] = 0;
+        ros::WallTime start_time = ros::WallTime::now();
+        for (int trial = 0; trial < num_trials; ++trial)
+        {
+            if (batched)
+            {
+                updateBatchedObstacleQueries(0, num_points, true);
+                for (int point = 0; point < num_points; ++point)
+                    num_contacts[batched] += batched_obstacle_results_[point].contact_count;
+                continue;
+            }
+
+            for (int point = 0; point < num_points; ++point)
+            {
+                const Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+                robot_state_[point]->setVariablePositions(q.data());
+                robot_state_[point]->updateCollisionBodyTransforms();
+                collision_robot_derivatives_->updateInternalFCLObjectTransforms(*robot_state_[point]);
+
+                collision_result.clear();
+                collision_world_derivatives_->checkRobotCollision(collision_request, collision_result,
+                        *collision_robot_derivatives_, *robot_state_[point], planning_scene_->getAllowedCollisionMatrix(), point);
+                num_contacts[batched] += collision_result.contact_count;
+            }
+        }
+        elapsed[batched] = (ros::WallTime::now() - start_time).toSec();
+    }
+    invalidateBatchedObstacleQueries(0, num_points);
+
+    ROS_INFO("Obstacle queries of %d points x %d trials : per-point %f sec (%u contacts), batched over the points %f sec (%u contacts)",
+             num_points, num_trials, elapsed[0], num_contacts[0], elapsed[1], num_contacts[1]);
+}
+
+void NewEvalManager::adaptDiscretization()
+{
+    const PlanningParameters* parameters = PlanningParameters::getInstance();
+    int num_points = itomp_trajectory_->getNumPoints();
+    int num_contacts = planning_group_->getNumContacts();
+    int keyframe_interval = std::max((int)itomp_trajectory_->getKeyframeInterval(), 1);
+
+    // contact activations of all points
+    resetDiscretization();
+    double uniform_cost = evaluate();
+
+    const ElementTrajectoryPtr& acc_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_ACCELERATION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+    std::vector<double> accelerations(num_points);
+    double mean_acceleration = 0.0;
+    for (int point = 0; point < num_points; ++point)
+    {
+        accelerations[point] = acc_trajectory->getTrajectoryPoint(point).norm();
+        mean_acceleration += accelerations[point];
+    }
+    mean_acceleration /= num_points;
+
+    // the start, goal and keyframe points keep every parameter evaluated
+    std::vector<char> is_evaluated(num_points, 0);
+    for (int point = 0; point < num_points; ++point)
+    {
+        is_evaluated[point] = (point % keyframe_interval == 0 || point == num_points - 1 ||
+                               accelerations[point] > parameters->getAdaptiveDiscretizationAccelerationRatio() * mean_acceleration);
+    }
+    for (int point = 1; point < num_points; ++point)
+    {
+        double contact_change = 0.0;
+        for (int i = 0; i < num_contacts; ++i)
+        {
+            for (int j = 0; j < NUM_ENDEFFECTOR_CONTACT_POINTS; ++j)
+            {
+                contact_change = std::max(contact_change, std::abs(getContactActiveValue(i, j, contact_variables_[point]) -
+                                          getContactActiveValue(i, j, contact_variables_[point - 1])));
+            }
+        }
+        if (contact_change > parameters->getAdaptiveDiscretizationContactChange())
+            is_evaluated[point - 1] = is_evaluated[point] = 1;
+    }
+
+    // each evaluated point stands for the half of the skipped points to its evaluated neighbors,
+    // except for the start and goal points which are not integrated
+    point_weights_.assign(num_points, 0.0);
+    point_weights_[0] = 1.0;
+    int num_evaluated_points = 1;
+    int previous_point = 0;
+    for (int point = 1; point < num_points; ++point)
+    {
+        if (!is_evaluated[point])
+            continue;
+
+        int num_skipped_points = point - previous_point - 1;
+        point_weights_[point] = 1.0;
+        if (previous_point == 0)
+            point_weights_[point] += num_skipped_points;
+        else if (point == num_points - 1)
+            point_weights_[previous_point] += num_skipped_points;
+        else
+        {
+            point_weights_[previous_point] += 0.5 * num_skipped_points;
+            point_weights_[point] += 0.5 * num_skipped_points;
+        }
+
+        previous_point = point;
+        ++num_evaluated_points;
+    }
+
+    double adaptive_cost = evaluate();
+    ROS_INFO("Phase %d adaptive discretization : %d of %d points evaluated, cost %f (uniform %f)",
+             PhaseManager::getInstance()->getPhase(), num_evaluated_points, num_points, adaptive_cost, uniform_cost);
+
+    if (parameters->getAdaptiveDiscretizationBenchmarkNumTrials() > 0)
+        benchmarkAdaptiveDiscretization(parameters->getAdaptiveDiscretizationBenchmarkNumTrials());
+}
+
+void NewEvalManager::resetDiscretization()
+{
+    point_weights_.assign(itomp_trajectory_->getNumPoints(), 1.0);
+}
+
+void NewEvalManager::benchmarkAdaptiveDiscretization(int num_trials)
+{
+    const std::vector<double> point_weights = point_weights_;
+
+    double elapsed[2];
+    double cost[2];
+    for (int adaptive = 0; adaptive < 2; ++adaptive)
+    {
+        if (adaptive)
+            point_weights_ = point_weights;
+        else
+            resetDiscretization();
+
+        ros::WallTime start_time = ros::WallTime::now();
+        for (int trial = 0; trial < num_trials; ++trial)
+            cost[adaptive] = evaluate();
+        elapsed[adaptive] = (ros::WallTime::now() - start_time).toSec();
+    }
+
+    ROS_INFO("Evaluations of %d trials : uniform %f per sec (cost %f), adaptive %f per sec (cost %f, %f%% difference)",
+             num_trials, num_trials / elapsed[0], cost[0], num_trials / elapsed[1], cost[1],
+             cost[0] == 0.0 ? 0.0 : 100.0 * (cost[1] - cost[0]) / cost[0]);
+}
+
+void NewEvalManager::setAsReference()
+{
+    reference_manager_ = this;
+}
+
+void NewEvalManager::setEvaluationRange(int point_begin, int point_end)
+{
+    evaluation_point_begin_ = point_begin;
+    evaluation_point_end_ = point_end;
 }
 
 void NewEvalManager::getParameters(ItompTrajectory::ParameterVector& parameters) const
@@ -622,7 +1544,8 @@ void NewEvalManager::getParameters(ItompTrajectory::ParameterVector& parameters)
 void NewEvalManager::setParameters(const ItompTrajectory::ParameterVector& parameters)
 {
     itomp_trajectory_->setParameters(parameters, planning_group_);
-    //itomp_trajectory_->avoidNeighbors(trajectory_constraints_);
+    invalidateRBDLModelStates();
+    invalidateBatchedObstacleQueries(0, batched_obstacle_result_valid_.size());
 }
 
 void NewEvalManager::printTrajectoryCost(int iteration, bool details)
@@ -699,95 +1622,141 @@ void NewEvalManager::printTrajectoryCost(int iteration, bool details)
 
 void NewEvalManager::initializeContactVariables()
 {
+    ros::WallTime start_time = ros::WallTime::now();
+
 	int num_contacts = planning_group_->getNumContacts();
+    int num_points = itomp_trajectory_->getNumPoints();
     ROS_ASSERT(num_contacts == PlanningParameters::getInstance()->getNumContacts());
 
 	// allocate
-    contact_variables_.resize(itomp_trajectory_->getNumPoints());
+    contact_variables_.resize(num_points);
 	for (int i = 0; i < contact_variables_.size(); ++i)
 	{
 		contact_variables_[i].resize(num_contacts);
 	}
 
-    for (int point = 0; point < itomp_trajectory_->getNumPoints(); ++point)
-	{
-        Eigen::VectorXd q = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
-                                   ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getTrajectoryPoint(point);
+    // every point owns its rbdl model, so the points can be processed by different threads.
+    // each stage writes only to the slots of its own point (or point/end-effector pair),
+    // so the result does not depend on the thread scheduling.
+    const ElementTrajectoryPtr& pos_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+    const ElementTrajectoryPtr& vel_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_VELOCITY,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
+    const ElementTrajectoryPtr& acc_trajectory = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_ACCELERATION,
+            ItompTrajectory::SUB_COMPONENT_TYPE_JOINT);
 
-        const Eigen::VectorXd& q_dot = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_VELOCITY,
-                                       ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getTrajectoryPoint(point);
+    std::vector<Eigen::VectorXd> taus(num_points);
 
-        const Eigen::VectorXd& q_ddot = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_ACCELERATION,
-                                        ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getTrajectoryPoint(point);
+    // stage 1 : forward kinematics and dynamics of all points
+    #pragma omp parallel for
+    for (int point = 0; point < num_points; ++point)
+    {
+        Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+        Eigen::VectorXd q_dot = vel_trajectory->getTrajectoryPoint(point);
+        Eigen::VectorXd q_ddot = acc_trajectory->getTrajectoryPoint(point);
 
-		Eigen::VectorXd tau(q.rows());
+        taus[point].resize(q.rows());
+        updateFullKinematicsAndDynamics(rbdl_models_[point], q, q_dot, q_ddot, taus[point], NULL, NULL);
+    }
 
-        updateFullKinematicsAndDynamics(rbdl_models_[point], q, q_dot, q_ddot, tau, NULL, NULL);
+    // stage 2 : IK targets of the toes at the start and goal keyframes, one task per (keyframe, end-effector)
+    std::vector<int> ik_points;
+    ik_points.push_back(0);
+    if (num_points > 1)
+        ik_points.push_back(num_points - 1);
 
-		std::vector<RigidBodyDynamics::Math::SpatialVector> ext_forces;
-        ext_forces.resize(rbdl_models_[point].mBodies.size(), RigidBodyDynamics::Math::SpatialVectorZero);
+    const int first_ik_contact = 2;
+    int num_ik_points = ik_points.size();
+    int num_ik_contacts = std::max(num_contacts - first_ik_contact, 0);
+    int num_ik_tasks = num_ik_points * num_ik_contacts;
 
-        if (point == 0 || point == itomp_trajectory_->getNumPoints() - 1)
-        {
-            std::vector<unsigned int> body_ids;
-            std::vector<RigidBodyDynamics::Math::Vector3d> target_positions;
-            std::vector<RigidBodyDynamics::Math::Matrix3d> target_orientations;
+    if (PlanningParameters::getInstance()->getIKBenchmarkNumSolves() > 0 && num_ik_contacts > 0)
+    {
+        std::vector<unsigned int> body_ids;
+        for (int i = first_ik_contact; i < num_contacts; ++i)
+            body_ids.push_back(planning_group_->contact_points_[i].getRBDLBodyId());
+        BenchmarkInverseKinematics6D(rbdl_models_[0], pos_trajectory->getTrajectoryPoint(0).transpose(), body_ids,
+                                     PlanningParameters::getInstance()->getIKBenchmarkNumSolves());
+    }
 
-            // IK toe
-            for (int i = 2; i < num_contacts; ++i)
-            {
-                int rbdl_body_id = planning_group_->contact_points_[i].getRBDLBodyId();
+    std::vector<unsigned int> ik_body_ids(num_ik_tasks);
+    std::vector<RigidBodyDynamics::Math::Vector3d> ik_target_positions(num_ik_tasks);
+    std::vector<RigidBodyDynamics::Math::Matrix3d> ik_target_orientations(num_ik_tasks);
 
-                Eigen::Vector3d contact_normal, proj_position, proj_orientation;
-                GroundManager::getInstance()->getNearestContactPosition(rbdl_models_[point].X_base[rbdl_body_id].r, exponential_map::RotationToExponentialMap(rbdl_models_[point].X_base[rbdl_body_id].E),
-                        proj_position, proj_orientation, contact_normal);
-
-                proj_position(0) = rbdl_models_[point].X_base[rbdl_body_id].r(0);
-                proj_position(1) = rbdl_models_[point].X_base[rbdl_body_id].r(1);
-
-                /*
-                const Eigen::Vector3d position_bias(-0.2, 0.0, 0.0);
-                proj_position += position_bias;
-                */
-
-                body_ids.push_back(rbdl_body_id);
-                RigidBodyDynamics::Math::Vector3d target_pos(proj_position);
-                target_positions.push_back(target_pos);
-                RigidBodyDynamics::Math::Matrix3d target_orientation = exponential_map::ExponentialMapToRotation(proj_orientation);
-                target_orientations.push_back(target_orientation);
-
-                cout << "body id: " << rbdl_body_id << endl
-                     << "original position:" << endl
-                     << rbdl_models_[point].X_base[rbdl_body_id].r << endl
-                     << "origianl orientation:" << endl
-                     << rbdl_models_[point].X_base[rbdl_body_id].E << endl
-                     << "target position:" << endl
-                     << target_pos << endl
-                     << "target orientation:" << endl
-                     << target_orientation << endl
-                     << "axis:" << endl
-                     << rbdl_models_[point].S[rbdl_body_id] << endl
-                     << endl;
-            }
+    #pragma omp parallel for
+    for (int task = 0; task < num_ik_tasks; ++task)
+    {
+        int point = ik_points[task / num_ik_contacts];
+        int i = first_ik_contact + task % num_ik_contacts;
 
-            // IK hands
-            const int hand_body_ids[] = {
-                rbdl_models_[point]->GetBodyId("lwrist"),
-                rbdl_models_[point]->GetBodyId("rwrist"),
-            };
-            for (int i=0; i<2; i++)
-            {
-            }
+        int rbdl_body_id = planning_group_->contact_points_[i].getRBDLBodyId();
+        const RigidBodyDynamics::Math::SpatialTransform& body_transform = rbdl_models_[point].X_base[rbdl_body_id];
 
-            if (itomp_cio_planner::InverseKinematics6D(rbdl_models_[point], q, body_ids, target_positions, target_orientations, q))
+        Eigen::Vector3d contact_normal, proj_position, proj_orientation;
+        GroundManager::getInstance()->getNearestContactPosition(body_transform.r, exponential_map::RotationToExponentialMap(body_transform.E),
+                proj_position, proj_orientation, contact_normal);
+
+        proj_position(0) = body_transform.r(0);
+        proj_position(1) = body_transform.r(1);
+
+        ik_body_ids[task] = rbdl_body_id;
+        ik_target_positions[task] = proj_position;
+        ik_target_orientations[task] = exponential_map::ExponentialMapToRotation(proj_orientation);
+    }
+
+    // stage 3 : solve the IK of each keyframe for all its end-effectors at once
+    std::vector<int> ik_results(num_ik_points, 1);
+    #pragma omp parallel for
+    for (int k = 0; k < num_ik_points; ++k)
+    {
+        int point = ik_points[k];
+        int task_begin = k * num_ik_contacts;
+        int task_end = task_begin + num_ik_contacts;
+
+        std::vector<unsigned int> body_ids(ik_body_ids.begin() + task_begin, ik_body_ids.begin() + task_end);
+        std::vector<RigidBodyDynamics::Math::Vector3d> target_positions(ik_target_positions.begin() + task_begin, ik_target_positions.begin() + task_end);
+        std::vector<RigidBodyDynamics::Math::Matrix3d> target_orientations(ik_target_orientations.begin() + task_begin, ik_target_orientations.begin() + task_end);
+
+        Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+        InverseKinematicsWorkspace ik_workspace;
+        if (itomp_cio_planner::InverseKinematics6D(rbdl_models_[point], q, body_ids, target_positions, target_orientations, q, ik_workspace))
+        {
+            Eigen::VectorXd q_dot = vel_trajectory->getTrajectoryPoint(point);
+            Eigen::VectorXd q_ddot = acc_trajectory->getTrajectoryPoint(point);
+            updateFullKinematicsAndDynamics(rbdl_models_[point], q, q_dot, q_ddot, taus[point], NULL, NULL);
+            pos_trajectory->getTrajectoryPoint(point) = q;
+        }
+        else
+            ik_results[k] = 0;
+    }
+
+    for (int k = 0; k < num_ik_points; ++k)
+    {
+        if (!ik_results[k])
+            ROS_INFO("IK failed at point %d", ik_points[k]);
+
+        if (PlanningParameters::getInstance()->getPrintPlanningInfo())
+        {
+            for (int task = k * num_ik_contacts; task < (k + 1) * num_ik_contacts; ++task)
             {
-                updateFullKinematicsAndDynamics(rbdl_models_[point], q, q_dot, q_ddot, tau, NULL, NULL);
-                itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
-                                                   ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getTrajectoryPoint(point) = q;
+                const RigidBodyDynamics::Math::Vector3d& target_pos = ik_target_positions[task];
+                ROS_INFO("Point %d body %d IK target : (%f %f %f)", ik_points[k], ik_body_ids[task],
+                         target_pos(0), target_pos(1), target_pos(2));
             }
-            else
-                ROS_INFO("IK failed");
         }
+    }
+
+    // stage 4 : contact positions and (zero) contact forces
+    #pragma omp parallel for
+    for (int point = 0; point < num_points; ++point)
+    {
+        Eigen::VectorXd q = pos_trajectory->getTrajectoryPoint(point);
+        Eigen::VectorXd q_dot = vel_trajectory->getTrajectoryPoint(point);
+        Eigen::VectorXd q_ddot = acc_trajectory->getTrajectoryPoint(point);
+        Eigen::VectorXd& tau = taus[point];
+
+		std::vector<RigidBodyDynamics::Math::SpatialVector> ext_forces;
+        ext_forces.resize(rbdl_models_[point].mBodies.size(), RigidBodyDynamics::Math::SpatialVectorZero);
 
 		for (int i = 0; i < num_contacts; ++i)
 		{
@@ -796,20 +1765,13 @@ void NewEvalManager::initializeContactVariables()
 			contact_variables_[point][i].setVariable(0.0);
             contact_variables_[point][i].setPosition(rbdl_models_[point].X_base[rbdl_body_id].r);
 
-            const Eigen::Vector3d prev_orientation = (point == 0) ? Eigen::Vector3d::Zero() : contact_variables_[point - 1][i].getOrientation();
-            const Eigen::Vector3d* prev_orientation_p = (point == 0) ? NULL : &prev_orientation;
-            contact_variables_[point][i].setOrientation(exponential_map::RotationToExponentialMap(rbdl_models_[point].X_base[rbdl_body_id].E, prev_orientation_p));
-
-
 			for (int j = 0; j < NUM_ENDEFFECTOR_CONTACT_POINTS; ++j)
 			{
-				Eigen::MatrixXd jacobian(6, q.rows());
 				Eigen::Vector3d contact_position;
 				Eigen::Vector3d contact_force;
 				Eigen::Vector3d contact_torque;
 
                 int rbdl_body_id = planning_group_->contact_points_[i].getContactPointRBDLIds(j);
-                RigidBodyDynamics::CalcBodySpatialJacobian(rbdl_models_[point], q, rbdl_body_id, jacobian, false);
 
 				contact_position = rbdl_models_[point].X_base[rbdl_body_id].r;
 				// set forces to 0
@@ -827,16 +1789,26 @@ void NewEvalManager::initializeContactVariables()
 
 		// to validate
         RigidBodyDynamics::InverseDynamics(rbdl_models_[point], q, q_dot, q_ddot, tau, &ext_forces);
+	}
 
-		/*
-		 for (int i = 0; i < rbdl_models_[point].f.size(); ++i)
-		 cout << i << " : " << rbdl_models_[point].f[i].transpose() << endl;
-		 cout << tau.transpose() << endl;
-		 */
+    // stage 5 : contact orientations are unwrapped against the previous point, so this pass stays sequential
+    for (int point = 0; point < num_points; ++point)
+    {
+        for (int i = 0; i < num_contacts; ++i)
+        {
+            int rbdl_body_id = planning_group_->contact_points_[i].getRBDLBodyId();
+
+            const Eigen::Vector3d prev_orientation = (point == 0) ? Eigen::Vector3d::Zero() : contact_variables_[point - 1][i].getOrientation();
+            const Eigen::Vector3d* prev_orientation_p = (point == 0) ? NULL : &prev_orientation;
+            contact_variables_[point][i].setOrientation(exponential_map::RotationToExponentialMap(rbdl_models_[point].X_base[rbdl_body_id].E, prev_orientation_p));
+        }
 
         itomp_trajectory_->setContactVariables(point, contact_variables_[point]);
-	}
+    }
 
+    // reported with the optimization phases, as the phase before phase 0
+    ROS_INFO("Contact initialization : %d points x %d contacts, %f sec", num_points, num_contacts,
+             (ros::WallTime::now() - start_time).toSec());
 
     // check fixed contacts
     planning_group_->is_fixed_.resize(num_contacts, false);
@@ -869,6 +1841,11 @@ void NewEvalManager::correctContacts(bool update_kinematics)
 void NewEvalManager::correctContacts(int point_begin, int point_end, bool update_kinematics)
 {
     int num_contacts = planning_group_->getNumContacts();
+
+    // the IK of neighboring points is warm-started with the correction of the previous point and its final damping
+    InverseKinematicsWorkspace ik_workspace;
+    Eigen::VectorXd prev_correction;
+
     for (int point = std::max(point_begin, 1); point < std::min((unsigned int)point_end, itomp_trajectory_->getNumPoints() - 1); ++point)
     {
         std::vector<unsigned int> body_ids;
@@ -898,12 +1875,16 @@ void NewEvalManager::correctContacts(int point_begin, int point_end, bool update
             target_orientations.push_back(target_orientation);
         }
 
-        Eigen::VectorXd q = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+        Eigen::VectorXd q_original = itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
                                    ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getTrajectoryPoint(point);
+        Eigen::VectorXd q = q_original;
+        if (prev_correction.rows() == q.rows())
+            q += prev_correction;
 
-
-        if (itomp_cio_planner::InverseKinematics6D(rbdl_models_[point], q, body_ids, target_positions, target_orientations, q))
+        if (itomp_cio_planner::InverseKinematics6D(rbdl_models_[point], q, body_ids, target_positions, target_orientations, q, ik_workspace))
         {
+            prev_correction = q - q_original;
+
             // repeat above
             itomp_trajectory_->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
                                                ItompTrajectory::SUB_COMPONENT_TYPE_JOINT)->getTrajectoryPoint(point) = q;
@@ -970,7 +1951,10 @@ void NewEvalManager::correctContacts(int point_begin, int point_end, bool update
             }
         }
         else
+        {
+            prev_correction.resize(0);
             ROS_INFO("IK failed");
+        }
     }
 }
 
@@ -1008,6 +1992,81 @@ void NewEvalManager::printLinkTransforms() const
     trajectory_file.close();
 }
 
+void NewEvalManager::initializeExternalWrenches()
+{
+    external_wrench_body_ids_.clear();
+
+    const std::vector<ExternalWrench>& external_wrenches = PlanningParameters::getInstance()->getExternalWrenches();
+    if (external_wrenches.empty())
+    {
+        external_wrench_values_.resize(0, 0);
+        return;
+    }
+
+    const RigidBodyDynamics::Model& rbdl_model = robot_model_->getRBDLRobotModel();
+    int num_points = itomp_trajectory_->getNumPoints();
+    double discretization = itomp_trajectory_->getDiscretization();
+
+    // resolve body ids. wrenches on the same body are merged
+    std::vector<int> wrench_columns(external_wrenches.size(), -1);
+    for (unsigned int i = 0; i < external_wrenches.size(); ++i)
+    {
+        unsigned int body_id = rbdl_model.GetBodyId(external_wrenches[i].body_name_.c_str());
+        if (body_id == std::numeric_limits<unsigned int>::max())
+        {
+            ROS_ERROR("External wrench body %s does not exist", external_wrenches[i].body_name_.c_str());
+            continue;
+        }
+        // wrenches are in the world frame, so they can be applied to the movable parent
+        while (rbdl_model.IsFixedBodyId(body_id))
+            body_id = rbdl_model.GetParentBodyId(body_id);
+
+        std::vector<unsigned int>::iterator it = std::find(external_wrench_body_ids_.begin(), external_wrench_body_ids_.end(), body_id);
+        wrench_columns[i] = it - external_wrench_body_ids_.begin();
+        if (it == external_wrench_body_ids_.end())
+            external_wrench_body_ids_.push_back(body_id);
+    }
+
+    external_wrench_values_ = Eigen::MatrixXd::Zero(num_points, 6 * external_wrench_body_ids_.size());
+    for (unsigned int i = 0; i < external_wrenches.size(); ++i)
+    {
+        if (wrench_columns[i] < 0)
+            continue;
+
+        const ExternalWrench& external_wrench = external_wrenches[i];
+        double duration = external_wrench.end_time_ - external_wrench.start_time_;
+        for (int point = 0; point < num_points; ++point)
+        {
+            double t = point * discretization;
+            if (t < external_wrench.start_time_ - ITOMP_EPS || t > external_wrench.end_time_ + ITOMP_EPS)
+                continue;
+
+            double ratio = (duration > ITOMP_EPS && duration < std::numeric_limits<double>::max()) ?
+                           std::min(std::max((t - external_wrench.start_time_) / duration, 0.0), 1.0) : 0.0;
+            for (int j = 0; j < 6; ++j)
+                external_wrench_values_(point, 6 * wrench_columns[i] + j) +=
+                    (1.0 - ratio) * external_wrench.wrench_[j] + ratio * external_wrench.end_wrench_[j];
+        }
+    }
+
+    if (PlanningParameters::getInstance()->getPrintPlanningInfo())
+    {
+        for (unsigned int i = 0; i < external_wrench_body_ids_.size(); ++i)
+            ROS_INFO("External wrench on body %s [%d]", rbdl_model.GetBodyName(external_wrench_body_ids_[i]).c_str(),
+                     external_wrench_body_ids_[i]);
+    }
+}
+
+void NewEvalManager::applyExternalWrenches(int point)
+{
+    for (unsigned int i = 0; i < external_wrench_body_ids_.size(); ++i)
+    {
+        RigidBodyDynamics::Math::SpatialVector& ext_force = external_forces_[point][external_wrench_body_ids_[i]];
+        for (int j = 0; j < 6; ++j)
+            ext_force(j) = external_wrench_values_(point, 6 * i + j);
+    }
+}
+
 void NewEvalManager::computePassiveForces(int point,
                                           const RigidBodyDynamics::Math::VectorNd &q,
                                           const RigidBodyDynamics::Math::VectorNd &q_dot,
@@ -0,0 +1,137 @@
+#include <itomp_cio_planner/optimization/phase_convergence_monitor.h>
+#include <itomp_cio_planner/optimization/phase_manager.h>
+#include <itomp_cio_planner/optimization/augmented_lagrangian.h>
+#include <itomp_cio_planner/util/planning_parameters.h>
+
+namespace itomp_cio_planner
+{
+
+// relative cost decrease of costs close to zero
+const double MIN_RELATIVE_COST = 1e-6;
+
+PhaseConvergenceMonitor::PhaseConvergenceMonitor()
+    : evaluation_manager_(NULL), check_constraints_(false),
+      fixed_max_iterations_(0), max_iterations_(0), num_iterations_(0), num_stalled_iterations_(0), converged_(false),
+      initial_cost_(0.0), last_cost_(0.0), relative_decrease_(0.0), projected_gradient_norm_(0.0), constraint_violation_(0.0),
+      total_iterations_(0), total_fixed_iterations_(0)
+{
+
+}
+
+void PhaseConvergenceMonitor::begin(int fixed_max_iterations, const NewEvalManager* evaluation_manager,
+                                    const ItompTrajectory::ParameterVector& x_lower, const ItompTrajectory::ParameterVector& x_upper)
+{
+    evaluation_manager_ = evaluation_manager;
+    x_lower_ = x_lower;
+    x_upper_ = x_upper;
+    check_constraints_ = PhaseManager::getInstance()->getPhase() > 2 && !AugmentedLagrangian::getInstance()->isActive();
+
+    fixed_max_iterations_ = fixed_max_iterations;
+    max_iterations_ = fixed_max_iterations * PlanningParameters::getInstance()->getPhaseConvergenceMaxIterationsFactor();
+    num_iterations_ = 0;
+    num_stalled_iterations_ = 0;
+    converged_ = false;
+
+    initial_cost_ = 0.0;
+    last_cost_ = 0.0;
+    relative_decrease_ = 0.0;
+    projected_gradient_norm_ = 0.0;
+    constraint_violation_ = 0.0;
+}
+
+bool PhaseConvergenceMonitor::update(const ItompTrajectory::ParameterVector& variables, double cost,
+                                     const ItompTrajectory::ParameterVector& gradient)
+{
+    const PlanningParameters* parameters = PlanningParameters::getInstance();
+
+    // the components pushing against an active bound do not move the variables
+    double squared_norm = 0.0;
+    for (int i = 0; i < gradient.size(); ++i)
+    {
+        double g = gradient(i);
+        if ((variables(i) <= x_lower_(i) && g > 0.0) || (variables(i) >= x_upper_(i) && g < 0.0))
+            continue;
+        squared_norm += g * g;
+    }
+    projected_gradient_norm_ = std::sqrt(squared_norm);
+
+    if (num_iterations_ == 0)
+        initial_cost_ = cost;
+    else
+    {
+        relative_decrease_ = (last_cost_ - cost) / std::max(std::abs(last_cost_), MIN_RELATIVE_COST);
+        if (relative_decrease_ < parameters->getPhaseConvergenceRelativeDecrease())
+            ++num_stalled_iterations_;
+        else
+            num_stalled_iterations_ = 0;
+    }
+    last_cost_ = cost;
+    ++num_iterations_;
+
+    bool is_stationary = num_stalled_iterations_ >= parameters->getPhaseConvergenceNumStalledIterations() ||
+                         projected_gradient_norm_ < parameters->getPhaseConvergenceGradientNorm();
+    if (is_stationary && check_constraints_)
+        constraint_violation_ = AugmentedLagrangian::getInstance()->computeViolation(evaluation_manager_);
+
+    converged_ = is_stationary &&
+                 (!check_constraints_ || constraint_violation_ < parameters->getPhaseConvergenceConstraintViolation());
+    if (converged_)
+        return false;
+
+    return num_iterations_ <= max_iterations_;
+}
+
+void PhaseConvergenceMonitor::beginTimeWindows(int fixed_max_iterations, double cost)
+{
+    ItompTrajectory::ParameterVector no_bounds;
+    begin(fixed_max_iterations, NULL, no_bounds, no_bounds);
+    check_constraints_ = false;
+
+    initial_cost_ = cost;
+    last_cost_ = cost;
+}
+
+void PhaseConvergenceMonitor::updateTimeWindows(const std::vector<const PhaseConvergenceMonitor*>& window_monitors, double cost)
+{
+    // the windows run concurrently, so a consensus iteration takes the iterations of the longest window
+    int num_iterations = 0;
+    converged_ = true;
+    projected_gradient_norm_ = 0.0;
+    constraint_violation_ = 0.0;
+    for (std::size_t w = 0; w < window_monitors.size(); ++w)
+    {
+        const PhaseConvergenceMonitor& window_monitor = *window_monitors[w];
+        num_iterations = std::max(num_iterations, window_monitor.num_iterations_);
+        converged_ = converged_ && window_monitor.converged_;
+        projected_gradient_norm_ = std::max(projected_gradient_norm_, window_monitor.projected_gradient_norm_);
+        constraint_violation_ = std::max(constraint_violation_, window_monitor.constraint_violation_);
+    }
+    num_iterations_ += num_iterations;
+
+    relative_decrease_ = (last_cost_ - cost) / std::max(std::abs(last_cost_), MIN_RELATIVE_COST);
+    last_cost_ = cost;
+}
+
+void PhaseConvergenceMonitor::end()
+{
+    total_iterations_ += num_iterations_;
+    total_fixed_iterations_ += fixed_max_iterations_;
+
+    ROS_INFO("Phase %d %s after %d iterations (fixed budget %d, cap %d) : relative decrease %g, projected gradient norm %g, constraint violation %g",
+             PhaseManager::getInstance()->getPhase(), converged_ ? "converged" : "stopped",
+             num_iterations_, fixed_max_iterations_, max_iterations_,
+             relative_decrease_, projected_gradient_norm_, constraint_violation_);
+}
+
+double PhaseConvergenceMonitor::getPhaseRelativeDecrease() const
+{
+    return (initial_cost_ - last_cost_) / std::max(std::abs(initial_cost_), MIN_RELATIVE_COST);
+}
+
+void PhaseConvergenceMonitor::resetStatistics()
+{
+    total_iterations_ = 0;
+    total_fixed_iterations_ = 0;
+}
+
+}
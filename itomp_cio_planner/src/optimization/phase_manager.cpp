@@ -5,7 +5,7 @@ namespace itomp_cio_planner
 {
 
 PhaseManager::PhaseManager()
-    : phase_(0), num_points_(0)
+    : phase_(0), num_points_(0), contact_forces_solved_(false)
 {
     support_foot_ = 0; // any
     agent_id_ = 0;
@@ -26,6 +26,9 @@ bool PhaseManager::updateParameter(const ItompTrajectoryIndex& index) const
 {
     int state = (int)(PlanningParameters::getInstance()->getTemporaryVariable(0) + ITOMP_EPS);
 
+    if (contact_forces_solved_ && index.sub_component == ItompTrajectory::SUB_COMPONENT_TYPE_CONTACT_FORCE)
+        return false;
+
     switch (getPhase())
     {
     case 0:
@@ -6,7 +6,12 @@
 #include <itomp_cio_planner/util/joint_state_util.h>
 #include <itomp_cio_planner/visualization/new_viz_manager.h>
 #include <itomp_cio_planner/optimization/phase_manager.h>
+#include <itomp_cio_planner/optimization/augmented_lagrangian.h>
 #include <itomp_cio_planner/contact/ground_manager.h>
+#include <itomp_cio_planner/collision/voxel_world.h>
+#include <itomp_cio_planner/collision/collision_world_manager.h>
+#include <itomp_cio_planner/optimization/crowd_manager.h>
+#include <itomp_cio_planner/cost/trajectory_cost.h>
 #include <kdl/jntarray.hpp>
 #include <angles/angles.h>
 #include <visualization_msgs/MarkerArray.h>
@@ -15,7 +20,10 @@
 #include <moveit/robot_model/robot_model.h>
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/kinematic_constraints/utils.h>
 #include <ros/ros.h>
+#include <omp.h>
+#include <algorithm>
 
 using namespace std;
 
@@ -23,7 +31,7 @@ namespace itomp_cio_planner
 {
 
 ItompPlannerNode::ItompPlannerNode(const robot_model::RobotModelConstPtr& model) :
-	robot_model_(model)
+	robot_model_(model), is_first_request_(true)
 {
 
 }
@@ -33,6 +41,7 @@ ItompPlannerNode::~ItompPlannerNode()
     NewVizManager::getInstance()->destroy();
     TrajectoryFactory::getInstance()->destroy();
     PlanningParameters::getInstance()->destroy();
+    CollisionWorldManager::getInstance()->destroy();
 
     optimizer_.reset();
     itomp_trajectory_.reset();
@@ -45,9 +54,11 @@ bool ItompPlannerNode::init()
 	PlanningParameters::getInstance()->initFromNodeHandle();
 
 	// build itomp robot model
+	ros::WallTime robot_model_start_time = ros::WallTime::now();
 	itomp_robot_model_ = boost::make_shared<ItompRobotModel>();
 	if (!itomp_robot_model_->init(robot_model_))
 		return false;
+	double robot_model_time = (ros::WallTime::now() - robot_model_start_time).toSec();
 
 	NewVizManager::getInstance()->initialize(itomp_robot_model_);
 
@@ -60,6 +71,16 @@ bool ItompPlannerNode::init()
 
     deleteWaypointFiles();
 
+    if (PlanningParameters::getInstance()->getCrowdBenchmarkNumAgents() > 0)
+        CrowdManager::runSyntheticBenchmark(PlanningParameters::getInstance()->getCrowdBenchmarkNumAgents(),
+                                            itomp_trajectory_->getNumPoints());
+
+    if (PlanningParameters::getInstance()->getPrewarm())
+    {
+        ROS_INFO("Pre-warm stage robot model : %f sec", robot_model_time);
+        prewarm();
+    }
+
 	ROS_INFO("Initialized ITOMP planning service...");
 
 	return true;
@@ -69,6 +90,8 @@ bool ItompPlannerNode::planTrajectory(const planning_scene::PlanningSceneConstPt
                                       const planning_interface::MotionPlanRequest &req,
                                       planning_interface::MotionPlanResponse &res)
 {
+    ros::WallTime request_start_time = ros::WallTime::now();
+
 	// reload parameters
 	PlanningParameters::getInstance()->initFromNodeHandle();
 
@@ -82,7 +105,10 @@ bool ItompPlannerNode::planTrajectory(const planning_scene::PlanningSceneConstPt
     // set trajectory to zero
     itomp_trajectory_->reset();
 
+    VoxelWorld::getInstance()->initialize();
     GroundManager::getInstance()->initialize(planning_scene);
+    // the neighbors of a single agent request are given by its trajectory constraints
+    CrowdManager::getInstance()->initializeFromConstraints(req.trajectory_constraints.constraints, itomp_trajectory_->getNumPoints());
 
     double trajectory_start_time = req.start_state.joint_state.header.stamp.toSec();
     robot_state::RobotStatePtr initial_robot_state = planning_scene->getCurrentStateUpdated(req.start_state);
@@ -110,7 +136,11 @@ bool ItompPlannerNode::planTrajectory(const planning_scene::PlanningSceneConstPt
 
             const ItompPlanningGroupConstPtr planning_group = itomp_robot_model_->getPlanningGroup(planning_group_names[i]);
 
-            sensor_msgs::JointState goal_joint_state = getGoalStateFromGoalConstraints(itomp_robot_model_, req);
+            int goal_index = -1;
+            if (PlanningParameters::getInstance()->getGoalCandidates() > 1 && req.goal_constraints.size() > 1)
+                goal_index = selectGoalCandidate(planning_scene, req, planning_group, trajectory_start_time);
+
+            sensor_msgs::JointState goal_joint_state = getGoalStateFromGoalConstraints(itomp_robot_model_, req, goal_index);
 
 			/// optimize
             itomp_trajectory_->setGoalState(goal_joint_state, planning_group, itomp_robot_model_, req.trajectory_constraints);
@@ -150,15 +180,6 @@ bool ItompPlannerNode::planTrajectory(const planning_scene::PlanningSceneConstPt
     if (PlanningParameters::getInstance()->getPrintPlanningInfo())
         planning_info_manager_.printSummary();
 
-    /*
-    if (itomp_trajectory_->avoidNeighbors(req.trajectory_constraints.constraints) == false)
-    {
-        ROS_INFO("Planning failure - collision with neighbor");
-        res.error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
-        return false;
-    }
-    */
-
     // write goal state
     //writeWaypoint();
     //writeTrajectory();
@@ -167,11 +188,296 @@ bool ItompPlannerNode::planTrajectory(const planning_scene::PlanningSceneConstPt
 	// return trajectory
     fillInResult(initial_robot_state, res);
 
+    CrowdManager::getInstance()->destroy();
     GroundManager::getInstance()->destroy();
 
+    // latency of the first request, to compare with and without the pre-warm
+    if (is_first_request_)
+    {
+        ROS_INFO("First planning request took %f sec (pre-warm %s)", (ros::WallTime::now() - request_start_time).toSec(),
+                 PlanningParameters::getInstance()->getPrewarm() ? "on" : "off");
+        is_first_request_ = false;
+    }
+
 	return true;
 }
 
+bool ItompPlannerNode::planTrajectories(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                        const std::vector<planning_interface::MotionPlanRequest>& reqs,
+                                        std::vector<planning_interface::MotionPlanResponse>& res)
+{
+    // reload parameters
+    PlanningParameters::getInstance()->initFromNodeHandle();
+
+    int num_agents = reqs.size();
+    res.resize(num_agents);
+    for (int a = 0; a < num_agents; ++a)
+    {
+        if (!validateRequest(reqs[a]))
+        {
+            ROS_INFO("Planning failure - invalid planning request of agent %d", a);
+            for (int b = 0; b < num_agents; ++b)
+                res[b].error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+            return false;
+        }
+    }
+
+    // without the RVO cost the agents are planned independently
+    if (num_agents > 1 && PlanningParameters::getInstance()->getRVOCostWeight() <= 0.0)
+        ROS_WARN("RVO_cost_weight is %f. %d agents are planned without avoiding each other",
+                 PlanningParameters::getInstance()->getRVOCostWeight(), num_agents);
+
+    VoxelWorld::getInstance()->initialize();
+    GroundManager::getInstance()->initialize(planning_scene);
+
+    // initialize trajectories of all agents
+    std::vector<ItompTrajectoryPtr> agent_trajectories(num_agents);
+    std::vector<robot_state::RobotStatePtr> initial_robot_states(num_agents);
+    std::vector<ItompPlanningGroupConstPtr> planning_groups(num_agents);
+    for (int a = 0; a < num_agents; ++a)
+    {
+        agent_trajectories[a].reset(
+            TrajectoryFactory::getInstance()->CreateItompTrajectory(itomp_robot_model_,
+                    PlanningParameters::getInstance()->getTrajectoryDuration(),
+                    PlanningParameters::getInstance()->getTrajectoryDiscretization(),
+                    PlanningParameters::getInstance()->getPhaseDuration()));
+        initial_robot_states[a] = planning_scene->getCurrentStateUpdated(reqs[a].start_state);
+        planning_groups[a] = itomp_robot_model_->getPlanningGroup(reqs[a].group_name);
+
+        agent_trajectories[a]->setStartState(reqs[a].start_state.joint_state, itomp_robot_model_);
+        sensor_msgs::JointState goal_joint_state = getGoalStateFromGoalConstraints(itomp_robot_model_, reqs[a]);
+        agent_trajectories[a]->setGoalState(goal_joint_state, planning_groups[a], itomp_robot_model_, reqs[a].trajectory_constraints);
+    }
+
+    CrowdManager* crowd_manager = CrowdManager::getInstance();
+
+    std::vector<bool> agent_success(num_agents, true);
+    for (int r = 0; r < PlanningParameters::getInstance()->getCrowdNumRounds(); ++r)
+    {
+        // the crowd state of the round starts from the trajectories of all agents after the last round
+        crowd_manager->initialize(num_agents, itomp_trajectory_->getNumPoints(), true);
+        for (int a = 0; a < num_agents; ++a)
+        {
+            crowd_manager->setAgentRadius(a, PlanningParameters::getInstance()->getAgentRadius());
+            crowd_manager->setAgentTrajectory(a, agent_trajectories[a]->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+                                              ItompTrajectory::SUB_COMPONENT_TYPE_JOINT));
+        }
+        crowd_manager->buildSpatialHash();
+
+        for (int a = 0; a < num_agents; ++a)
+        {
+            ros::WallTime create_time = ros::WallTime::now();
+            double planning_start_time = ros::Time::now().toSec();
+            double trajectory_start_time = reqs[a].start_state.joint_state.header.stamp.toSec();
+
+            crowd_manager->setCurrentAgent(a);
+
+            optimizer_ = boost::make_shared<ItompOptimizer>(0, agent_trajectories[a],
+                         itomp_robot_model_, planning_scene, planning_groups[a], planning_start_time,
+                         trajectory_start_time, reqs[a].trajectory_constraints.constraints);
+            // the later rounds refine the trajectory of the last round instead of starting again from phase 0
+            optimizer_->optimize(ItompOptimizer::NUM_PHASES, r == 0 ? 0 : 1);
+
+            const PlanningInfo& planning_info = optimizer_->getPlanningInfo();
+            agent_success[a] = (planning_info.cost <= PlanningParameters::getInstance()->getFailureCost());
+
+            // other agents see the new trajectory
+            crowd_manager->setAgentTrajectory(a, agent_trajectories[a]->getElementTrajectory(ItompTrajectory::COMPONENT_TYPE_POSITION,
+                                              ItompTrajectory::SUB_COMPONENT_TYPE_JOINT));
+            crowd_manager->buildSpatialHash();
+
+            ROS_INFO("Round %d : optimization of agent %d took %f sec (cost : %f)", r, a,
+                     (ros::WallTime::now() - create_time).toSec(), planning_info.cost);
+        }
+    }
+    optimizer_.reset();
+
+    // return trajectories
+    bool success = true;
+    ItompTrajectoryPtr itomp_trajectory = itomp_trajectory_;
+    for (int a = 0; a < num_agents; ++a)
+    {
+        itomp_trajectory_ = agent_trajectories[a];
+        fillInResult(initial_robot_states[a], res[a]);
+        if (!agent_success[a])
+        {
+            ROS_INFO("Planning failure - cost of agent %d exceeds the failure cost", a);
+            res[a].error_code_.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+            success = false;
+        }
+    }
+    itomp_trajectory_ = itomp_trajectory;
+
+    CrowdManager::getInstance()->destroy();
+    GroundManager::getInstance()->destroy();
+
+    return success;
+}
+
+int ItompPlannerNode::selectGoalCandidate(const planning_scene::PlanningSceneConstPtr& planning_scene,
+                                          const planning_interface::MotionPlanRequest &req,
+                                          const ItompPlanningGroupConstPtr& planning_group,
+                                          double trajectory_start_time)
+{
+    int num_candidates = std::min((int)req.goal_constraints.size(), PlanningParameters::getInstance()->getGoalCandidates());
+    int num_survivors = std::max(1, std::min(num_candidates, PlanningParameters::getInstance()->getGoalCandidateSurvivors()));
+    int num_phases = PlanningParameters::getInstance()->getGoalCandidateScreeningPhases();
+    int num_points = itomp_trajectory_->getNumPoints();
+
+    ros::WallTime screening_start_time = ros::WallTime::now();
+
+    // the candidates start from the current trajectory. their evaluation managers are initialized one after another,
+    // since the contact initialization and the collision world update are parallel or shared
+    std::vector<ItompTrajectoryPtr> candidate_trajectories(num_candidates);
+    std::vector<NewEvalManagerPtr> candidate_managers(num_candidates);
+    for (int k = 0; k < num_candidates; ++k)
+    {
+        candidate_trajectories[k].reset(new ItompTrajectory(*itomp_trajectory_));
+        sensor_msgs::JointState goal_joint_state = getGoalStateFromGoalConstraints(itomp_robot_model_, req, k);
+        candidate_trajectories[k]->setGoalState(goal_joint_state, planning_group, itomp_robot_model_, req.trajectory_constraints);
+
+        // each candidate is the reference of its own partial evaluations
+        NewEvalManager::ref_evaluation_manager_ = NULL;
+        candidate_managers[k] = boost::make_shared<NewEvalManager>();
+        candidate_managers[k]->initialize(candidate_trajectories[k], itomp_robot_model_, planning_scene, planning_group,
+                                          ros::Time::now().toSec(), trajectory_start_time, req.trajectory_constraints.constraints);
+    }
+    PhaseManager::getInstance()->init(num_points, planning_group);
+    PhaseManager::getInstance()->setPhase(0);
+    AugmentedLagrangian::getInstance()->reset(num_points, planning_group->getNumContacts());
+
+    // phase 0 cost of the initial trajectory of each candidate, one manager per thread
+    std::vector<double> costs(num_candidates);
+    std::vector<int> is_feasible(num_candidates);
+    #pragma omp parallel for schedule(dynamic)
+    for (int k = 0; k < num_candidates; ++k)
+    {
+        candidate_managers[k]->evaluate();
+        costs[k] = candidate_managers[k]->getTrajectoryCost();
+        is_feasible[k] = candidate_managers[k]->isLastTrajectoryFeasible() ? 1 : 0;
+    }
+    candidate_managers.clear();
+
+    // feasible candidates first, then the lowest cost
+    std::vector<std::pair<std::pair<int, double>, int> > ranking(num_candidates);
+    for (int k = 0; k < num_candidates; ++k)
+        ranking[k] = std::make_pair(std::make_pair(1 - is_feasible[k], costs[k]), k);
+    std::sort(ranking.begin(), ranking.end());
+
+    ROS_INFO("Goal candidates : %d evaluated in %f sec, best initial cost %f (candidate %d), %d kept for screening",
+             num_candidates, (ros::WallTime::now() - screening_start_time).toSec(), ranking[0].first.second, ranking[0].second,
+             num_survivors);
+
+    int best_candidate = ranking[0].second;
+    if (num_survivors > 1)
+    {
+        // the survivors run the short first phases. the optimizers share the phase manager and are run one after another
+        double best_cost = std::numeric_limits<double>::max();
+        bool is_best_feasible = false;
+        for (int i = 0; i < num_survivors; ++i)
+        {
+            ros::WallTime create_time = ros::WallTime::now();
+            int k = ranking[i].second;
+
+            optimizer_ = boost::make_shared<ItompOptimizer>(0, candidate_trajectories[k],
+                         itomp_robot_model_, planning_scene, planning_group, ros::Time::now().toSec(),
+                         trajectory_start_time, req.trajectory_constraints.constraints);
+            bool is_feasible = optimizer_->optimize(num_phases);
+            double cost = optimizer_->getPlanningInfo().cost;
+
+            ROS_INFO("Goal candidate %d : cost %f (%s) after %d phases in %f sec", k, cost,
+                     is_feasible ? "feasible" : "infeasible", num_phases, (ros::WallTime::now() - create_time).toSec());
+
+            if ((is_feasible && !is_best_feasible) || (is_feasible == is_best_feasible && cost < best_cost))
+            {
+                best_candidate = k;
+                best_cost = cost;
+                is_best_feasible = is_feasible;
+            }
+        }
+        optimizer_.reset();
+    }
+
+    ROS_INFO("Goal candidate %d is optimized, %d candidates are pruned", best_candidate, num_candidates - 1);
+
+    return best_candidate;
+}
+
+void ItompPlannerNode::prewarm()
+{
+    const std::string& group_name = PlanningParameters::getInstance()->getPrewarmGroup();
+    if (!robot_model_->hasJointModelGroup(group_name))
+    {
+        ROS_ERROR("Pre-warm group %s does not exist. Pre-warm is skipped.", group_name.c_str());
+        return;
+    }
+
+    ros::WallTime start_time = ros::WallTime::now();
+    ros::WallTime stage_start_time = start_time;
+
+    // kept for all requests
+    if (PlanningParameters::getInstance()->getROMCostWeight() > 0.0)
+        loadROMFiles();
+
+    ROS_INFO("Pre-warm stage ROM : %f sec", (ros::WallTime::now() - stage_start_time).toSec());
+    stage_start_time = ros::WallTime::now();
+
+    // the OpenMP threads are kept between the parallel regions of all requests
+    omp_set_num_threads(omp_get_max_threads());
+    #pragma omp parallel
+    {
+    }
+
+    ROS_INFO("Pre-warm stage thread pool (%d threads) : %f sec", omp_get_max_threads(), (ros::WallTime::now() - stage_start_time).toSec());
+    stage_start_time = ros::WallTime::now();
+
+    // the other stages run on a dummy request from the default state to itself on an empty scene.
+    // their structures depend on the request and are rebuilt by every request, so they are only exercised
+    planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model_));
+    robot_state::RobotState default_state(robot_model_);
+    default_state.setToDefaultValues();
+    default_state.update(true);
+
+    planning_interface::MotionPlanRequest req;
+    req.group_name = group_name;
+    robot_state::robotStateToRobotStateMsg(default_state, req.start_state);
+    req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(default_state,
+                                   robot_model_->getJointModelGroup(group_name)));
+
+    VoxelWorld::getInstance()->initialize();
+    GroundManager::getInstance()->initialize(planning_scene);
+
+    ROS_INFO("Pre-warm stage ground manager : %f sec", (ros::WallTime::now() - stage_start_time).toSec());
+    stage_start_time = ros::WallTime::now();
+
+    const ItompPlanningGroupConstPtr planning_group = itomp_robot_model_->getPlanningGroup(group_name);
+    itomp_trajectory_->reset();
+    itomp_trajectory_->setStartState(req.start_state.joint_state, itomp_robot_model_);
+    sensor_msgs::JointState goal_joint_state = getGoalStateFromGoalConstraints(itomp_robot_model_, req);
+    itomp_trajectory_->setGoalState(goal_joint_state, planning_group, itomp_robot_model_, req.trajectory_constraints);
+
+    // cost functions, evaluation manager and its per-thread copies
+    optimizer_ = boost::make_shared<ItompOptimizer>(0, itomp_trajectory_,
+                 itomp_robot_model_, planning_scene, planning_group, ros::Time::now().toSec(),
+                 0.0, req.trajectory_constraints.constraints);
+
+    ROS_INFO("Pre-warm stage evaluation managers : %f sec", (ros::WallTime::now() - stage_start_time).toSec());
+    stage_start_time = ros::WallTime::now();
+
+    // evaluations of the first phase (collision, dynamics and cost code paths)
+    optimizer_->optimize(1);
+
+    ROS_INFO("Pre-warm stage evaluation : %f sec", (ros::WallTime::now() - stage_start_time).toSec());
+
+    optimizer_.reset();
+    itomp_trajectory_->reset();
+    GroundManager::getInstance()->destroy();
+    // the first request builds the collision world of its own scene
+    CollisionWorldManager::getInstance()->clear();
+
+    ROS_INFO("Pre-warm finished in %f sec", (ros::WallTime::now() - start_time).toSec());
+}
+
 bool ItompPlannerNode::validateRequest(const planning_interface::MotionPlanRequest &req)
 {
     ROS_INFO("Received planning request ... planning group : %s", req.group_name.c_str());
@@ -428,11 +734,16 @@ void ItompPlannerNode::writeTrajectory()
     node_handle.getParam("agent_trajectory_index", trajectory_index);
 
     std::stringstream ss;
-    ss << "trajectory_out_" << std::setfill('0') << std::setw(4) << agent_id << "_" << std::setfill('0') << std::setw(4) << trajectory_index << ".txt";
-    std::ofstream trajectory_file;
-    trajectory_file.open(ss.str().c_str());
-    itomp_trajectory_->printTrajectory(trajectory_file, 0, 40);
-    trajectory_file.close();
+    ss << "trajectory_out_" << std::setfill('0') << std::setw(4) << agent_id << "_" << std::setfill('0') << std::setw(4) << trajectory_index;
+    itomp_trajectory_->writeTrajectoryFile(ss.str() + ".itraj");
+
+    if (PlanningParameters::getInstance()->getExportTrajectoryText())
+    {
+        std::ofstream trajectory_file;
+        trajectory_file.open((ss.str() + ".txt").c_str());
+        itomp_trajectory_->printTrajectory(trajectory_file, 0, 40);
+        trajectory_file.close();
+    }
 }
 
 bool ItompPlannerNode::adjustStartGoalPositions(robot_state::RobotState& initial_state, robot_state::RobotState& goal_state, bool read_start_state_from_previous_step)
@@ -0,0 +1,103 @@
+#include <itomp_cio_planner/optimization/new_eval_manager.h>
+#include <itomp_cio_planner/model/itomp_robot_model.h>
+#include <itomp_cio_planner/trajectory/trajectory_factory.h>
+#include <itomp_cio_planner/contact/ground_manager.h>
+#include <itomp_cio_planner/collision/voxel_world.h>
+#include <itomp_cio_planner/collision/collision_world_manager.h>
+#include <itomp_cio_planner/util/planning_parameters.h>
+#include <itomp_cio_planner/util/joint_state_util.h>
+#include <moveit/robot_model_loader/robot_model_loader.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/kinematic_constraints/utils.h>
+#include <ros/ros.h>
+#include <fstream>
+
+using namespace itomp_cio_planner;
+
+// runs the evaluation benchmarks enabled by the *_benchmark_num_trials parameters of the planner (itomp_planner namespace),
+// i.e. dynamics fidelities, swept broadphase, convex decompositions, GJK warm start and batched obstacle queries.
+// the scene is a .scene file of the planning scene (empty scene if not given). the trajectory is either a trajectory file
+// written by the planner (export_phase_trajectories) or the trajectory from the default state to itself
+int main(int argc, char** argv)
+{
+	ros::init(argc, argv, "benchmark_evaluation");
+
+	if (argc < 2)
+	{
+		ROS_ERROR("Usage : benchmark_evaluation <planning group> [scene file] [trajectory file]");
+		return 1;
+	}
+	std::string group_name = argv[1];
+
+	PlanningParameters::getInstance()->initFromNodeHandle();
+
+	robot_model_loader::RobotModelLoader robot_model_loader("robot_description");
+	robot_model::RobotModelPtr robot_model = robot_model_loader.getModel();
+	if (!robot_model || !robot_model->hasJointModelGroup(group_name))
+	{
+		ROS_ERROR("Planning group %s does not exist", group_name.c_str());
+		return 1;
+	}
+
+	ItompRobotModelPtr itomp_robot_model = boost::make_shared<ItompRobotModel>();
+	if (!itomp_robot_model->init(robot_model))
+		return 1;
+	const ItompPlanningGroupConstPtr planning_group = itomp_robot_model->getPlanningGroup(group_name);
+
+	planning_scene::PlanningScenePtr planning_scene(new planning_scene::PlanningScene(robot_model));
+	if (argc > 2)
+	{
+		std::ifstream scene_file(argv[2]);
+		if (!scene_file.good())
+		{
+			ROS_ERROR("Failed to open scene file %s", argv[2]);
+			return 1;
+		}
+		planning_scene->loadGeometryFromStream(scene_file);
+	}
+
+	robot_state::RobotState default_state(robot_model);
+	default_state.setToDefaultValues();
+	default_state.update(true);
+
+	planning_interface::MotionPlanRequest req;
+	req.group_name = group_name;
+	robot_state::robotStateToRobotStateMsg(default_state, req.start_state);
+	req.goal_constraints.push_back(kinematic_constraints::constructGoalConstraints(default_state,
+								   robot_model->getJointModelGroup(group_name)));
+
+	TrajectoryFactory::getInstance()->initialize(TrajectoryFactory::TRAJECTORY_CIO);
+	ItompTrajectoryPtr itomp_trajectory(
+		TrajectoryFactory::getInstance()->CreateItompTrajectory(itomp_robot_model,
+				PlanningParameters::getInstance()->getTrajectoryDuration(),
+				PlanningParameters::getInstance()->getTrajectoryDiscretization(),
+				PlanningParameters::getInstance()->getPhaseDuration()));
+	itomp_trajectory->setStartState(req.start_state.joint_state, itomp_robot_model);
+	sensor_msgs::JointState goal_joint_state = getGoalStateFromGoalConstraints(itomp_robot_model, req);
+	itomp_trajectory->setGoalState(goal_joint_state, planning_group, itomp_robot_model, req.trajectory_constraints);
+
+	VoxelWorld::getInstance()->initialize();
+	GroundManager::getInstance()->initialize(planning_scene);
+
+	NewEvalManagerPtr evaluation_manager = boost::make_shared<NewEvalManager>();
+	evaluation_manager->initialize(itomp_trajectory, itomp_robot_model, planning_scene, planning_group,
+								   ros::Time::now().toSec(), 0.0, req.trajectory_constraints.constraints);
+
+	if (argc > 3 && !itomp_trajectory->readTrajectoryFile(argv[3]))
+	{
+		ROS_ERROR("Failed to read trajectory file %s", argv[3]);
+		return 1;
+	}
+
+	evaluation_manager->runBenchmarks();
+
+	evaluation_manager.reset();
+	itomp_trajectory.reset();
+	GroundManager::getInstance()->destroy();
+	CollisionWorldManager::getInstance()->destroy();
+	TrajectoryFactory::getInstance()->destroy();
+	PlanningParameters::getInstance()->destroy();
+
+	return 0;
+}
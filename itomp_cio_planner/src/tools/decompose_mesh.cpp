@@ -0,0 +1,46 @@
+#include <itomp_cio_planner/collision/convex_decomposition.h>
+#include <geometric_shapes/mesh_operations.h>
+#include <ros/ros.h>
+#include <cstdlib>
+
+// writes the convex decomposition cache of an environment mesh, so that the planner does not decompose it on the first request.
+// the parameters and the output file should match those of the planner (convex_decomposition_*),
+// i.e. <convex_decomposition_cache_prefix><world object id>.cvx
+int main(int argc, char** argv)
+{
+	ros::Time::init();
+
+	if (argc < 3)
+	{
+		ROS_ERROR("Usage : decompose_mesh <mesh resource> <output file> [max_concavity = 0.05] [max_pieces = 256] [scale = 1.0]");
+		return 1;
+	}
+
+	std::string resource = argv[1];
+	std::string file_name = argv[2];
+	double max_concavity = argc > 3 ? atof(argv[3]) : 0.05;
+	int max_pieces = argc > 4 ? atoi(argv[4]) : 256;
+	double scale = argc > 5 ? atof(argv[5]) : 1.0;
+
+	shapes::Mesh* mesh = shapes::createMeshFromResource(resource, Eigen::Vector3d(scale, scale, scale));
+	if (mesh == NULL)
+	{
+		ROS_ERROR("Failed to load mesh %s", resource.c_str());
+		return 1;
+	}
+
+	itomp_cio_planner::ConvexDecomposition decomposition;
+	ros::WallTime start_time = ros::WallTime::now();
+	decomposition.decompose(*mesh, max_concavity, max_pieces);
+	double elapsed = (ros::WallTime::now() - start_time).toSec();
+
+	unsigned int num_triangles = 0;
+	for (unsigned int i = 0; i < decomposition.getNumPieces(); ++i)
+		num_triangles += decomposition.getPiece(i)->triangle_count;
+	ROS_INFO("%s : %d triangles decomposed into %d convex pieces (%d hull triangles) in %f sec", resource.c_str(),
+			 mesh->triangle_count, decomposition.getNumPieces(), num_triangles, elapsed);
+
+	bool saved = decomposition.save(file_name, itomp_cio_planner::ConvexDecomposition::computeMeshHash(*mesh, max_concavity, max_pieces));
+	delete mesh;
+	return saved ? 0 : 1;
+}
@@ -2,6 +2,8 @@
 #include <itomp_cio_planner/util/joint_state_util.h>
 #include <itomp_cio_planner/optimization/phase_manager.h>
 #include <itomp_cio_planner/util/planning_parameters.h>
+#include <itomp_cio_planner/util/binary_io.h>
+#include <cstring>
 #include <ros/assert.h>
 #include <ecl/geometry/polynomial.hpp>
 #include <ecl/geometry.hpp>
@@ -11,6 +13,13 @@ using namespace std;
 namespace itomp_cio_planner
 {
 
+// binary trajectory file format
+// header : magic, version, num_points, num_keyframes, keyframe_interval, duration, discretization
+// parameters : num_parameters, values
+// element trajectories : count, then (component, sub_component, num_points, num_elements, column-major values) for each
+static const char TRAJECTORY_FILE_MAGIC[8] = { 'I', 'T', 'O', 'M', 'P', 'T', 'R', 'J' };
+static const uint32_t TRAJECTORY_FILE_VERSION = 1;
+
 ItompTrajectory::ItompTrajectory(const std::string& name, unsigned int num_points, const std::vector<NewTrajectoryPtr>& components,
                                  unsigned int num_keyframes, unsigned int keyframe_interval, double duration, double discretization)
     : CompositeTrajectory(name, num_points, components), num_keyframes_(num_keyframes), keyframe_interval_(keyframe_interval),
@@ -695,75 +704,6 @@ void ItompTrajectory::copy(int point_src, int point_dest, SUB_COMPONENT_TYPE sub
     }
 }
 
-bool ItompTrajectory::avoidNeighbors(const std::vector<moveit_msgs::Constraints>& neighbors)
-{
-    return true;
-
-    if (neighbors.size() == 0)
-        return true;
-
-    ElementTrajectoryPtr joint = getElementTrajectory(COMPONENT_TYPE_POSITION, SUB_COMPONENT_TYPE_JOINT);
-
-    double last_dist_to_move = std::numeric_limits<double>::max();
-    double dist_to_move = 0.0;
-    while (true)
-    {
-        dist_to_move = 0.0;
-
-        for (int i = 0; i < neighbors[0].position_constraints.size(); ++i)
-        {
-            // 0 is the robot itself
-            double my_radius = neighbors[0].position_constraints[i].target_point_offset.z;
-            Eigen::Vector3d my_pos;
-            my_pos(0) = (*joint)(i, 0);
-            my_pos(1) = (*joint)(i, 1);
-
-            for (int j = 1; j < neighbors.size(); ++j)
-            {
-                if (neighbors[j].position_constraints[i].weight < 0)
-                    continue;
-
-                double neighbor_radius = neighbors[j].position_constraints[i].target_point_offset.z;
-
-                double sq_radius_sum = (my_radius + neighbor_radius) * (my_radius + neighbor_radius);
-
-                Eigen::Vector3d neighbor_pos;
-                neighbor_pos(0) = neighbors[j].position_constraints[i].target_point_offset.x;
-                neighbor_pos(1) = neighbors[j].position_constraints[i].target_point_offset.y;
-
-                double sq_dist = (my_pos - neighbor_pos).squaredNorm();
-
-                if (sq_dist < sq_radius_sum)
-                {
-                    double dist = std::sqrt(sq_radius_sum - sq_dist);
-                    dist_to_move += dist;
-
-                    Eigen::Vector3d dir = (my_pos - neighbor_pos);
-                    dir.normalize();
-
-                    //(*joint)(i, 0) += dist * dir(0);
-                    //(*joint)(i, 1) += dist * dir(1);
-                }
-            }
-            if (/*i == 0 && */dist_to_move > 0)
-            {
-                ROS_INFO("Collide with neighbor %d", i);
-                return false;
-            }
-        }
-
-        if (dist_to_move == 0)
-            break;
-
-        if (dist_to_move >= last_dist_to_move)
-            return false;
-        else
-            last_dist_to_move = dist_to_move;
-    }
-
-    return true;
-}
-
 bool ItompTrajectory::setJointPositions(Eigen::VectorXd& trajectory_data, const ParameterVector& parameters, int point) const
 {
     bool updated = false;
@@ -789,5 +729,139 @@ void ItompTrajectory::getJointPositions(ParameterVector& parameters, const Eigen
     }
 }
 
+bool ItompTrajectory::writeTrajectoryFile(const std::string& file_name) const
+{
+    unsigned int num_parameters = getNumParameters();
+    ParameterVector parameters(num_parameters);
+    if (num_parameters > 0)
+        getParameters(parameters);
+
+    BinaryWriter writer;
+    std::size_t size = 64 + num_parameters * sizeof(double);
+    for (int i = 0; i < COMPONENT_TYPE_NUM; ++i)
+        for (int j = 0; j < SUB_COMPONENT_TYPE_NUM; ++j)
+            size += 16 + element_trajectories_[i][j]->getData().size() * sizeof(double);
+    writer.reserve(size);
+
+    writer.writeBytes(TRAJECTORY_FILE_MAGIC, sizeof(TRAJECTORY_FILE_MAGIC));
+    writer.writeUInt32(TRAJECTORY_FILE_VERSION);
+    writer.writeUInt32(num_points_);
+    writer.writeUInt32(num_keyframes_);
+    writer.writeUInt32(keyframe_interval_);
+    writer.writeDouble(duration_);
+    writer.writeDouble(discretization_);
+
+    writer.writeUInt32(num_parameters);
+    if (num_parameters > 0)
+        writer.writeDoubles(&parameters(0, 0), num_parameters);
+
+    writer.writeUInt32(COMPONENT_TYPE_NUM * SUB_COMPONENT_TYPE_NUM);
+    for (int i = 0; i < COMPONENT_TYPE_NUM; ++i)
+    {
+        for (int j = 0; j < SUB_COMPONENT_TYPE_NUM; ++j)
+        {
+            const Eigen::MatrixXd& data = element_trajectories_[i][j]->getData();
+            writer.writeUInt32(i);
+            writer.writeUInt32(j);
+            writer.writeUInt32(data.rows());
+            writer.writeUInt32(data.cols());
+            writer.writeDoubles(data.data(), data.size());
+        }
+    }
+
+    if (!writer.writeToFile(file_name))
+    {
+        ROS_ERROR("Failed to write trajectory file %s", file_name.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ItompTrajectory::readTrajectoryFile(const std::string& file_name)
+{
+    return readTrajectoryFile(file_name, NULL, this);
+}
+
+bool ItompTrajectory::readTrajectoryFileParameters(const std::string& file_name, ParameterVector& parameters) const
+{
+    return readTrajectoryFile(file_name, &parameters, NULL);
+}
+
+bool ItompTrajectory::readTrajectoryFile(const std::string& file_name, ParameterVector* parameters, ItompTrajectory* target) const
+{
+    MappedFile file;
+    if (!file.open(file_name))
+        return false;
+
+    BinaryReader reader(file.getData(), file.getSize());
+
+    char magic[sizeof(TRAJECTORY_FILE_MAGIC)];
+    uint32_t version, num_points, num_keyframes, keyframe_interval;
+    double duration, discretization;
+    if (!reader.readBytes(magic, sizeof(magic)) || memcmp(magic, TRAJECTORY_FILE_MAGIC, sizeof(magic)) != 0
+            || !reader.readUInt32(version) || version != TRAJECTORY_FILE_VERSION)
+    {
+        ROS_ERROR("%s is not a trajectory file of version %d", file_name.c_str(), TRAJECTORY_FILE_VERSION);
+        return false;
+    }
+    if (!reader.readUInt32(num_points) || !reader.readUInt32(num_keyframes) || !reader.readUInt32(keyframe_interval)
+            || !reader.readDouble(duration) || !reader.readDouble(discretization))
+    {
+        ROS_ERROR("Invalid trajectory file %s", file_name.c_str());
+        return false;
+    }
+    if (num_points != num_points_ || num_keyframes != num_keyframes_ || keyframe_interval != keyframe_interval_)
+    {
+        ROS_ERROR("Trajectory file %s does not match the trajectory (%d points, %d keyframes)",
+                  file_name.c_str(), num_points, num_keyframes);
+        return false;
+    }
+
+    uint32_t num_parameters;
+    if (!reader.readUInt32(num_parameters))
+        return false;
+    if (parameters != NULL)
+    {
+        parameters->set_size(num_parameters);
+        if (num_parameters > 0 && !reader.readDoubles(&(*parameters)(0, 0), num_parameters))
+            return false;
+    }
+    else
+    {
+        std::vector<double> skip(num_parameters);
+        if (num_parameters > 0 && !reader.readDoubles(&skip[0], num_parameters))
+            return false;
+    }
+
+    if (target == NULL)
+        return true;
+
+    uint32_t num_element_trajectories;
+    if (!reader.readUInt32(num_element_trajectories))
+        return false;
+    for (unsigned int k = 0; k < num_element_trajectories; ++k)
+    {
+        uint32_t component, sub_component, rows, cols;
+        if (!reader.readUInt32(component) || !reader.readUInt32(sub_component)
+                || !reader.readUInt32(rows) || !reader.readUInt32(cols)
+                || component >= COMPONENT_TYPE_NUM || sub_component >= SUB_COMPONENT_TYPE_NUM)
+        {
+            ROS_ERROR("Invalid element trajectory in trajectory file %s", file_name.c_str());
+            return false;
+        }
+
+        Eigen::MatrixXd& data = target->element_trajectories_[component][sub_component]->getData();
+        if (rows != data.rows() || cols != data.cols())
+        {
+            ROS_ERROR("Element trajectory [%d][%d] size mismatch in trajectory file %s",
+                      component, sub_component, file_name.c_str());
+            return false;
+        }
+        if (!reader.readDoubles(data.data(), data.size()))
+            return false;
+    }
+
+    return true;
 }
 
+}
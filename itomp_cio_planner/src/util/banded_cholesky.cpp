@@ -0,0 +1,70 @@
+#include <itomp_cio_planner/util/banded_cholesky.h>
+
+namespace itomp_cio_planner
+{
+
+BandedCholesky::BandedCholesky()
+    : bandwidth_(0)
+{
+
+}
+
+void BandedCholesky::resize(int size, int bandwidth)
+{
+    bandwidth_ = std::max(0, std::min(bandwidth, size - 1));
+    band_ = Eigen::MatrixXd::Zero(bandwidth_ + 1, size);
+}
+
+bool BandedCholesky::factorize()
+{
+    const int size = band_.cols();
+    for (int j = 0; j < size; ++j)
+    {
+        const int k_begin = std::max(0, j - bandwidth_);
+
+        double diagonal = coeff(j, j);
+        for (int k = k_begin; k < j; ++k)
+            diagonal -= coeff(j, k) * coeff(j, k);
+        if (!(diagonal > 0.0))
+            return false;
+        diagonal = std::sqrt(diagonal);
+        coeffRef(j, j) = diagonal;
+
+        const int i_end = std::min(size, j + bandwidth_ + 1);
+        for (int i = j + 1; i < i_end; ++i)
+        {
+            // L(i, k) is zero for k < i - bandwidth
+            double value = coeff(i, j);
+            for (int k = std::max(k_begin, i - bandwidth_); k < j; ++k)
+                value -= coeff(i, k) * coeff(j, k);
+            coeffRef(i, j) = value / diagonal;
+        }
+    }
+    return true;
+}
+
+void BandedCholesky::solve(Eigen::VectorXd& x) const
+{
+    const int size = band_.cols();
+
+    // L y = b
+    for (int i = 0; i < size; ++i)
+    {
+        double value = x(i);
+        for (int k = std::max(0, i - bandwidth_); k < i; ++k)
+            value -= coeff(i, k) * x(k);
+        x(i) = value / coeff(i, i);
+    }
+
+    // L^T x = y
+    for (int i = size - 1; i >= 0; --i)
+    {
+        double value = x(i);
+        const int k_end = std::min(size, i + bandwidth_ + 1);
+        for (int k = i + 1; k < k_end; ++k)
+            value -= coeff(k, i) * x(k);
+        x(i) = value / coeff(i, i);
+    }
+}
+
+}
@@ -0,0 +1,239 @@
+#include <itomp_cio_planner/util/binary_io.h>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace itomp_cio_planner
+{
+
+namespace
+{
+
+inline bool isLittleEndianHost()
+{
+	const uint32_t one = 1;
+	return *reinterpret_cast<const unsigned char*>(&one) == 1;
+}
+
+inline uint64_t doubleToBits(double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+inline double bitsToDouble(uint64_t bits)
+{
+	double value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+inline void encodeUInt64(uint64_t value, char* out)
+{
+	for (int i = 0; i < 8; ++i)
+		out[i] = (char) ((value >> (8 * i)) & 0xff);
+}
+
+inline uint64_t decodeUInt64(const char* in)
+{
+	uint64_t value = 0;
+	for (int i = 0; i < 8; ++i)
+		value |= ((uint64_t) (unsigned char) in[i]) << (8 * i);
+	return value;
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BinaryWriter::BinaryWriter()
+{
+}
+
+void BinaryWriter::writeBytes(const void* data, std::size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	buffer_.insert(buffer_.end(), bytes, bytes + size);
+}
+
+void BinaryWriter::writeUInt32(uint32_t value)
+{
+	char bytes[4];
+	for (int i = 0; i < 4; ++i)
+		bytes[i] = (char) ((value >> (8 * i)) & 0xff);
+	writeBytes(bytes, 4);
+}
+
+void BinaryWriter::writeUInt64(uint64_t value)
+{
+	char bytes[8];
+	encodeUInt64(value, bytes);
+	writeBytes(bytes, 8);
+}
+
+void BinaryWriter::writeDouble(double value)
+{
+	writeUInt64(doubleToBits(value));
+}
+
+void BinaryWriter::writeDoubles(const double* values, std::size_t count)
+{
+	std::size_t offset = buffer_.size();
+	buffer_.resize(offset + count * sizeof(double));
+	char* out = &buffer_[0] + offset;
+
+	if (isLittleEndianHost())
+	{
+		memcpy(out, values, count * sizeof(double));
+	}
+	else
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			encodeUInt64(doubleToBits(values[i]), out + 8 * i);
+	}
+}
+
+void BinaryWriter::writeString(const std::string& str)
+{
+	writeUInt32(str.size());
+	writeBytes(str.data(), str.size());
+}
+
+bool BinaryWriter::writeToFile(const std::string& file_name) const
+{
+	std::ofstream out(file_name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+	if (!out.is_open())
+		return false;
+	if (!buffer_.empty())
+		out.write(&buffer_[0], buffer_.size());
+	return out.good();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+MappedFile::MappedFile()
+	: fd_(-1), data_(NULL), size_(0)
+{
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& file_name)
+{
+	close();
+
+	fd_ = ::open(file_name.c_str(), O_RDONLY);
+	if (fd_ < 0)
+		return false;
+
+	struct stat file_stat;
+	if (fstat(fd_, &file_stat) != 0 || file_stat.st_size == 0)
+	{
+		close();
+		return false;
+	}
+
+	size_ = file_stat.st_size;
+	void* data = mmap(NULL, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+	if (data == MAP_FAILED)
+	{
+		close();
+		return false;
+	}
+	data_ = data;
+
+	return true;
+}
+
+void MappedFile::close()
+{
+	if (data_ != NULL)
+		munmap(data_, size_);
+	if (fd_ >= 0)
+		::close(fd_);
+	fd_ = -1;
+	data_ = NULL;
+	size_ = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BinaryReader::BinaryReader(const char* data, std::size_t size)
+	: data_(data), size_(size), offset_(0)
+{
+}
+
+bool BinaryReader::readBytes(void* data, std::size_t size)
+{
+	if (getRemaining() < size)
+		return false;
+	memcpy(data, data_ + offset_, size);
+	offset_ += size;
+	return true;
+}
+
+bool BinaryReader::readUInt32(uint32_t& value)
+{
+	if (getRemaining() < 4)
+		return false;
+	value = 0;
+	for (int i = 0; i < 4; ++i)
+		value |= ((uint32_t) (unsigned char) data_[offset_ + i]) << (8 * i);
+	offset_ += 4;
+	return true;
+}
+
+bool BinaryReader::readUInt64(uint64_t& value)
+{
+	if (getRemaining() < 8)
+		return false;
+	value = decodeUInt64(data_ + offset_);
+	offset_ += 8;
+	return true;
+}
+
+bool BinaryReader::readDouble(double& value)
+{
+	uint64_t bits;
+	if (!readUInt64(bits))
+		return false;
+	value = bitsToDouble(bits);
+	return true;
+}
+
+bool BinaryReader::readDoubles(double* values, std::size_t count)
+{
+	if (getRemaining() / sizeof(double) < count)
+		return false;
+
+	const char* in = data_ + offset_;
+	if (isLittleEndianHost())
+	{
+		memcpy(values, in, count * sizeof(double));
+	}
+	else
+	{
+		for (std::size_t i = 0; i < count; ++i)
+			values[i] = bitsToDouble(decodeUInt64(in + 8 * i));
+	}
+	offset_ += count * sizeof(double);
+	return true;
+}
+
+bool BinaryReader::readString(std::string& str)
+{
+	uint32_t size;
+	if (!readUInt32(size) || getRemaining() < size)
+		return false;
+	str.assign(data_ + offset_, size);
+	offset_ += size;
+	return true;
+}
+
+}
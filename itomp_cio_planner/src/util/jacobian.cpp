@@ -6,6 +6,13 @@
 
 itomp_cio_planner::NewEvalManager* Jacobian::evaluation_manager_ = NULL;
 
+namespace
+{
+// the time windows are optimized concurrently with their own scales
+const dlib::matrix<double, 0, 1>* variable_scales = NULL;
+#pragma omp threadprivate(variable_scales)
+}
+
 Jacobian::Jacobian()
 {
 	ComputeJacobian();
@@ -227,7 +234,38 @@ void Jacobian::GetProjection(int point, const Eigen::VectorXd& q, Eigen::VectorX
     a = j.GetNullspace() * a;
 }
 
-void Jacobian::projectToNullSpace(const dlib::matrix<double, 0, 1>& x, dlib::matrix<double, 0, 1>& s)
+void Jacobian::setVariableScales(const dlib::matrix<double, 0, 1>* scales)
+{
+    variable_scales = scales;
+}
+
+void Jacobian::projectToNullSpace(const dlib::matrix<double, 0, 1>& x, dlib::matrix<double, 0, 1>& s, bool is_gradient)
+{
+    if (variable_scales == NULL || variable_scales->size() != x.size())
+    {
+        projectJointPositionsToNullSpace(x, s);
+        return;
+    }
+
+    // the contact jacobian is computed at the joint positions, and projects steps in the unscaled variables.
+    // a step is scaled as the variables, a gradient inversely
+    const dlib::matrix<double, 0, 1>& scales = *variable_scales;
+    dlib::matrix<double, 0, 1> unscaled_x = dlib::pointwise_multiply(x, scales);
+    dlib::matrix<double, 0, 1> unscaled_s;
+    if (is_gradient)
+        unscaled_s = dlib::pointwise_multiply(s, dlib::reciprocal(scales));
+    else
+        unscaled_s = dlib::pointwise_multiply(s, scales);
+
+    projectJointPositionsToNullSpace(unscaled_x, unscaled_s);
+
+    if (is_gradient)
+        s = dlib::pointwise_multiply(unscaled_s, scales);
+    else
+        s = dlib::pointwise_multiply(unscaled_s, dlib::reciprocal(scales));
+}
+
+void Jacobian::projectJointPositionsToNullSpace(const dlib::matrix<double, 0, 1>& x, dlib::matrix<double, 0, 1>& s)
 {
     itomp_cio_planner::ItompTrajectoryPtr trajectory = evaluation_manager_->getTrajectoryNonConst();
 
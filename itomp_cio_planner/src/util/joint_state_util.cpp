@@ -24,11 +24,13 @@ sensor_msgs::JointState jointConstraintsToJointState(
 
 sensor_msgs::JointState getGoalStateFromGoalConstraints(
 	const ItompRobotModelConstPtr& itomp_robot_model,
-	const planning_interface::MotionPlanRequest &req)
+	const planning_interface::MotionPlanRequest &req,
+	int goal_index)
 {
 	sensor_msgs::JointState goal_state;
-	sensor_msgs::JointState goal_constraints_joint_state =
-		jointConstraintsToJointState(req.goal_constraints);
+	sensor_msgs::JointState goal_constraints_joint_state = (goal_index < 0) ?
+		jointConstraintsToJointState(req.goal_constraints) :
+		jointConstraintsToJointState(std::vector<moveit_msgs::Constraints>(1, req.goal_constraints[goal_index]));
 	goal_state.name.resize(req.start_state.joint_state.name.size());
 	goal_state.position.resize(req.start_state.joint_state.position.size());
 	for (unsigned int i = 0; i < goal_constraints_joint_state.name.size(); ++i)
@@ -7,10 +7,18 @@
 
 #include <itomp_cio_planner/util/planning_parameters.h>
 #include <ros/ros.h>
+#include <algorithm>
 
 namespace itomp_cio_planner
 {
 
+static double xmlRpcValueToDouble(XmlRpc::XmlRpcValue& value)
+{
+    if (value.getType() == XmlRpc::XmlRpcValue::TypeInt)
+        return static_cast<int>(value);
+    return static_cast<double>(value);
+}
+
 PlanningParameters::PlanningParameters() :
 	num_time_steps_(0), updateIndex(-1)
 {
@@ -319,6 +327,148 @@ void PlanningParameters::initFromNodeHandle()
     node_handle.param("contact_z_plane_only", contact_z_plane_only_, false);
 
     node_handle.param("passive_force_ratio", passive_force_ratio_, 1.0);
+
+    node_handle.param<std::string>("rbdl_model_cache_file", rbdl_model_cache_file_, "");
+
+    node_handle.param("export_trajectory_text", export_trajectory_text_, false);
+    node_handle.param("export_phase_trajectories", export_phase_trajectories_, false);
+
+    external_wrenches_.clear();
+    if (node_handle.hasParam("external_wrenches"))
+    {
+        XmlRpc::XmlRpcValue segment;
+
+        node_handle.getParam("external_wrenches", segment);
+
+        if (segment.getType() == XmlRpc::XmlRpcValue::TypeArray)
+        {
+            int size = segment.size();
+            for (int i = 0; i < size; ++i)
+            {
+                XmlRpc::XmlRpcValue& entry = segment[i];
+                if (entry.getType() != XmlRpc::XmlRpcValue::TypeStruct || !entry.hasMember("body")
+                        || !entry.hasMember("wrench"))
+                {
+                    ROS_ERROR("external_wrenches[%d] needs body and wrench", i);
+                    continue;
+                }
+
+                ExternalWrench external_wrench;
+                external_wrench.body_name_ = static_cast<std::string>(entry["body"]);
+                external_wrench.start_time_ = entry.hasMember("start_time") ? xmlRpcValueToDouble(entry["start_time"]) : 0.0;
+                external_wrench.end_time_ = entry.hasMember("end_time") ? xmlRpcValueToDouble(entry["end_time"]) : std::numeric_limits<double>::max();
+
+                XmlRpc::XmlRpcValue& wrench = entry["wrench"];
+                XmlRpc::XmlRpcValue& end_wrench = entry.hasMember("end_wrench") ? entry["end_wrench"] : entry["wrench"];
+                if (wrench.getType() != XmlRpc::XmlRpcValue::TypeArray || wrench.size() != 6
+                        || end_wrench.getType() != XmlRpc::XmlRpcValue::TypeArray || end_wrench.size() != 6)
+                {
+                    ROS_ERROR("external_wrenches[%d] wrench should have 6 values (torque, force)", i);
+                    continue;
+                }
+                for (int j = 0; j < 6; ++j)
+                {
+                    external_wrench.wrench_.push_back(xmlRpcValueToDouble(wrench[j]));
+                    external_wrench.end_wrench_.push_back(xmlRpcValueToDouble(end_wrench[j]));
+                }
+
+                external_wrenches_.push_back(external_wrench);
+            }
+        }
+    }
+
+    node_handle.param("agent_radius", agent_radius_, 0.3);
+    node_handle.param("crowd_num_rounds", crowd_num_rounds_, 2);
+    node_handle.param("crowd_benchmark_num_agents", crowd_benchmark_num_agents_, 0);
+
+    node_handle.param("ik_benchmark_num_solves", ik_benchmark_num_solves_, 0);
+    node_handle.param("partial_fk_benchmark_num_trials", partial_fk_benchmark_num_trials_, 0);
+
+    dynamics_fidelity_.clear();
+    if (node_handle.hasParam("dynamics_fidelity"))
+    {
+        XmlRpc::XmlRpcValue segment;
+
+        node_handle.getParam("dynamics_fidelity", segment);
+
+        if (segment.getType() == XmlRpc::XmlRpcValue::TypeArray)
+        {
+            const char* fidelity_names[DYNAMICS_FIDELITY_NUM] = { "full", "root_wrench", "centroidal" };
+            int size = segment.size();
+            for (int i = 0; i < size; ++i)
+            {
+                std::string name = segment[i];
+                int fidelity = std::find(fidelity_names, fidelity_names + DYNAMICS_FIDELITY_NUM, name) - fidelity_names;
+                if (fidelity == DYNAMICS_FIDELITY_NUM)
+                {
+                    ROS_ERROR("dynamics_fidelity[%d] : unknown fidelity %s. full is used", i, name.c_str());
+                    fidelity = DYNAMICS_FIDELITY_FULL;
+                }
+                dynamics_fidelity_.push_back(fidelity);
+            }
+        }
+    }
+    node_handle.param("dynamics_fidelity_benchmark_num_trials", dynamics_fidelity_benchmark_num_trials_, 0);
+
+    node_handle.param("broadphase_window_size", broadphase_window_size_, 0);
+    node_handle.param("broadphase_window_margin", broadphase_window_margin_, 0.05);
+    node_handle.param("broadphase_benchmark_num_trials", broadphase_benchmark_num_trials_, 0);
+
+    node_handle.param("convex_decomposition", convex_decomposition_, false);
+    node_handle.param<std::string>("convex_decomposition_cache_prefix", convex_decomposition_cache_prefix_, "");
+    node_handle.param("convex_decomposition_max_concavity", convex_decomposition_max_concavity_, 0.05);
+    node_handle.param("convex_decomposition_max_pieces", convex_decomposition_max_pieces_, 256);
+    node_handle.param("convex_decomposition_benchmark_num_trials", convex_decomposition_benchmark_num_trials_, 0);
+
+    node_handle.param<std::string>("voxel_environment", voxel_environment_, "");
+    node_handle.param("voxel_environment_max_distance", voxel_environment_max_distance_, 0.2);
+    node_handle.param("voxel_plane_min_area", voxel_plane_min_area_, 0.04);
+
+    node_handle.param("gjk_warm_start", gjk_warm_start_, false);
+    node_handle.param("gjk_warm_start_benchmark_num_trials", gjk_warm_start_benchmark_num_trials_, 0);
+
+    node_handle.param("batched_obstacle_queries", batched_obstacle_queries_, false);
+    node_handle.param("batched_obstacle_queries_benchmark_num_trials", batched_obstacle_queries_benchmark_num_trials_, 0);
+
+    node_handle.param("contact_force_solve", contact_force_solve_, false);
+    node_handle.param("contact_force_solve_max_iterations", contact_force_solve_max_iterations_, 20);
+    node_handle.param("contact_force_solve_regularization", contact_force_solve_regularization_, 1e-6);
+
+    node_handle.param("gauss_newton", gauss_newton_, false);
+    node_handle.param("gauss_newton_damping", gauss_newton_damping_, 1e-3);
+    node_handle.param("gauss_newton_benchmark_num_trials", gauss_newton_benchmark_num_trials_, 0);
+
+    node_handle.param("augmented_lagrangian", augmented_lagrangian_, false);
+    node_handle.param("augmented_lagrangian_max_iterations", augmented_lagrangian_max_iterations_, 10);
+    node_handle.param("augmented_lagrangian_penalty_increase", augmented_lagrangian_penalty_increase_, 10.0);
+    node_handle.param("augmented_lagrangian_tolerance", augmented_lagrangian_tolerance_, 0.01);
+
+    node_handle.param("diagonal_preconditioning", diagonal_preconditioning_, false);
+
+    node_handle.param("phase_convergence", phase_convergence_, false);
+    node_handle.param("phase_convergence_relative_decrease", phase_convergence_relative_decrease_, 1e-4);
+    node_handle.param("phase_convergence_num_stalled_iterations", phase_convergence_num_stalled_iterations_, 3);
+    node_handle.param("phase_convergence_gradient_norm", phase_convergence_gradient_norm_, 1e-3);
+    node_handle.param("phase_convergence_constraint_violation", phase_convergence_constraint_violation_, 0.01);
+    node_handle.param("phase_convergence_max_iterations_factor", phase_convergence_max_iterations_factor_, 2);
+
+    node_handle.param("time_window_size", time_window_size_, 0);
+    node_handle.param("time_window_overlap", time_window_overlap_, 10);
+    node_handle.param("time_window_consensus_iterations", time_window_consensus_iterations_, 3);
+
+    node_handle.param("adaptive_discretization", adaptive_discretization_, false);
+    node_handle.param("adaptive_discretization_acceleration_ratio", adaptive_discretization_acceleration_ratio_, 2.0);
+    node_handle.param("adaptive_discretization_contact_change", adaptive_discretization_contact_change_, 0.1);
+    node_handle.param("adaptive_discretization_benchmark_num_trials", adaptive_discretization_benchmark_num_trials_, 0);
+
+    node_handle.param("prewarm", prewarm_, false);
+    node_handle.param<std::string>("prewarm_group", prewarm_group_, "lower_body");
+
+    node_handle.param("incremental_collision_world", incremental_collision_world_, false);
+
+    node_handle.param("goal_candidates", goal_candidates_, 1);
+    node_handle.param("goal_candidate_survivors", goal_candidate_survivors_, 2);
+    node_handle.param("goal_candidate_screening_phases", goal_candidate_screening_phases_, 1);
 }
 
 } // namespace
@@ -46,6 +46,7 @@
 #include <moveit_msgs/DisplayTrajectory.h>
 #include <moveit_msgs/DisplayRobotState.h>
 #include <moveit_msgs/PlanningScene.h>
+#include <itomp_cio_planner/itomp_planning_interface.h>
 #include <map>
 
 const std::string GROUP_NAME = "lower_body";
@@ -244,13 +245,10 @@ void visualizeResult(planning_interface::MotionPlanResponse& res,
 	timer.sleep();
 }
 
-void doPlan(const std::string& group_name,
-            planning_interface::MotionPlanRequest& req,
-            planning_interface::MotionPlanResponse& res,
-            robot_state::RobotState& start_state,
-            robot_state::RobotState& goal_state,
-            planning_scene::PlanningScenePtr& planning_scene,
-            planning_interface::PlannerManagerPtr& planner_instance)
+void setRequest(const std::string& group_name,
+                planning_interface::MotionPlanRequest& req,
+                robot_state::RobotState& start_state,
+                robot_state::RobotState& goal_state)
 {
 	req.allowed_planning_time = 60.0;
 
@@ -285,6 +283,55 @@ void doPlan(const std::string& group_name,
         kinematic_constraints::constructGoalConstraints(goal_state,
                 joint_model_group);
 	req.goal_constraints.push_back(joint_goal);
+}
+
+// adds up to num_candidates - 1 goals to req, the IK solutions of the end-effector pose of goal_state from random seeds.
+// the planner screens them with goal_candidates > 1
+void addGoalIKCandidates(const std::string& group_name,
+                         planning_interface::MotionPlanRequest& req,
+                         robot_state::RobotState& goal_state, int num_candidates)
+{
+	const robot_state::JointModelGroup* ik_group =
+        goal_state.getJointModelGroup(group_name);
+	const robot_state::JointModelGroup* joint_model_group =
+        goal_state.getJointModelGroup("whole_body");
+	if (!ik_group->getSolverInstance())
+	{
+		ROS_INFO("Group %s has no IK solver. No goal candidates are added", group_name.c_str());
+		return;
+	}
+	const Eigen::Affine3d end_effector_state =
+        goal_state.getGlobalLinkTransform(ik_group->getSolverInstance()->getTipFrame());
+
+	kinematics::KinematicsQueryOptions options;
+	options.return_approximate_solution = false;
+	for (int k = 1; k < num_candidates; ++k)
+	{
+		robot_state::RobotState candidate_state(goal_state);
+		candidate_state.setToRandomPositions(ik_group);
+		if (!candidate_state.setFromIK(ik_group, end_effector_state, 10, 0.1,
+                                       moveit::core::GroupStateValidityCallbackFn(), options))
+			continue;
+		candidate_state.update();
+		req.goal_constraints.push_back(
+            kinematic_constraints::constructGoalConstraints(candidate_state,
+                    joint_model_group));
+	}
+	ROS_INFO("%d goal candidates", (int)req.goal_constraints.size());
+}
+
+void doPlan(const std::string& group_name,
+            planning_interface::MotionPlanRequest& req,
+            planning_interface::MotionPlanResponse& res,
+            robot_state::RobotState& start_state,
+            robot_state::RobotState& goal_state,
+            planning_scene::PlanningScenePtr& planning_scene,
+            planning_interface::PlannerManagerPtr& planner_instance,
+            int num_goal_candidates = 1)
+{
+	setRequest(group_name, req, start_state, goal_state);
+	if (num_goal_candidates > 1)
+		addGoalIKCandidates(group_name, req, goal_state, num_goal_candidates);
 
 	// We now construct a planning context that encapsulate the scene,
 	// the request and the response. We call the planner using this
@@ -360,6 +407,39 @@ void displayStates(robot_state::RobotState& start_state,
 	goal_state_display_publisher.publish(disp_goal_state);
 }
 
+// plans the walking of multiple agents together. robot_states holds the start and goal states of each agent
+void doPlanCrowd(const std::string& group_name,
+                 std::vector<planning_interface::MotionPlanResponse>& res,
+                 std::vector<robot_state::RobotState>& robot_states,
+                 planning_scene::PlanningScenePtr& planning_scene,
+                 planning_interface::PlannerManagerPtr& planner_instance)
+{
+	int num_agents = robot_states.size() / 2;
+	std::vector<planning_interface::MotionPlanRequest> reqs(num_agents);
+	for (int a = 0; a < num_agents; ++a)
+		setRequest(group_name, reqs[a], robot_states[2 * a], robot_states[2 * a + 1]);
+
+	// the batch planning is only provided by the ITOMP planning context
+	moveit_msgs::MoveItErrorCodes error_code;
+	boost::shared_ptr<itomp_cio_planner::ItompPlanningContext> context =
+        boost::dynamic_pointer_cast<itomp_cio_planner::ItompPlanningContext>(
+            planner_instance->getPlanningContext(planning_scene, reqs[0], error_code));
+	if (!context)
+	{
+		ROS_ERROR("The planner does not support the planning of multiple agents");
+		exit(0);
+	}
+	context->solve(reqs, res);
+	for (int a = 0; a < num_agents; ++a)
+	{
+		if (res[a].error_code_.val != res[a].error_code_.SUCCESS)
+		{
+			ROS_ERROR("Could not compute plan of agent %d successfully", a);
+			exit(0);
+		}
+	}
+}
+
 void setWalkingStates(robot_state::RobotState& start_state,
                       robot_state::RobotState& goal_state, Eigen::Vector3d& start_trans,
                       Eigen::Vector3d& goal_trans, double start_rot = 0, double end_rot = 0)
@@ -676,9 +756,12 @@ int main(int argc, char **argv)
                              robot_states[state_index + 1], robot_states[state_index + 2],
                              robot_states[state_index + 3]);
 
+		// IK solutions of the goal hand pose passed to the planner as alternative goals
+		int num_goal_candidates;
+		node_handle.param("goal_ik_candidates", num_goal_candidates, 1);
 		doPlan("right_arm", req, res, robot_states[state_index],
                robot_states[state_index + 1], planning_scene,
-               planner_instance);
+               planner_instance, num_goal_candidates);
 	}
     break;
 
@@ -858,6 +941,27 @@ int main(int argc, char **argv)
                planner_instance);
 	}
     break;
+
+	case 9: // crowd walking
+	{
+		// three agents walking in parallel lanes which cross in the middle
+		const int num_agents = 3;
+		for (int a = 0; a < num_agents; ++a)
+		{
+			robot_states.push_back(planning_scene->getCurrentStateNonConst());
+			robot_states.push_back(robot_states.back());
+			Eigen::Vector3d start_trans(-1.55 + a, 0.5, 0);
+			Eigen::Vector3d goal_trans(0.45 - a, 3.5, 0);
+			setWalkingStates(robot_states[2 * a], robot_states[2 * a + 1],
+                             start_trans, goal_trans, 0, 0);
+		}
+
+		std::vector<planning_interface::MotionPlanResponse> crowd_res;
+		doPlanCrowd("lower_body", crowd_res, robot_states, planning_scene,
+                    planner_instance);
+		res = crowd_res[0];
+	}
+    break;
 	}
 
 	displayStates(robot_states[state_index], robot_states[state_index + 1],